@@ -0,0 +1,119 @@
+#include "CandidateCache.h"
+using namespace std;
+
+CandidateBlock::CandidateBlock() : count(0), next(0) {}
+
+CandidateCache::CandidateCache() : blocks(16), freeBlocks(16), blockOf(32) {}
+
+CandidateBlock* CandidateCache::lookup(int tripId) {
+    int block = blockOf.find(tripId);
+    return (block >= 0) ? &blocks[block] : nullptr;
+}
+
+const CandidateBlock* CandidateCache::lookup(int tripId) const {
+    int block = blockOf.find(tripId);
+    return (block >= 0) ? &blocks[block] : nullptr;
+}
+
+void CandidateCache::clear(int tripId) {
+    int block = blockOf.find(tripId);
+    if (block < 0) {
+        return;
+    }
+    blockOf.remove(tripId);
+    blocks[block].count = 0;
+    blocks[block].next = 0;
+    freeBlocks.emplace(block);
+}
+
+bool CandidateCache::add(int tripId, int driverId, int effectiveDistance) {
+    CandidateBlock* entry = lookup(tripId);
+    if (!entry) {
+        int block;
+        if (!freeBlocks.isEmpty()) {
+            block = freeBlocks.back();
+            freeBlocks.popBack();
+        } else {
+            block = blocks.emplace();
+        }
+        blockOf.insert(tripId, block);
+        entry = &blocks[block];
+    }
+    if (entry->count >= TRIP_CANDIDATE_CAPACITY) {
+        return false;
+    }
+    entry->driverIds[entry->count] = driverId;
+    entry->distances[entry->count] = effectiveDistance;
+    entry->count++;
+    return true;
+}
+
+int CandidateCache::pop(int tripId) {
+    CandidateBlock* entry = lookup(tripId);
+    if (!entry || entry->next >= entry->count) {
+        return -1;
+    }
+    return entry->driverIds[entry->next++];
+}
+
+int CandidateCache::getLastPoppedDistance(int tripId) const {
+    const CandidateBlock* entry = lookup(tripId);
+    if (!entry || entry->next == 0) {
+        return -1;
+    }
+    return entry->distances[entry->next - 1];
+}
+
+void CandidateCache::unpop(int tripId, int driverId, int effectiveDistance) {
+    CandidateBlock* entry = lookup(tripId);
+    if (entry && entry->next > 0 && entry->driverIds[entry->next - 1] == driverId) {
+        entry->next--;
+        return;
+    }
+
+    // The list was refilled or dropped since: insert ahead of what is left
+    if (!entry) {
+        add(tripId, driverId, effectiveDistance);
+        return;
+    }
+    int last = entry->count < TRIP_CANDIDATE_CAPACITY ? entry->count : TRIP_CANDIDATE_CAPACITY - 1;
+    for (int i = last; i > entry->next; i--) {
+        entry->driverIds[i] = entry->driverIds[i - 1];
+        entry->distances[i] = entry->distances[i - 1];
+    }
+    entry->driverIds[entry->next] = driverId;
+    entry->distances[entry->next] = effectiveDistance;
+    if (entry->count < TRIP_CANDIDATE_CAPACITY) {
+        entry->count++;
+    }
+}
+
+int CandidateCache::getCount(int tripId) const {
+    const CandidateBlock* entry = lookup(tripId);
+    return entry ? entry->count : 0;
+}
+
+int CandidateCache::getRemaining(int tripId) const {
+    const CandidateBlock* entry = lookup(tripId);
+    return entry ? entry->count - entry->next : 0;
+}
+
+int CandidateCache::getDriverId(int tripId, int rank) const {
+    const CandidateBlock* entry = lookup(tripId);
+    if (!entry || rank < 0 || rank >= entry->count) return -1;
+    return entry->driverIds[rank];
+}
+
+int CandidateCache::getDistance(int tripId, int rank) const {
+    const CandidateBlock* entry = lookup(tripId);
+    if (!entry || rank < 0 || rank >= entry->count) return -1;
+    return entry->distances[rank];
+}
+
+int CandidateCache::getBytesPerTrip() {
+    return (int)(sizeof(CandidateBlock) + sizeof(int) * 2);
+}
+
+int CandidateCache::getBlocksInUse() const {
+    return blockOf.size();
+}
@@ -0,0 +1,57 @@
+#ifndef CANDIDATE_CACHE_H
+#define CANDIDATE_CACHE_H
+
+#include "IdIndex.h"
+#include "GrowableArray.h"
+#include <cstdint>
+
+// Number of ranked dispatch candidates cached per trip
+const int TRIP_CANDIDATE_CAPACITY = 5;
+
+// Ranked fallback drivers from one dispatch search (nearest first)
+struct CandidateBlock {
+    int driverIds[TRIP_CANDIDATE_CAPACITY];
+    int distances[TRIP_CANDIDATE_CAPACITY];
+    uint8_t count;
+    uint8_t next;
+
+    CandidateBlock();
+};
+
+// Dispatch candidate cache kept beside the trips rather than inside them.
+// Only trips between dispatch and pickup need fallbacks, so blocks are
+// handed out per trip on first use and recycled through a free list when
+// the trip no longer needs them; the trip records themselves stay small.
+class CandidateCache {
+private:
+    GrowableArray<CandidateBlock> blocks;
+    GrowableArray<int> freeBlocks;
+    IdIndex blockOf;  // Trip ID -> block
+
+    CandidateBlock* lookup(int tripId);
+    const CandidateBlock* lookup(int tripId) const;
+
+public:
+    CandidateCache();
+
+    CandidateCache(const CandidateCache&) = delete;
+    CandidateCache& operator=(const CandidateCache&) = delete;
+
+    void clear(int tripId);  // Drop the trip's candidates and recycle its block
+    bool add(int tripId, int driverId, int effectiveDistance);
+    int pop(int tripId);  // Next cached driver ID or -1
+    int getLastPoppedDistance(int tripId) const;  // Of the driver pop() last returned
+    // Undo a pop (rollback): step back if the driver was the last one
+    // popped, otherwise put it back at the front of the remaining ones
+    void unpop(int tripId, int driverId, int effectiveDistance);
+
+    int getCount(int tripId) const;
+    int getRemaining(int tripId) const;
+    int getDriverId(int tripId, int rank) const;
+    int getDistance(int tripId, int rank) const;
+    int getBlocksInUse() const;
+    // A block plus its ID index entry (key and slot); held from dispatch to pickup
+    static int getBytesPerTrip();
+};
+
+#endif
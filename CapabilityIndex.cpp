@@ -0,0 +1,124 @@
+#include "CapabilityIndex.h"
+using namespace std;
+
+CapabilityIndex::CapabilityIndex(int initialCapacity)
+    : capacity(initialCapacity > 0 ? initialCapacity : 1) {
+    for (int c = 0; c < CAPABILITY_CLASS_COUNT; c++) {
+        heads[c] = -1;
+        counts[c] = 0;
+    }
+    nextDriver = new int[capacity];
+    prevDriver = new int[capacity];
+    classOf = new int[capacity];
+    for (int i = 0; i < capacity; i++) {
+        classOf[i] = -1;
+    }
+}
+
+CapabilityIndex::~CapabilityIndex() {
+    delete[] nextDriver;
+    delete[] prevDriver;
+    delete[] classOf;
+}
+
+void CapabilityIndex::grow(int minCapacity) {
+    int newCapacity = capacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    int* newNext = new int[newCapacity];
+    int* newPrev = new int[newCapacity];
+    int* newClass = new int[newCapacity];
+    for (int i = 0; i < newCapacity; i++) {
+        if (i < capacity) {
+            newNext[i] = nextDriver[i];
+            newPrev[i] = prevDriver[i];
+            newClass[i] = classOf[i];
+        } else {
+            newClass[i] = -1;
+        }
+    }
+
+    delete[] nextDriver;
+    delete[] prevDriver;
+    delete[] classOf;
+    nextDriver = newNext;
+    prevDriver = newPrev;
+    classOf = newClass;
+    capacity = newCapacity;
+}
+
+void CapabilityIndex::unlink(int driverIndex) {
+    int c = classOf[driverIndex];
+    if (c < 0) {
+        return;
+    }
+
+    if (prevDriver[driverIndex] >= 0) {
+        nextDriver[prevDriver[driverIndex]] = nextDriver[driverIndex];
+    } else {
+        heads[c] = nextDriver[driverIndex];
+    }
+    if (nextDriver[driverIndex] >= 0) {
+        prevDriver[nextDriver[driverIndex]] = prevDriver[driverIndex];
+    }
+    counts[c]--;
+    classOf[driverIndex] = -1;
+}
+
+void CapabilityIndex::place(int driverIndex, int capabilities) {
+    if (driverIndex < 0) {
+        return;
+    }
+    if (driverIndex >= capacity) {
+        grow(driverIndex + 1);
+    }
+
+    int c = capabilities & (CAPABILITY_CLASS_COUNT - 1);
+    if (classOf[driverIndex] == c) {
+        return;
+    }
+    unlink(driverIndex);
+
+    // Push at the head of its class list
+    nextDriver[driverIndex] = heads[c];
+    prevDriver[driverIndex] = -1;
+    if (heads[c] >= 0) {
+        prevDriver[heads[c]] = driverIndex;
+    }
+    heads[c] = driverIndex;
+    classOf[driverIndex] = c;
+    counts[c]++;
+}
+
+int CapabilityIndex::firstInClass(int classMask) const {
+    if (classMask < 0 || classMask >= CAPABILITY_CLASS_COUNT) {
+        return -1;
+    }
+    return heads[classMask];
+}
+
+int CapabilityIndex::nextInClass(int driverIndex) const {
+    if (driverIndex < 0 || driverIndex >= capacity || classOf[driverIndex] < 0) {
+        return -1;
+    }
+    return nextDriver[driverIndex];
+}
+
+int CapabilityIndex::getClassSize(int classMask) const {
+    if (classMask < 0 || classMask >= CAPABILITY_CLASS_COUNT) {
+        return 0;
+    }
+    return counts[classMask];
+}
+
+int CapabilityIndex::countEligible(int required) const {
+    int total = 0;
+    for (int c = 0; c < CAPABILITY_CLASS_COUNT; c++) {
+        if (classServes(c, required)) {
+            total += counts[c];
+        }
+    }
+    return total;
+}
@@ -0,0 +1,47 @@
+#ifndef CAPABILITY_INDEX_H
+#define CAPABILITY_INDEX_H
+
+#include "Driver.h"
+
+// One class per distinct capability bitmask
+const int CAPABILITY_CLASS_COUNT = 1 << CAPABILITY_COUNT;
+
+// Drivers partitioned by capability class (the exact bitmask they carry),
+// each class an intrusive doubly linked list over driver indices. A request
+// that needs mask R walks only the classes containing R, so a filtered
+// dispatch never visits an ineligible driver.
+class CapabilityIndex {
+private:
+    int heads[CAPABILITY_CLASS_COUNT];
+    int counts[CAPABILITY_CLASS_COUNT];
+
+    // Per driver index
+    int* nextDriver;
+    int* prevDriver;
+    int* classOf;  // -1 if not indexed
+    int capacity;
+
+    void grow(int minCapacity);
+    void unlink(int driverIndex);
+
+public:
+    CapabilityIndex(int initialCapacity = 10);
+    ~CapabilityIndex();
+
+    CapabilityIndex(const CapabilityIndex&) = delete;
+    CapabilityIndex& operator=(const CapabilityIndex&) = delete;
+
+    // Insert a driver, or move it when its capabilities change
+    void place(int driverIndex, int capabilities);
+
+    static bool classServes(int classMask, int required) {
+        return (classMask & required) == required;
+    }
+
+    int firstInClass(int classMask) const;     // -1 if empty
+    int nextInClass(int driverIndex) const;    // -1 at the end
+    int getClassSize(int classMask) const;
+    int countEligible(int required) const;     // Drivers whose class serves required
+};
+
+#endif
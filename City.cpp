@@ -6,73 +6,127 @@ using namespace std;
 // Edge constructor
 Edge::Edge(int dest, int w) : destination(dest), weight(w), next(nullptr) {}
 
-// Location constructors
-Location::Location() : id(-1), name(""), zoneId(-1), adjacencyList(nullptr) {}
+// Edge slab
+EdgeSlab::EdgeSlab() : head(nullptr), edgeCount(0) {}
+
+EdgeSlab::~EdgeSlab() {
+    // Edges are trivially destructible: free whole blocks
+    while (head != nullptr) {
+        Block* next = head->next;
+        ::operator delete(head->edges);
+        delete head;
+        head = next;
+    }
+}
 
-Location::Location(int id, const string& name, int zone)
-    : id(id), name(name), zoneId(zone), adjacencyList(nullptr) {}
+void EdgeSlab::addBlock(int capacity) {
+    Block* block = new Block;
+    block->edges = static_cast<Edge*>(::operator new(sizeof(Edge) * capacity));
+    block->used = 0;
+    block->capacity = capacity;
+    block->next = head;
+    head = block;
+}
 
-Location::~Location() {
-    Edge* current = adjacencyList;
-    while (current != nullptr) {
-        Edge* next = current->next;
-        delete current;
-        current = next;
+Edge* EdgeSlab::allocate(int destination, int weight) {
+    if (head == nullptr || head->used >= head->capacity) {
+        addBlock(EDGE_SLAB_BLOCK);
     }
+    Edge* edge = new (&head->edges[head->used++]) Edge(destination, weight);
+    edgeCount++;
+    return edge;
 }
 
-void Location::addEdge(int destination, int weight) {
-    Edge* newEdge = new Edge(destination, weight);
-    newEdge->next = adjacencyList;
-    adjacencyList = newEdge;
+void EdgeSlab::reserve(int edgeCapacity) {
+    if (head == nullptr || head->capacity - head->used < edgeCapacity) {
+        addBlock(edgeCapacity > EDGE_SLAB_BLOCK ? edgeCapacity : EDGE_SLAB_BLOCK);
+    }
 }
 
-// City constructor
-City::City(int initialCapacity) : locationCount(0), capacity(initialCapacity) {
-    locations = new Location[capacity];
+void EdgeSlab::swap(EdgeSlab& other) {
+    Block* block = head;
+    head = other.head;
+    other.head = block;
+    int count = edgeCount;
+    edgeCount = other.edgeCount;
+    other.edgeCount = count;
 }
 
-City::~City() {
-    delete[] locations;
+int EdgeSlab::size() const {
+    return edgeCount;
 }
 
-void City::resize() {
-    int newCapacity = capacity * 2;
-    Location* newLocations = new Location[newCapacity];
+// Location constructors
+Location::Location() : id(-1), name(""), zoneId(-1), adjacencyList(nullptr) {}
 
-    for (int i = 0; i < locationCount; i++) {
-        newLocations[i].id = locations[i].id;
-        newLocations[i].name = locations[i].name;
-        newLocations[i].zoneId = locations[i].zoneId;
-        newLocations[i].adjacencyList = locations[i].adjacencyList;
-        locations[i].adjacencyList = nullptr; // Prevent double delete
-    }
+Location::Location(int id, const string& name, int zone)
+    : id(id), name(name), zoneId(zone), adjacencyList(nullptr) {}
 
-    delete[] locations;
-    locations = newLocations;
-    capacity = newCapacity;
+Location::Location(Location&& other)
+    : id(other.id), name(move(other.name)), zoneId(other.zoneId),
+      adjacencyList(other.adjacencyList) {
+    other.adjacencyList = nullptr;
 }
 
-int City::addLocation(const string& name, int zoneId) {
-    if (locationCount >= capacity) {
-        resize();
+void Location::addEdge(Edge* edge) {
+    edge->next = adjacencyList;
+    adjacencyList = edge;
+}
+
+// City constructor
+City::City(int initialCapacity) : locations(initialCapacity), version(0) {}
+
+void City::reserve(int locationCapacity, int roadCapacity) {
+    locations.reserve(locationCapacity);
+    if (roadCapacity > 0) {
+        roads.reserve(roadCapacity * 2);
     }
+}
 
-    int id = locationCount;
-    locations[locationCount] = Location(id, name, zoneId);
-    locationCount++;
+int City::addLocation(const string& name, int zoneId) {
+    int id = locations.size();
+    locations.emplace(id, name, zoneId);
+    version++;
     return id;
 }
 
 void City::addRoad(int from, int to, int distance) {
-    if (from < 0 || from >= locationCount || to < 0 || to >= locationCount) {
+    if (from < 0 || from >= locations.size() || to < 0 || to >= locations.size()) {
         cout << "Invalid location IDs for road." << endl;
         return;
     }
 
     // Add bidirectional road
-    locations[from].addEdge(to, distance);
-    locations[to].addEdge(from, distance);
+    locations[from].addEdge(roads.allocate(to, distance));
+    locations[to].addEdge(roads.allocate(from, distance));
+    version++;
+}
+
+void City::compactRoads() {
+    // One block sized for every edge, filled location by location
+    EdgeSlab packed;
+    packed.reserve(roads.size());
+    for (int i = 0; i < locations.size(); i++) {
+        Edge* first = nullptr;
+        Edge* last = nullptr;
+        for (Edge* edge = locations[i].adjacencyList; edge != nullptr; edge = edge->next) {
+            Edge* copy = packed.allocate(edge->destination, edge->weight);
+            if (last != nullptr) {
+                last->next = copy;
+            } else {
+                first = copy;
+            }
+            last = copy;
+        }
+        locations[i].adjacencyList = first;
+    }
+
+    // The old blocks are freed together when packed goes out of scope
+    roads.swap(packed);
+}
+
+int City::getRoadCount() const {
+    return roads.size();
 }
 
 int City::findMinDistance(int* dist, bool* visited, int n) {
@@ -89,8 +143,8 @@ int City::findMinDistance(int* dist, bool* visited, int n) {
 }
 
 int City::getDistance(int source, int destination) {
-    if (source < 0 || source >= locationCount ||
-        destination < 0 || destination >= locationCount) {
+    if (source < 0 || source >= locations.size() ||
+        destination < 0 || destination >= locations.size()) {
         return -1;
     }
 
@@ -99,18 +153,18 @@ int City::getDistance(int source, int destination) {
     }
 
     // Dijkstra's algorithm
-    int* dist = new int[locationCount];
-    bool* visited = new bool[locationCount];
+    int* dist = new int[locations.size()];
+    bool* visited = new bool[locations.size()];
 
-    for (int i = 0; i < locationCount; i++) {
+    for (int i = 0; i < locations.size(); i++) {
         dist[i] = INT_MAX;
         visited[i] = false;
     }
 
     dist[source] = 0;
 
-    for (int count = 0; count < locationCount - 1; count++) {
-        int u = findMinDistance(dist, visited, locationCount);
+    for (int count = 0; count < locations.size() - 1; count++) {
+        int u = findMinDistance(dist, visited, locations.size());
         if (u == -1) break;
 
         visited[u] = true;
@@ -135,19 +189,59 @@ int City::getDistance(int source, int destination) {
     return result;
 }
 
+bool City::getDistancesFrom(int source, int* dist) {
+    if (source < 0 || source >= locations.size()) {
+        return false;
+    }
+
+    // Same array-based Dijkstra, but keep every distance from the source
+    bool* visited = new bool[locations.size()];
+    for (int i = 0; i < locations.size(); i++) {
+        dist[i] = INT_MAX;
+        visited[i] = false;
+    }
+
+    dist[source] = 0;
+
+    for (int count = 0; count < locations.size() - 1; count++) {
+        int u = findMinDistance(dist, visited, locations.size());
+        if (u == -1) break;
+
+        visited[u] = true;
+
+        Edge* edge = locations[u].adjacencyList;
+        while (edge != nullptr) {
+            int v = edge->destination;
+            if (!visited[v] && dist[u] + edge->weight < dist[v]) {
+                dist[v] = dist[u] + edge->weight;
+            }
+            edge = edge->next;
+        }
+    }
+
+    for (int i = 0; i < locations.size(); i++) {
+        if (dist[i] == INT_MAX) {
+            dist[i] = -1;
+        }
+    }
+
+    delete[] visited;
+    return true;
+}
+
 int* City::getShortestPath(int source, int destination, int& pathLength) {
-    if (source < 0 || source >= locationCount ||
-        destination < 0 || destination >= locationCount) {
+    if (source < 0 || source >= locations.size() ||
+        destination < 0 || destination >= locations.size()) {
         pathLength = 0;
         return nullptr;
     }
 
     // Dijkstra's with path tracking
-    int* dist = new int[locationCount];
-    int* parent = new int[locationCount];
-    bool* visited = new bool[locationCount];
+    int* dist = new int[locations.size()];
+    int* parent = new int[locations.size()];
+    bool* visited = new bool[locations.size()];
 
-    for (int i = 0; i < locationCount; i++) {
+    for (int i = 0; i < locations.size(); i++) {
         dist[i] = INT_MAX;
         parent[i] = -1;
         visited[i] = false;
@@ -155,8 +249,8 @@ int* City::getShortestPath(int source, int destination, int& pathLength) {
 
     dist[source] = 0;
 
-    for (int count = 0; count < locationCount - 1; count++) {
-        int u = findMinDistance(dist, visited, locationCount);
+    for (int count = 0; count < locations.size() - 1; count++) {
+        int u = findMinDistance(dist, visited, locations.size());
         if (u == -1) break;
 
         visited[u] = true;
@@ -206,33 +300,37 @@ int* City::getShortestPath(int source, int destination, int& pathLength) {
 }
 
 int City::getLocationCount() const {
-    return locationCount;
+    return locations.size();
 }
 
 Location* City::getLocation(int id) {
-    if (id < 0 || id >= locationCount) {
+    if (id < 0 || id >= locations.size()) {
         return nullptr;
     }
     return &locations[id];
 }
 
 string City::getLocationName(int id) const {
-    if (id < 0 || id >= locationCount) {
+    if (id < 0 || id >= locations.size()) {
         return "";
     }
     return locations[id].name;
 }
 
 int City::getLocationZone(int id) const {
-    if (id < 0 || id >= locationCount) {
+    if (id < 0 || id >= locations.size()) {
         return -1;
     }
     return locations[id].zoneId;
 }
 
+int City::getVersion() const {
+    return version;
+}
+
 void City::displayCity() const {
     cout << "\n=== City Map ===" << endl;
-    for (int i = 0; i < locationCount; i++) {
+    for (int i = 0; i < locations.size(); i++) {
         cout << "Location " << i << " (" << locations[i].name
              << ") [Zone " << locations[i].zoneId << "]: ";
 
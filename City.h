@@ -2,9 +2,10 @@
 #define CITY_H
 
 #include <string>
+#include "GrowableArray.h"
 using namespace std;
 
-// Edge in adjacency list (linked list node)
+// Edge in adjacency list (linked list node, allocated from the City's slab)
 struct Edge {
     int destination;
     int weight;
@@ -13,39 +14,80 @@ struct Edge {
     Edge(int dest, int w);
 };
 
+// Edges per slab block unless a reservation asks for more
+const int EDGE_SLAB_BLOCK = 256;
+
+// Arena for road edges. Edges are carved in order out of large blocks and
+// never freed one at a time; the destructor releases every block at once.
+// Consecutive allocations land next to each other in memory.
+class EdgeSlab {
+private:
+    struct Block {
+        Edge* edges;
+        int used;
+        int capacity;
+        Block* next;
+    };
+    Block* head;  // Block currently handing out edges
+    int edgeCount;
+
+    void addBlock(int capacity);
+
+public:
+    EdgeSlab();
+    ~EdgeSlab();
+
+    EdgeSlab(const EdgeSlab&) = delete;
+    EdgeSlab& operator=(const EdgeSlab&) = delete;
+
+    Edge* allocate(int destination, int weight);
+    void reserve(int edgeCapacity);  // Room for this many more in the current block
+    void swap(EdgeSlab& other);
+    int size() const;
+};
+
 // Location/Node in the graph
 struct Location {
     int id;
     string name;
     int zoneId;
-    Edge* adjacencyList;
+    Edge* adjacencyList;  // Edges owned by the City's slab
 
     Location();
     Location(int id, const string& name, int zone);
-    ~Location();
-    void addEdge(int destination, int weight);
+    Location(Location&& other);  // Takes over the road list
+
+    Location(const Location&) = delete;
+    Location& operator=(const Location&) = delete;
+
+    void addEdge(Edge* edge);
 };
 
 // City graph class
 class City {
 private:
-    Location* locations;
-    int locationCount;
-    int capacity;
+    GrowableArray<Location> locations;
+    EdgeSlab roads;
+    int version;  // Bumped on every graph change (invalidates cached distances)
 
-    void resize();
     int findMinDistance(int* dist, bool* visited, int n);
 
 public:
     City(int initialCapacity = 10);
-    ~City();
 
     // Graph operations
+    void reserve(int locationCapacity, int roadCapacity = 0);  // Roads, not edges
     int addLocation(const string& name, int zoneId);
     void addRoad(int from, int to, int distance);
+    // Rewrite all edges into one block with each location's roads adjacent
+    // (same order, same distances). Moves edges: no searches may run meanwhile.
+    void compactRoads();
+    int getRoadCount() const;  // Directed edges (two per road)
 
     // Shortest path using Dijkstra's algorithm
     int getDistance(int source, int destination);
+    // Single-source Dijkstra: fills dist[0..locationCount) (-1 if unreachable)
+    bool getDistancesFrom(int source, int* dist);
     int* getShortestPath(int source, int destination, int& pathLength);
 
     // Getters
@@ -53,6 +95,7 @@ public:
     Location* getLocation(int id);
     string getLocationName(int id) const;
     int getLocationZone(int id) const;
+    int getVersion() const;
 
     // Display
     void displayCity() const;
@@ -0,0 +1,162 @@
+#include "CommandLoop.h"
+#include "RideShareSystem.h"
+using namespace std;
+
+Command::Command() : type(-1), candidates(nullptr), result(-1), finished(false), next(nullptr) {
+    for (int i = 0; i < COMMAND_ARG_COUNT; i++) {
+        args[i] = 0;
+    }
+}
+
+Command::Command(int type, int arg0, int arg1, int arg2, int arg3)
+    : type(type), candidates(nullptr), result(-1), finished(false), next(nullptr) {
+    args[0] = arg0;
+    args[1] = arg1;
+    args[2] = arg2;
+    args[3] = arg3;
+}
+
+// Command queue
+CommandQueue::CommandQueue() : head(&stub), tail(&stub) {}
+
+void CommandQueue::push(Command* command) {
+    command->next.store(nullptr, memory_order_relaxed);
+    Command* previous = head.exchange(command, memory_order_acq_rel);
+    previous->next.store(command, memory_order_release);
+}
+
+Command* CommandQueue::pop() {
+    Command* oldest = tail;
+    Command* next = oldest->next.load(memory_order_acquire);
+    if (oldest == &stub) {
+        if (next == nullptr) {
+            return nullptr;
+        }
+        tail = next;
+        oldest = next;
+        next = next->next.load(memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+        tail = next;
+        return oldest;
+    }
+
+    // A producer has swapped in a newer node but not linked it yet
+    if (oldest != head.load(memory_order_acquire)) {
+        return nullptr;
+    }
+
+    // Last node: queue the stub behind it so it can be detached
+    push(&stub);
+    next = oldest->next.load(memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        return oldest;
+    }
+    return nullptr;
+}
+
+// Writer loop
+CommandLoop::CommandLoop(RideShareSystem* system)
+    : system(system), running(false), pendingCount(0), appliedCount(0), idle(false) {}
+
+CommandLoop::~CommandLoop() {
+    stop();
+}
+
+void CommandLoop::start() {
+    if (running) {
+        return;
+    }
+    running = true;
+    writer = thread(&CommandLoop::writerLoop, this);
+}
+
+void CommandLoop::stop() {
+    if (!running) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(idleLock);
+        running = false;
+    }
+    workAvailable.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+bool CommandLoop::isRunning() const {
+    return running;
+}
+
+bool CommandLoop::isWriterThread() const {
+    return this_thread::get_id() == writer.get_id();
+}
+
+int CommandLoop::getAppliedCount() const {
+    return appliedCount;
+}
+
+int CommandLoop::execute(Command& command) {
+    // Count first, so the writer never sleeps while this push is linking in
+    pendingCount.fetch_add(1);
+    queue.push(&command);
+    if (idle) {
+        lock_guard<mutex> guard(idleLock);
+        workAvailable.notify_one();
+    }
+
+    unique_lock<mutex> guard(command.lock);
+    command.done.wait(guard, [&command] { return command.finished; });
+    return command.result;
+}
+
+int CommandLoop::drainBatch(Command** batch) {
+    int count = 0;
+    while (count < COMMAND_BATCH_LIMIT) {
+        Command* command = queue.pop();
+        if (command == nullptr) {
+            break;
+        }
+        pendingCount.fetch_sub(1);
+        batch[count++] = command;
+    }
+    return count;
+}
+
+void CommandLoop::writerLoop() {
+    Command* batch[COMMAND_BATCH_LIMIT];
+    while (true) {
+        int count = drainBatch(batch);
+        if (count > 0) {
+            for (int i = 0; i < count; i++) {
+                batch[i]->result = system->applyCommand(batch[i]->type, batch[i]->args,
+                                                        batch[i]->candidates);
+            }
+            appliedCount += count;
+            // Wake the submitters once the batch is applied
+            for (int i = 0; i < count; i++) {
+                Command* command = batch[i];
+                lock_guard<mutex> guard(command->lock);
+                command->finished = true;
+                command->done.notify_one();
+            }
+            continue;
+        }
+
+        if (pendingCount > 0) {
+            this_thread::yield();  // A push is still linking in
+            continue;
+        }
+        if (!running) {
+            return;
+        }
+
+        unique_lock<mutex> guard(idleLock);
+        idle = true;
+        workAvailable.wait(guard, [this] { return pendingCount > 0 || !running; });
+        idle = false;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef COMMAND_LOOP_H
+#define COMMAND_LOOP_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+using namespace std;
+
+class RideShareSystem;
+struct DriverCandidate;
+
+// Command types (instead of enum)
+const int CMD_REQUEST_TRIP = 0;        // rider, pickup, dropoff, capabilities -> trip ID
+const int CMD_REQUEST_TRIP_ASYNC = 1;  // Same, then queued for background dispatch
+const int CMD_ASSIGN_TRIP = 2;         // trip -> 0/1
+const int CMD_POOL_TRIP = 3;           // trip -> 0/1
+const int CMD_START_TRIP = 4;          // trip -> 0/1
+const int CMD_COMPLETE_TRIP = 5;       // trip -> 0/1
+const int CMD_CANCEL_TRIP = 6;         // trip -> 0/1
+const int CMD_REJECT_TRIP = 7;         // trip -> 0/1
+const int CMD_ROLLBACK = 8;            // count -> 0/1
+const int CMD_UPDATE_LOCATION = 9;     // driver, location -> 0/1
+const int CMD_REBALANCE = 10;          // -> drivers moved
+const int CMD_DISPATCH_WAITING = 11;   // -> trips assigned
+const int CMD_COMMIT_ASSIGNMENT = 12;  // trip, candidate count + candidates -> 0/1
+const int CMD_FINISH_REJECT = 13;      // trip, candidate count, rejecting driver + candidates -> 0/1/-1
+const int CMD_COMMIT_POOL = 14;        // trip, candidate count + candidates -> 0/1
+const int CMD_TYPE_COUNT = 15;
+
+const int COMMAND_ARG_COUNT = 4;
+
+// Most commands the writer applies before waking their submitters
+const int COMMAND_BATCH_LIMIT = 64;
+
+// One submitted mutation. Lives on the submitting thread's stack, which
+// waits on it until the writer has applied it (a per-command future).
+struct Command {
+    int type;
+    int args[COMMAND_ARG_COUNT];
+    const DriverCandidate* candidates;  // Ranked search result (CMD_COMMIT_ASSIGNMENT, CMD_FINISH_REJECT, CMD_COMMIT_POOL)
+    int result;
+
+    mutex lock;
+    condition_variable done;
+    bool finished;
+
+    atomic<Command*> next;  // Queue link
+
+    Command();
+    Command(int type, int arg0, int arg1, int arg2, int arg3);
+};
+
+// Lock-free multi-producer single-consumer queue of commands (intrusive,
+// with a stub node). push() is one exchange plus one store and never
+// blocks; pop() belongs to the writer thread alone.
+class CommandQueue {
+private:
+    atomic<Command*> head;  // Newest; producers swap themselves in here
+    Command* tail;          // Oldest; consumer only
+    Command stub;
+
+public:
+    CommandQueue();
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    void push(Command* command);
+    // Oldest command, or nullptr if empty or a push is still linking in
+    Command* pop();
+};
+
+// Single-writer mode: every mutation is queued as a command and applied,
+// in submission order and in batches, by one writer thread, so state
+// changes never contend with each other for the commit lock.
+class CommandLoop {
+private:
+    RideShareSystem* system;
+    CommandQueue queue;
+    thread writer;
+
+    atomic<bool> running;
+    atomic<int> pendingCount;  // Pushed but not yet popped
+    atomic<int> appliedCount;
+    atomic<bool> idle;         // Writer is (about to be) asleep
+    mutex idleLock;
+    condition_variable workAvailable;
+
+    void writerLoop();
+    int drainBatch(Command** batch);
+
+public:
+    explicit CommandLoop(RideShareSystem* system);
+    ~CommandLoop();
+
+    void start();
+    void stop();  // Applies whatever is still queued first
+    bool isRunning() const;
+    bool isWriterThread() const;
+    int getAppliedCount() const;
+
+    // Queue a command and wait for the writer to apply it; returns its result
+    int execute(Command& command);
+};
+
+#endif
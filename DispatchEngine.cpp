@@ -1,50 +1,304 @@
 #include "DispatchEngine.h"
-#include <climits>
 #include <iostream>
 using namespace std;
 
-DispatchEngine::DispatchEngine() {}
+DriverCandidate::DriverCandidate() : driverIndex(-1), effectiveDistance(INT_MAX) {}
 
-int DispatchEngine::calculateEffectiveDistance(int actualDistance, int driverZone, int pickupZone) {
-    if (driverZone != pickupZone) {
-        // Apply cross-zone penalty (50% extra)
-        return actualDistance + (actualDistance * CROSS_ZONE_PENALTY / 100);
+DriverCandidate::DriverCandidate(int driverIndex, int effectiveDistance)
+    : driverIndex(driverIndex), effectiveDistance(effectiveDistance) {}
+
+// City distance oracle
+CityDistanceOracle::CityDistanceOracle(City* city) : city(city) {}
+
+// Zone cost policy
+ZoneCostPolicy::ZoneCostPolicy(int defaultPenalty)
+    : penalties(nullptr), zoneSlots(0), defaultPenalty(defaultPenalty), currentHour(0) {
+    for (int h = 0; h < HOURS_PER_DAY; h++) {
+        hourMultipliers[h] = 100;
     }
-    return actualDistance;
 }
 
-int DispatchEngine::findNearestDriver(City& city, Driver* drivers, int driverCount,
-                                       int pickupLocationId, int pickupZoneId) {
-    int nearestDriverIndex = -1;
-    int minEffectiveDistance = INT_MAX;
+ZoneCostPolicy::ZoneCostPolicy(const ZoneCostPolicy& other)
+    : penalties(nullptr), zoneSlots(other.zoneSlots),
+      defaultPenalty(other.defaultPenalty), currentHour(other.currentHour) {
+    if (zoneSlots > 0) {
+        penalties = new int[zoneSlots * zoneSlots];
+        for (int i = 0; i < zoneSlots * zoneSlots; i++) {
+            penalties[i] = other.penalties[i];
+        }
+    }
+    for (int h = 0; h < HOURS_PER_DAY; h++) {
+        hourMultipliers[h] = other.hourMultipliers[h];
+    }
+}
 
-    for (int i = 0; i < driverCount; i++) {
-        // Only consider available drivers
-        if (drivers[i].getStatus() != DRIVER_AVAILABLE) {
-            continue;
+ZoneCostPolicy& ZoneCostPolicy::operator=(const ZoneCostPolicy& other) {
+    if (this != &other) {
+        ZoneCostPolicy copy(other);
+        int* temp = penalties;
+        penalties = copy.penalties;
+        copy.penalties = temp;
+        zoneSlots = copy.zoneSlots;
+        defaultPenalty = copy.defaultPenalty;
+        currentHour = copy.currentHour;
+        for (int h = 0; h < HOURS_PER_DAY; h++) {
+            hourMultipliers[h] = copy.hourMultipliers[h];
         }
+    }
+    return *this;
+}
 
-        // Get actual distance from driver to pickup
-        int actualDistance = city.getDistance(drivers[i].getCurrentLocationId(), pickupLocationId);
+ZoneCostPolicy::~ZoneCostPolicy() {
+    delete[] penalties;
+}
 
-        if (actualDistance < 0) {
-            // No path exists
-            continue;
+void ZoneCostPolicy::growMatrix(int minSlots) {
+    if (minSlots <= zoneSlots) {
+        return;
+    }
+
+    // New cells start from the default rule (0 same zone, default cross-zone)
+    int* newPenalties = new int[minSlots * minSlots];
+    for (int from = 0; from < minSlots; from++) {
+        for (int to = 0; to < minSlots; to++) {
+            if (from < zoneSlots && to < zoneSlots) {
+                newPenalties[from * minSlots + to] = penalties[from * zoneSlots + to];
+            } else {
+                newPenalties[from * minSlots + to] = (from == to) ? 0 : defaultPenalty;
+            }
         }
+    }
+
+    delete[] penalties;
+    penalties = newPenalties;
+    zoneSlots = minSlots;
+}
+
+void ZoneCostPolicy::setZonePenalty(int driverZone, int pickupZone, int percent) {
+    if (driverZone < 0 || pickupZone < 0 || percent < 0) {
+        cout << "Invalid zone penalty." << endl;
+        return;
+    }
+    int needed = (driverZone > pickupZone ? driverZone : pickupZone) + 1;
+    growMatrix(needed);
+    penalties[driverZone * zoneSlots + pickupZone] = percent;
+}
+
+void ZoneCostPolicy::setHourMultiplier(int hour, int percent) {
+    if (hour < 0 || hour >= HOURS_PER_DAY || percent < 0) {
+        cout << "Invalid hour multiplier." << endl;
+        return;
+    }
+    hourMultipliers[hour] = percent;
+}
+
+void ZoneCostPolicy::setCurrentHour(int hour) {
+    if (hour < 0 || hour >= HOURS_PER_DAY) {
+        cout << "Invalid hour." << endl;
+        return;
+    }
+    currentHour = hour;
+}
+
+int ZoneCostPolicy::getCurrentHour() const {
+    return currentHour;
+}
+
+// Candidate heap
+void CandidateHeap::siftUp(DriverCandidate* heap, int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!isWorse(heap[index], heap[parent])) break;
+
+        DriverCandidate temp = heap[index];
+        heap[index] = heap[parent];
+        heap[parent] = temp;
+        index = parent;
+    }
+}
+
+void CandidateHeap::siftDown(DriverCandidate* heap, int size, int index) {
+    while (true) {
+        int worst = index;
+        int left = 2 * index + 1;
+        int right = 2 * index + 2;
+
+        if (left < size && isWorse(heap[left], heap[worst])) worst = left;
+        if (right < size && isWorse(heap[right], heap[worst])) worst = right;
+        if (worst == index) break;
+
+        DriverCandidate temp = heap[index];
+        heap[index] = heap[worst];
+        heap[worst] = temp;
+        index = worst;
+    }
+}
+
+void CandidateHeap::sort(DriverCandidate* heap, int size) {
+    // Repeatedly move the worst to the end
+    for (int end = size - 1; end > 0; end--) {
+        DriverCandidate temp = heap[0];
+        heap[0] = heap[end];
+        heap[end] = temp;
+        siftDown(heap, end, 0);
+    }
+}
 
-        // Calculate effective distance with cross-zone penalty
-        int effectiveDistance = calculateEffectiveDistance(
-            actualDistance,
-            drivers[i].getZoneId(),
-            pickupZoneId
-        );
-
-        // Update nearest driver if this one is closer
-        if (effectiveDistance < minEffectiveDistance) {
-            minEffectiveDistance = effectiveDistance;
-            nearestDriverIndex = i;
+// Search frontier
+SearchFrontier::SearchFrontier(int initialCapacity)
+    : size(0), capacity(initialCapacity > 0 ? initialCapacity : 1) {
+    distances = new int[capacity];
+    locations = new int[capacity];
+}
+
+SearchFrontier::~SearchFrontier() {
+    delete[] distances;
+    delete[] locations;
+}
+
+void SearchFrontier::grow() {
+    int newCapacity = capacity * 2;
+    int* newDistances = new int[newCapacity];
+    int* newLocations = new int[newCapacity];
+    for (int i = 0; i < size; i++) {
+        newDistances[i] = distances[i];
+        newLocations[i] = locations[i];
+    }
+    delete[] distances;
+    delete[] locations;
+    distances = newDistances;
+    locations = newLocations;
+    capacity = newCapacity;
+}
+
+void SearchFrontier::push(int distance, int location) {
+    if (size >= capacity) {
+        grow();
+    }
+
+    // Sift up
+    int index = size++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (distances[parent] <= distance) break;
+        distances[index] = distances[parent];
+        locations[index] = locations[parent];
+        index = parent;
+    }
+    distances[index] = distance;
+    locations[index] = location;
+}
+
+bool SearchFrontier::pop(int& distance, int& location) {
+    if (size == 0) {
+        return false;
+    }
+    distance = distances[0];
+    location = locations[0];
+
+    // Sift the last entry down from the root
+    size--;
+    int lastDistance = distances[size];
+    int lastLocation = locations[size];
+    int index = 0;
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= size) break;
+        if (child + 1 < size && distances[child + 1] < distances[child]) child++;
+        if (lastDistance <= distances[child]) break;
+        distances[index] = distances[child];
+        locations[index] = locations[child];
+        index = child;
+    }
+    distances[index] = lastDistance;
+    locations[index] = lastLocation;
+    return true;
+}
+
+bool SearchFrontier::isEmpty() const {
+    return size == 0;
+}
+
+void SearchFrontier::clear() {
+    size = 0;
+}
+
+// Search scratch
+SearchScratch::SearchScratch()
+    : epoch(0), stamps(nullptr), firstDriver(nullptr), distances(nullptr), settled(nullptr),
+      locationCapacity(0), driverCapacity(0), nextDriver(nullptr), startZone(nullptr),
+      extraDistance(nullptr), nextFree(nullptr) {}
+
+SearchScratch::~SearchScratch() {
+    delete[] stamps;
+    delete[] firstDriver;
+    delete[] distances;
+    delete[] settled;
+    delete[] nextDriver;
+    delete[] startZone;
+    delete[] extraDistance;
+}
+
+void SearchScratch::begin(int locationCount, int driverCount) {
+    if (locationCount > locationCapacity) {
+        // Fresh arrays carry no stamps; the epoch restarts above zero
+        delete[] stamps;
+        delete[] firstDriver;
+        delete[] distances;
+        delete[] settled;
+        locationCapacity = locationCount * 2;
+        stamps = new unsigned int[locationCapacity]();
+        firstDriver = new int[locationCapacity];
+        distances = new int[locationCapacity];
+        settled = new bool[locationCapacity];
+        epoch = 0;
+    }
+    if (driverCount > driverCapacity) {
+        delete[] nextDriver;
+        delete[] startZone;
+        delete[] extraDistance;
+        driverCapacity = driverCount * 2;
+        nextDriver = new int[driverCapacity];
+        startZone = new int[driverCapacity];
+        extraDistance = new int[driverCapacity];
+    }
+
+    epoch++;
+    if (epoch == 0) {
+        // Wrapped: old stamps could match again, so clear them once
+        for (int v = 0; v < locationCapacity; v++) {
+            stamps[v] = 0;
         }
+        epoch = 1;
     }
+    frontier.clear();
+}
+
+// Search scratch pool
+SearchScratchPool::SearchScratchPool() : freeList(nullptr) {}
+
+SearchScratchPool::~SearchScratchPool() {
+    while (freeList) {
+        SearchScratch* next = freeList->nextFree;
+        delete freeList;
+        freeList = next;
+    }
+}
+
+SearchScratch* SearchScratchPool::acquire() {
+    {
+        lock_guard<mutex> guard(lock);
+        if (freeList) {
+            SearchScratch* scratch = freeList;
+            freeList = scratch->nextFree;
+            return scratch;
+        }
+    }
+    return new SearchScratch();
+}
 
-    return nearestDriverIndex;
+void SearchScratchPool::release(SearchScratch* scratch) {
+    lock_guard<mutex> guard(lock);
+    scratch->nextFree = freeList;
+    freeList = scratch;
 }
@@ -2,25 +2,460 @@
 #define DISPATCH_ENGINE_H
 
 #include "City.h"
-#include "Driver.h"
+#include "DriverTable.h"
 #include "Trip.h"
+#include "CandidateCache.h"
+#include "CapabilityIndex.h"
+#include <climits>
+#include <chrono>
+#include <mutex>
 
-class DispatchEngine {
+// Number of ranked candidates kept per dispatch search
+const int DISPATCH_CANDIDATE_COUNT = TRIP_CANDIDATE_CAPACITY;
+
+// Latency budget meaning "search until provably optimal"
+const int DISPATCH_NO_BUDGET = -1;
+
+// Drivers bucketed per settled location by the anytime search, so a tight
+// budget is not spent bucketing the whole fleet before the first road
+const int SEARCH_BUCKET_BATCH = 64;
+
+// Default cross-zone penalty (50% extra) and hours in the multiplier table
+const int DEFAULT_CROSS_ZONE_PENALTY = 50;
+const int HOURS_PER_DAY = 24;
+
+// A ranked dispatch candidate: driver index and its effective distance
+struct DriverCandidate {
+    int driverIndex;
+    int effectiveDistance;
+
+    DriverCandidate();
+    DriverCandidate(int driverIndex, int effectiveDistance);
+};
+
+// ==================== DISTANCE ORACLE POLICIES ====================
+// A distance oracle provides: int distance(int from, int to)
+// returning the road distance or -1 if unreachable.
+// The anytime search also needs the graph itself:
+// int locationCount() and const Edge* roads(int location).
+
+// Shortest-path distances straight from the city graph
+class CityDistanceOracle {
+private:
+    City* city;
+
+public:
+    explicit CityDistanceOracle(City* city = nullptr);
+
+    int distance(int from, int to) const {
+        return city->getDistance(from, to);
+    }
+
+    int locationCount() const {
+        return city->getLocationCount();
+    }
+
+    const Edge* roads(int location) const {
+        Location* loc = city->getLocation(location);
+        return loc ? loc->adjacencyList : nullptr;
+    }
+};
+
+// ==================== COST POLICIES ====================
+// A cost policy provides: int cost(int actualDistance, int driverZone, int pickupZone)
+// and must never return less than actualDistance (the anytime search
+// stops on that bound).
+
+// Per zone-pair penalty matrix (percent extra) scaled by an hour-of-day
+// multiplier, so e.g. crossing zones can cost more during rush hour
+class ZoneCostPolicy {
 private:
-    // Cross-zone penalty multiplier (50% extra)
-    static const int CROSS_ZONE_PENALTY = 50;
+    int* penalties;      // zoneSlots x zoneSlots, row = driver zone, column = pickup zone
+    int zoneSlots;       // Highest configured zone ID + 1
+    int defaultPenalty;  // Used for cross-zone pairs outside the matrix
+    int hourMultipliers[HOURS_PER_DAY];  // Percent applied to the penalty
+    int currentHour;
+
+    void growMatrix(int minSlots);
 
 public:
-    DispatchEngine();
+    ZoneCostPolicy(int defaultPenalty = DEFAULT_CROSS_ZONE_PENALTY);
+    ZoneCostPolicy(const ZoneCostPolicy& other);
+    ZoneCostPolicy& operator=(const ZoneCostPolicy& other);
+    ~ZoneCostPolicy();
+
+    // Configuration
+    void setZonePenalty(int driverZone, int pickupZone, int percent);
+    void setHourMultiplier(int hour, int percent);
+    void setCurrentHour(int hour);
+    int getCurrentHour() const;
+
+    int penaltyPercent(int driverZone, int pickupZone) const {
+        if (driverZone >= 0 && pickupZone >= 0 &&
+            driverZone < zoneSlots && pickupZone < zoneSlots) {
+            return penalties[driverZone * zoneSlots + pickupZone];
+        }
+        return (driverZone == pickupZone) ? 0 : defaultPenalty;
+    }
+
+    int cost(int actualDistance, int driverZone, int pickupZone) const {
+        int penalty = penaltyPercent(driverZone, pickupZone);
+        if (penalty == 0) {
+            return actualDistance;
+        }
+        return actualDistance +
+               (int)((long long)actualDistance * penalty * hourMultipliers[currentHour] / 10000);
+    }
+};
+
+// ==================== CANDIDATE HEAP ====================
+// Bounded max-heap helpers (worst candidate at the root)
+struct CandidateHeap {
+    // Larger distance is worse, ties broken by higher driver index so
+    // results match a plain linear scan
+    static bool isWorse(const DriverCandidate& a, const DriverCandidate& b) {
+        if (a.effectiveDistance != b.effectiveDistance) {
+            return a.effectiveDistance > b.effectiveDistance;
+        }
+        return a.driverIndex > b.driverIndex;
+    }
+
+    static void siftUp(DriverCandidate* heap, int index);
+    static void siftDown(DriverCandidate* heap, int size, int index);
+
+    // Insert while keeping only the k best; returns the new size
+    static int offer(DriverCandidate* heap, int size, int k, const DriverCandidate& candidate) {
+        if (size < k) {
+            heap[size] = candidate;
+            siftUp(heap, size);
+            return size + 1;
+        }
+        if (isWorse(heap[0], candidate)) {
+            // Replace the current worst of the k best
+            heap[0] = candidate;
+            siftDown(heap, size, 0);
+        }
+        return size;
+    }
+
+    // Heap sort in place, nearest first
+    static void sort(DriverCandidate* heap, int size);
+};
+
+// ==================== SEARCH FRONTIER ====================
+// Min-heap of (distance, location) for the anytime search. Stale entries
+// are skipped when popped instead of being decreased in place.
+class SearchFrontier {
+private:
+    int* distances;
+    int* locations;
+    int size;
+    int capacity;
+
+    void grow();
+
+public:
+    SearchFrontier(int initialCapacity = 16);
+    ~SearchFrontier();
+
+    SearchFrontier(const SearchFrontier&) = delete;
+    SearchFrontier& operator=(const SearchFrontier&) = delete;
+
+    void push(int distance, int location);
+    bool pop(int& distance, int& location);  // false when empty
+    bool isEmpty() const;
+    void clear();
+};
+
+// ==================== SEARCH SCRATCH ====================
+// Working memory for one anytime search, kept between searches. A location
+// entry counts only if stamped with the current epoch, so starting a search
+// is O(1) instead of clearing O(V) arrays. Driver entries are only read
+// after the same search wrote them.
+class SearchScratch {
+private:
+    unsigned int epoch;
+    unsigned int* stamps;  // Per location: epoch of the search that last touched it
+    int* firstDriver;      // Per location, valid when stamped
+    int* distances;
+    bool* settled;
+    int locationCapacity;
+
+    int driverCapacity;
+
+public:
+    // Per driver bucket entry: next driver at the same location, and the
+    // zone and extra distance read when it was bucketed
+    int* nextDriver;
+    int* startZone;
+    int* extraDistance;
+
+    SearchFrontier frontier;
+    SearchScratch* nextFree;  // Pool link
+
+    SearchScratch();
+    ~SearchScratch();
+
+    SearchScratch(const SearchScratch&) = delete;
+    SearchScratch& operator=(const SearchScratch&) = delete;
+
+    // Grow if needed, then invalidate every location entry in O(1)
+    void begin(int locationCount, int driverCount);
+
+    void touch(int location) {
+        if (stamps[location] != epoch) {
+            stamps[location] = epoch;
+            firstDriver[location] = -1;
+            distances[location] = INT_MAX;
+            settled[location] = false;
+        }
+    }
+    int& firstAt(int location) { touch(location); return firstDriver[location]; }
+    int& distanceAt(int location) { touch(location); return distances[location]; }
+    bool isSettled(int location) const {
+        return stamps[location] == epoch && settled[location];
+    }
+    void settle(int location) { touch(location); settled[location] = true; }
+};
+
+// Scratch blocks shared by every thread that searches: each search takes
+// one and hands it back, so a worker keeps reusing a warm block and
+// concurrent searches never share one
+class SearchScratchPool {
+private:
+    mutex lock;
+    SearchScratch* freeList;
+
+public:
+    SearchScratchPool();
+    ~SearchScratchPool();
+
+    SearchScratchPool(const SearchScratchPool&) = delete;
+    SearchScratchPool& operator=(const SearchScratchPool&) = delete;
+
+    SearchScratch* acquire();
+    void release(SearchScratch* scratch);
+};
+
+// ==================== DISPATCH ENGINE ====================
+// Both policies are template parameters, so each configuration compiles
+// to its own engine with the cost and distance calls inlined into the
+// candidate loop (no virtual dispatch).
+template <class CostPolicy, class DistanceOracle>
+class BasicDispatchEngine {
+private:
+    CostPolicy costPolicy;
+    DistanceOracle oracle;
+    SearchScratchPool scratchPool;
+
+public:
+    explicit BasicDispatchEngine(const DistanceOracle& oracle = DistanceOracle(),
+                                 const CostPolicy& costPolicy = CostPolicy())
+        : costPolicy(costPolicy), oracle(oracle) {}
+
+    CostPolicy& getCostPolicy() { return costPolicy; }
+    DistanceOracle& getDistanceOracle() { return oracle; }
 
     // Find nearest available driver to pickup location
     // Returns driver index or -1 if none available
     // pickupZoneId is used for cross-zone penalty calculation
-    int findNearestDriver(City& city, Driver* drivers, int driverCount,
-                          int pickupLocationId, int pickupZoneId);
+    int findNearestDriver(const DriverTable& fleet,
+                          int pickupLocationId, int pickupZoneId) {
+        DriverCandidate best;
+        int found = findNearestDrivers(fleet, pickupLocationId,
+                                       pickupZoneId, &best, 1);
+        return (found > 0) ? best.driverIndex : -1;
+    }
 
-    // Calculate effective distance (with cross-zone penalty)
-    int calculateEffectiveDistance(int actualDistance, int driverZone, int pickupZone);
+    // Find the k best available drivers in a single pass using a bounded
+    // max-heap of size k: O(D log k) comparisons on top of the distance queries.
+    // With includeFinishing, BUSY drivers on an ongoing trip also compete,
+    // scored from their dropoff: remaining distance + dropoff -> pickup.
+    // Fills candidates[] nearest-first and returns how many were found (<= k)
+    int findNearestDrivers(const DriverTable& fleet,
+                           int pickupLocationId, int pickupZoneId,
+                           DriverCandidate* candidates, int k,
+                           bool includeFinishing = false) {
+        if (k <= 0) {
+            return 0;
+        }
+
+        // candidates[] doubles as the heap storage
+        int heapSize = 0;
+        int driverCount = fleet.size();
+
+        for (int i = 0; i < driverCount; i++) {
+            int from;
+            int fromZone;
+            int extraDistance;
+            if (!fleet.startPointAt(i, includeFinishing, from, fromZone, extraDistance)) {
+                continue;
+            }
+
+            // A finishing driver completes the current trip first
+            int actualDistance = oracle.distance(from, pickupLocationId);
+            if (actualDistance < 0) {
+                // No path exists
+                continue;
+            }
+            actualDistance += extraDistance;
+
+            DriverCandidate candidate(i, costPolicy.cost(actualDistance, fromZone, pickupZoneId));
+            heapSize = CandidateHeap::offer(candidates, heapSize, k, candidate);
+        }
+
+        CandidateHeap::sort(candidates, heapSize);
+        return heapSize;
+    }
+
+    // Anytime search: one Dijkstra grown outward from the pickup (roads are
+    // two-way, so the settled distance is the driver -> pickup distance).
+    // Drivers are met in road-distance order and a cost is never below the
+    // road distance, so once the radius passes the k-th best cost nobody
+    // further out can do better and the result is provably optimal.
+    // budgetMicros caps the search time (DISPATCH_NO_BUDGET = none); when it
+    // runs out the best drivers met so far are returned with optimal = false.
+    // With a capability index and a required mask, only drivers in classes
+    // serving that mask are bucketed; the rest are never looked at.
+    int findNearestDriversWithin(const DriverTable& fleet,
+                                 int pickupLocationId, int pickupZoneId,
+                                 DriverCandidate* candidates, int k,
+                                 bool includeFinishing, long long budgetMicros,
+                                 bool& optimal,
+                                 const CapabilityIndex* classes = nullptr,
+                                 int requiredCapabilities = CAP_NONE) {
+        optimal = false;
+        int locationCount = oracle.locationCount();
+        if (k <= 0 || pickupLocationId < 0 || pickupLocationId >= locationCount) {
+            return 0;
+        }
+
+        // The budget covers the setup too: nothing below is O(V) or O(D)
+        // before the first clock check
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        int driverCount = fleet.size();
+        SearchScratch* scratch = scratchPool.acquire();
+        scratch->begin(locationCount, driverCount);
+        SearchFrontier& frontier = scratch->frontier;
+
+        int heapSize = 0;
+        // Drivers at a location are scored once it is settled; a driver
+        // bucketed after its location settled is scored on the spot, since
+        // the settled distance is final
+        auto bucket = [&](int i) {
+            int from;
+            if (!fleet.startPointAt(i, includeFinishing, from, scratch->startZone[i],
+                                    scratch->extraDistance[i])) {
+                return;
+            }
+            if (from >= locationCount) return;
+            if (scratch->isSettled(from)) {
+                int actualDistance = scratch->distanceAt(from) + scratch->extraDistance[i];
+                DriverCandidate candidate(i, costPolicy.cost(actualDistance, scratch->startZone[i],
+                                                             pickupZoneId));
+                heapSize = CandidateHeap::offer(candidates, heapSize, k, candidate);
+                return;
+            }
+            int& first = scratch->firstAt(from);
+            scratch->nextDriver[i] = first;
+            first = i;
+        };
+
+        // Bucket lazily, SEARCH_BUCKET_BATCH drivers per step, walking the
+        // capability classes that serve the request or else the fleet
+        bool filtered = classes && requiredCapabilities != CAP_NONE;
+        int nextClass = 0;
+        int nextIndex = filtered ? -1 : 0;
+        bool allBucketed = false;
+        auto bucketBatch = [&]() {
+            for (int done = 0; done < SEARCH_BUCKET_BATCH; done++) {
+                int i;
+                if (filtered) {
+                    while (nextIndex < 0 && nextClass < CAPABILITY_CLASS_COUNT) {
+                        if (CapabilityIndex::classServes(nextClass, requiredCapabilities)) {
+                            nextIndex = classes->firstInClass(nextClass);
+                        }
+                        nextClass++;
+                    }
+                    if (nextIndex < 0) {
+                        allBucketed = true;
+                        return;
+                    }
+                    i = nextIndex;
+                    nextIndex = classes->nextInClass(i);
+                    if (i >= driverCount) continue;
+                } else {
+                    if (nextIndex >= driverCount) {
+                        allBucketed = true;
+                        return;
+                    }
+                    i = nextIndex++;
+                }
+                bucket(i);
+            }
+        };
+
+        scratch->distanceAt(pickupLocationId) = 0;
+        frontier.push(0, pickupLocationId);
+
+        bool timedOut = false;
+        int steps = 0;
+        int radius;
+        int u;
+        while (true) {
+            // Every step after the first checks the clock, bucketing included
+            if (steps++ > 0 && budgetMicros >= 0 &&
+                chrono::steady_clock::now() - started > chrono::microseconds(budgetMicros)) {
+                timedOut = true;
+                break;
+            }
+            if (!allBucketed) {
+                bucketBatch();
+            }
+
+            if (!frontier.pop(radius, u)) {
+                if (allBucketed) break;  // Ran out of road: every reachable driver was seen
+                continue;                // Keep bucketing; the rest are unreachable
+            }
+            if (scratch->isSettled(u) || radius > scratch->distanceAt(u)) continue;
+
+            // Everyone unseen is at least radius away: the k best are final
+            if (allBucketed && heapSize == k && radius > candidates[0].effectiveDistance) {
+                break;
+            }
+            scratch->settle(u);
+
+            for (int i = scratch->firstAt(u); i >= 0; i = scratch->nextDriver[i]) {
+                // A finishing driver completes the current trip first
+                int actualDistance = radius + scratch->extraDistance[i];
+                DriverCandidate candidate(i, costPolicy.cost(actualDistance, scratch->startZone[i],
+                                                             pickupZoneId));
+                heapSize = CandidateHeap::offer(candidates, heapSize, k, candidate);
+            }
+
+            for (const Edge* edge = oracle.roads(u); edge != nullptr; edge = edge->next) {
+                int v = edge->destination;
+                if (!scratch->isSettled(v) && radius + edge->weight < scratch->distanceAt(v)) {
+                    scratch->distanceAt(v) = radius + edge->weight;
+                    frontier.push(radius + edge->weight, v);
+                }
+            }
+        }
+        optimal = !timedOut;
+
+        scratchPool.release(scratch);
+
+        CandidateHeap::sort(candidates, heapSize);
+        return heapSize;
+    }
+
+    // Calculate effective distance (with zone-pair penalty)
+    int calculateEffectiveDistance(int actualDistance, int driverZone, int pickupZone) const {
+        return costPolicy.cost(actualDistance, driverZone, pickupZone);
+    }
 };
 
+// Engine used by RideShareSystem: zone-pair penalties over city shortest paths
+typedef BasicDispatchEngine<ZoneCostPolicy, CityDistanceOracle> DispatchEngine;
+
 #endif
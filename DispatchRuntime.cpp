@@ -0,0 +1,191 @@
+#include "DispatchRuntime.h"
+#include "RideShareSystem.h"
+using namespace std;
+
+DispatchRequest::DispatchRequest(int tripId, int pickupLocationId, int pickupZoneId,
+                                 int requiredCapabilities,
+                                 DispatchCallback callback, void* context)
+    : tripId(tripId), pickupLocationId(pickupLocationId), pickupZoneId(pickupZoneId),
+      requiredCapabilities(requiredCapabilities), callback(callback), context(context), prev(nullptr), next(nullptr) {}
+
+DispatchShard::DispatchShard()
+    : zoneId(-1), head(nullptr), tail(nullptr), size(0) {}
+
+DispatchRuntime::DispatchRuntime(RideShareSystem* system, const int* zoneIds, int zoneCount)
+    : system(system), shardCount(zoneCount > 0 ? zoneCount : 1),
+      running(false), queuedCount(0) {
+    shards = new DispatchShard[shardCount];
+    for (int i = 0; i < zoneCount; i++) {
+        shards[i].zoneId = zoneIds[i];
+    }
+}
+
+DispatchRuntime::~DispatchRuntime() {
+    stop();
+
+    // Drop anything still queued
+    for (int i = 0; i < shardCount; i++) {
+        DispatchRequest* current = shards[i].head;
+        while (current != nullptr) {
+            DispatchRequest* next = current->next;
+            delete current;
+            current = next;
+        }
+    }
+    delete[] shards;
+}
+
+int DispatchRuntime::shardFor(int zoneId) const {
+    // Zones are few, so a linear lookup is cheaper than hashing
+    for (int i = 0; i < shardCount; i++) {
+        if (shards[i].zoneId == zoneId) {
+            return i;
+        }
+    }
+    // Zone added after startup: spread it over the existing shards
+    int index = zoneId % shardCount;
+    return (index < 0) ? index + shardCount : index;
+}
+
+void DispatchRuntime::start() {
+    if (running) {
+        return;
+    }
+    running = true;
+    for (int i = 0; i < shardCount; i++) {
+        shards[i].worker = thread(&DispatchRuntime::workerLoop, this, i);
+    }
+}
+
+void DispatchRuntime::stop() {
+    if (!running) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(idleLock);
+        running = false;
+    }
+    workAvailable.notify_all();
+    for (int i = 0; i < shardCount; i++) {
+        if (shards[i].worker.joinable()) {
+            shards[i].worker.join();
+        }
+    }
+}
+
+bool DispatchRuntime::isRunning() const {
+    return running;
+}
+
+void DispatchRuntime::submit(int tripId, int pickupLocationId, int pickupZoneId,
+                             int requiredCapabilities,
+                             DispatchCallback callback, void* context) {
+    DispatchRequest* request = new DispatchRequest(tripId, pickupLocationId, pickupZoneId,
+                                                   requiredCapabilities, callback, context);
+    DispatchShard& shard = shards[shardFor(pickupZoneId)];
+    {
+        lock_guard<mutex> guard(shard.lock);
+        request->prev = shard.tail;
+        if (shard.tail) {
+            shard.tail->next = request;
+        } else {
+            shard.head = request;
+        }
+        shard.tail = request;
+        shard.size++;
+    }
+    {
+        lock_guard<mutex> guard(idleLock);
+        queuedCount++;
+    }
+    workAvailable.notify_all();
+}
+
+DispatchRequest* DispatchRuntime::popLocal(int shardIndex) {
+    DispatchShard& shard = shards[shardIndex];
+    lock_guard<mutex> guard(shard.lock);
+
+    DispatchRequest* request = shard.head;
+    if (request == nullptr) {
+        return nullptr;
+    }
+    shard.head = request->next;
+    if (shard.head) {
+        shard.head->prev = nullptr;
+    } else {
+        shard.tail = nullptr;
+    }
+    shard.size--;
+    queuedCount--;
+    return request;
+}
+
+DispatchRequest* DispatchRuntime::steal(int thiefIndex) {
+    // Pick the busiest other shard; sizes are read without locking
+    int victim = -1;
+    int victimSize = 0;
+    for (int i = 0; i < shardCount; i++) {
+        if (i == thiefIndex) continue;
+        int size = shards[i].size.load();
+        if (size > victimSize) {
+            victimSize = size;
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return nullptr;
+    }
+
+    DispatchShard& shard = shards[victim];
+    lock_guard<mutex> guard(shard.lock);
+
+    DispatchRequest* request = shard.tail;
+    if (request == nullptr) {
+        return nullptr;  // Owner drained it first
+    }
+    shard.tail = request->prev;
+    if (shard.tail) {
+        shard.tail->next = nullptr;
+    } else {
+        shard.head = nullptr;
+    }
+    shard.size--;
+    queuedCount--;
+    return request;
+}
+
+void DispatchRuntime::workerLoop(int shardIndex) {
+    while (true) {
+        DispatchRequest* request = popLocal(shardIndex);
+        if (request == nullptr) {
+            request = steal(shardIndex);
+        }
+
+        if (request == nullptr) {
+            // Queues are drained before a stopping worker exits
+            unique_lock<mutex> guard(idleLock);
+            if (!running && queuedCount == 0) {
+                return;
+            }
+            workAvailable.wait(guard, [this] { return !running || queuedCount > 0; });
+            continue;
+        }
+
+        bool assigned = system->dispatchQueuedTrip(request->tripId,
+                                                   request->pickupLocationId,
+                                                   request->pickupZoneId,
+                                                   request->requiredCapabilities);
+        if (request->callback) {
+            request->callback(request->tripId, assigned, request->context);
+        }
+        delete request;
+    }
+}
+
+int DispatchRuntime::getShardCount() const {
+    return shardCount;
+}
+
+int DispatchRuntime::getQueuedCount() const {
+    return queuedCount;
+}
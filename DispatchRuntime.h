@@ -0,0 +1,81 @@
+#ifndef DISPATCH_RUNTIME_H
+#define DISPATCH_RUNTIME_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+using namespace std;
+
+class RideShareSystem;
+
+// Called by a worker once a queued trip has been dispatched
+typedef void (*DispatchCallback)(int tripId, bool assigned, void* context);
+
+// One queued dispatch request (node in a shard's doubly linked queue)
+struct DispatchRequest {
+    int tripId;
+    int pickupLocationId;
+    int pickupZoneId;
+    int requiredCapabilities;
+    DispatchCallback callback;
+    void* context;
+    DispatchRequest* prev;
+    DispatchRequest* next;
+
+    DispatchRequest(int tripId, int pickupLocationId, int pickupZoneId, int requiredCapabilities,
+                    DispatchCallback callback, void* context);
+};
+
+// Work queue owned by one zone. The owner pops oldest-first from the head;
+// thieves take the newest request from the tail.
+struct DispatchShard {
+    int zoneId;
+    DispatchRequest* head;
+    DispatchRequest* tail;
+    atomic<int> size;
+    mutex lock;
+    thread worker;
+
+    DispatchShard();
+};
+
+// Zone-sharded dispatch workers with work stealing.
+// Each zone gets one worker and one queue; a worker whose queue is empty
+// steals from the busiest other shard. Driver selection is made safe across
+// shards by Driver::tryClaim(), so workers never block each other while
+// searching.
+class DispatchRuntime {
+private:
+    RideShareSystem* system;
+    DispatchShard* shards;
+    int shardCount;
+
+    atomic<bool> running;
+    atomic<int> queuedCount;
+    mutex idleLock;
+    condition_variable workAvailable;
+
+    int shardFor(int zoneId) const;
+    DispatchRequest* popLocal(int shardIndex);
+    DispatchRequest* steal(int thiefIndex);
+    void workerLoop(int shardIndex);
+
+public:
+    // zoneIds[] lists the distinct zones, one shard is created per zone
+    DispatchRuntime(RideShareSystem* system, const int* zoneIds, int zoneCount);
+    ~DispatchRuntime();
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // Queue a trip on its pickup zone's shard
+    void submit(int tripId, int pickupLocationId, int pickupZoneId, int requiredCapabilities,
+                DispatchCallback callback, void* context);
+
+    int getShardCount() const;
+    int getQueuedCount() const;
+};
+
+#endif
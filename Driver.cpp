@@ -1,4 +1,4 @@
-#include "Driver.h"
+#include "DriverTable.h"
 #include <iostream>
 using namespace std;
 
@@ -9,85 +9,262 @@ const string DRIVER_STATUS_NAMES[] = {
     "Offline"     // 2 = DRIVER_OFFLINE
 };
 
-Driver::Driver()
-    : id(-1), name(""), currentLocationId(-1), zoneId(-1),
-      status(DRIVER_OFFLINE), totalTripsCompleted(0), totalDistanceCovered(0) {}
+// Lookup array for capability names (index = bit position)
+const string CAPABILITY_NAMES[] = {
+    "XL",          // bit 0 = CAP_XL
+    "Accessible",  // bit 1 = CAP_ACCESSIBLE
+    "Cargo"        // bit 2 = CAP_CARGO
+};
+
+string capabilitiesToString(int capabilities) {
+    if (capabilities == CAP_NONE) {
+        return "Standard";
+    }
+    string result;
+    for (int bit = 0; bit < CAPABILITY_COUNT; bit++) {
+        if (capabilities & (1 << bit)) {
+            if (!result.empty()) {
+                result += "+";
+            }
+            result += CAPABILITY_NAMES[bit];
+        }
+    }
+    return result;
+}
+
+Driver::Driver() : table(nullptr), slot(-1) {}
 
-Driver::Driver(int id, const string& name, int locationId, int zoneId)
-    : id(id), name(name), currentLocationId(locationId), zoneId(zoneId),
-      status(DRIVER_AVAILABLE), totalTripsCompleted(0), totalDistanceCovered(0) {}
+Driver::Driver(DriverTable* table, int slot) : table(table), slot(slot) {}
 
 int Driver::getId() const {
-    return id;
+    return table->profiles[slot].id;
 }
 
 string Driver::getName() const {
-    return name;
+    return table->names.get(table->profiles[slot].nameHandle);
 }
 
 int Driver::getCurrentLocationId() const {
-    return currentLocationId;
+    return table->locationAt(slot);
 }
 
 int Driver::getZoneId() const {
-    return zoneId;
+    return table->zoneAt(slot);
 }
 
 int Driver::getStatus() const {
-    return status;
+    return table->statusAt(slot);
+}
+
+DriverPosition Driver::getPosition() const {
+    return table->positionAt(slot);
 }
 
 int Driver::getTotalTripsCompleted() const {
-    return totalTripsCompleted;
+    return table->profiles[slot].totalTripsCompleted;
 }
 
 int Driver::getTotalDistanceCovered() const {
-    return totalDistanceCovered;
+    return table->profiles[slot].totalDistanceCovered;
+}
+
+int Driver::getCapabilities() const {
+    return table->capabilitiesAt(slot);
+}
+
+int Driver::getSeatCount() const {
+    return table->profiles[slot].seatCount;
+}
+
+bool Driver::hasCapabilities(int required) const {
+    return (table->capabilitiesAt(slot) & required) == required;
+}
+
+void Driver::setCapabilities(int mask) {
+    table->capabilities[slot].store((uint8_t)mask, memory_order_relaxed);
+}
+
+void Driver::setSeatCount(int seats) {
+    table->profiles[slot].seatCount = (uint8_t)seats;
+}
+
+// Rewrite some fields of the packed position in one release store (a CAS,
+// so a concurrent claim is never overwritten; it retries only if one raced in).
+// Returns the position written.
+template <typename Change>
+static DriverPosition updatePosition(atomic<uint64_t>& word, Change change) {
+    DriverPosition current = word.load(memory_order_relaxed);
+    DriverPosition next = change(current);
+    while (!word.compare_exchange_weak(current, next, memory_order_release,
+                                       memory_order_relaxed)) {
+        next = change(current);
+    }
+    return next;
 }
 
 void Driver::setCurrentLocationId(int locationId) {
-    currentLocationId = locationId;
+    updatePosition(table->positions[slot], [locationId](DriverPosition p) {
+        return packPosition(locationId, positionZone(p), positionStatus(p));
+    });
 }
 
 void Driver::setZoneId(int zone) {
-    zoneId = zone;
+    DriverPosition written = updatePosition(table->positions[slot], [zone](DriverPosition p) {
+        return packPosition(positionLocation(p), zone, positionStatus(p));
+    });
+    table->idleDrivers.update(slot, written);
 }
 
 void Driver::setStatus(int newStatus) {
-    status = newStatus;
+    DriverPosition written = updatePosition(table->positions[slot], [newStatus](DriverPosition p) {
+        return packPosition(positionLocation(p), positionZone(p), newStatus);
+    });
+    table->idleDrivers.update(slot, written);
+}
+
+void Driver::moveTo(int locationId, int zone) {
+    auto change = [locationId, zone](DriverPosition p) {
+        return packPosition(locationId, zone, positionStatus(p));
+    };
+    DriverPosition written = updatePosition(table->positions[slot], change);
+    table->idleDrivers.update(slot, written);
+}
+
+void Driver::setPosition(int locationId, int zone, int newStatus) {
+    DriverPosition written = updatePosition(table->positions[slot],
+                                            [locationId, zone, newStatus](DriverPosition) {
+        return packPosition(locationId, zone, newStatus);
+    });
+    table->idleDrivers.update(slot, written);
+}
+
+bool Driver::tryClaim() {
+    DriverPosition current = table->positions[slot].load(memory_order_acquire);
+    while (positionStatus(current) == DRIVER_AVAILABLE) {
+        DriverPosition claimed = packPosition(positionLocation(current), positionZone(current),
+                                              DRIVER_BUSY);
+        if (table->positions[slot].compare_exchange_weak(current, claimed, memory_order_acq_rel,
+                                                         memory_order_acquire)) {
+            table->idleDrivers.update(slot, claimed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Driver::releaseClaim() {
+    DriverPosition current = table->positions[slot].load(memory_order_acquire);
+    while (positionStatus(current) == DRIVER_BUSY) {
+        DriverPosition released = packPosition(positionLocation(current), positionZone(current),
+                                               DRIVER_AVAILABLE);
+        if (table->positions[slot].compare_exchange_weak(current, released, memory_order_acq_rel,
+                                                         memory_order_acquire)) {
+            table->idleDrivers.update(slot, released);
+            return true;
+        }
+    }
+    return false;
+}
+
+int Driver::getActiveTripId() const {
+    return table->activeTrips[slot];
+}
+
+int Driver::getQueuedTripId() const {
+    return table->queuedTrips[slot].load();
+}
+
+int Driver::getRemainingDistance() const {
+    return table->remainingAt(slot);
+}
+
+int Driver::getFinishLocationId() const {
+    return table->finishLocationAt(slot);
+}
+
+int Driver::getFinishZoneId() const {
+    return table->finishZoneAt(slot);
+}
+
+bool Driver::isFinishing() const {
+    return table->isFinishingAt(slot);
+}
+
+void Driver::setActiveTripId(int tripId) {
+    table->activeTrips[slot] = tripId;
+}
+
+void Driver::setQueuedTripId(int tripId) {
+    table->queuedTrips[slot].store(tripId);
+}
+
+bool Driver::tryQueueTrip(int tripId) {
+    int expected = -1;
+    return table->queuedTrips[slot].compare_exchange_strong(expected, tripId);
+}
+
+bool Driver::releaseQueuedTrip(int tripId) {
+    int expected = tripId;
+    return table->queuedTrips[slot].compare_exchange_strong(expected, -1);
+}
+
+void Driver::beginRoute(int finishLocation, int finishZone, int remaining) {
+    // Remaining distance last: a search that sees it also sees the finish
+    table->finishLocations[slot].store(finishLocation, memory_order_relaxed);
+    table->finishZones[slot].store(finishZone, memory_order_relaxed);
+    table->remainingDistances[slot].store(remaining, memory_order_release);
+}
+
+void Driver::setRemainingDistance(int remaining) {
+    table->remainingDistances[slot].store(remaining, memory_order_release);
+}
+
+void Driver::clearRoute() {
+    table->remainingDistances[slot].store(-1, memory_order_release);
+    table->finishLocations[slot].store(-1, memory_order_relaxed);
+    table->finishZones[slot].store(-1, memory_order_relaxed);
 }
 
 void Driver::completeTrip(int distance) {
-    totalTripsCompleted++;
-    totalDistanceCovered += distance;
+    table->profiles[slot].totalTripsCompleted++;
+    table->profiles[slot].totalDistanceCovered += distance;
 }
 
 void Driver::resetStats() {
-    totalTripsCompleted = 0;
-    totalDistanceCovered = 0;
+    table->profiles[slot].totalTripsCompleted = 0;
+    table->profiles[slot].totalDistanceCovered = 0;
 }
 
 void Driver::setTotalTripsCompleted(int count) {
-    totalTripsCompleted = count;
+    table->profiles[slot].totalTripsCompleted = count;
 }
 
 void Driver::setTotalDistanceCovered(int distance) {
-    totalDistanceCovered = distance;
+    table->profiles[slot].totalDistanceCovered = distance;
 }
 
 string Driver::getStatusString() const {
     // Use lookup array instead of switch
-    if (status >= 0 && status < DRIVER_STATUS_COUNT) {
-        return DRIVER_STATUS_NAMES[status];
+    int current = getStatus();
+    if (current >= 0 && current < DRIVER_STATUS_COUNT) {
+        return DRIVER_STATUS_NAMES[current];
     }
     return "Unknown";
 }
 
 void Driver::display() const {
-    cout << "Driver " << id << ": " << name
-         << " | Location: " << currentLocationId
-         << " | Zone: " << zoneId
+    const DriverProfile& profile = table->profiles[slot];
+    cout << "Driver " << profile.id << ": " << table->names.get(profile.nameHandle)
+         << " | Location: " << getCurrentLocationId()
+         << " | Zone: " << getZoneId()
          << " | Status: " << getStatusString()
-         << " | Trips: " << totalTripsCompleted
-         << " | Distance: " << totalDistanceCovered << endl;
+         << " | Trips: " << profile.totalTripsCompleted
+         << " | Distance: " << profile.totalDistanceCovered;
+    if (getCapabilities() != CAP_NONE) {
+        cout << " | Vehicle: " << capabilitiesToString(getCapabilities());
+    }
+    if (getQueuedTripId() >= 0) {
+        cout << " | Next Trip: " << getQueuedTripId();
+    }
+    cout << endl;
 }
@@ -2,6 +2,7 @@
 #define DRIVER_H
 
 #include <string>
+#include <cstdint>
 using namespace std;
 
 // Driver Status Constants (instead of enum)
@@ -13,19 +14,49 @@ const int DRIVER_STATUS_COUNT = 3;
 // Lookup array for status names (declared in Driver.cpp)
 extern const string DRIVER_STATUS_NAMES[];
 
+// A driver's location, zone and status packed into one word, so readers get
+// all three from the same instant with a single atomic load:
+// bits 0-31 location, 32-55 zone (signed), 56-63 status
+typedef uint64_t DriverPosition;
+
+inline DriverPosition packPosition(int location, int zone, int status) {
+    return (uint64_t)(uint32_t)location | ((uint64_t)((uint32_t)zone & 0xFFFFFF) << 32) |
+           ((uint64_t)(uint8_t)status << 56);
+}
+inline int positionLocation(DriverPosition position) { return (int)(int32_t)(uint32_t)position; }
+inline int positionZone(DriverPosition position) {
+    int zone = (int)((position >> 32) & 0xFFFFFF);
+    return (zone & 0x800000) ? zone - 0x1000000 : zone;
+}
+inline int positionStatus(DriverPosition position) { return (int)(position >> 56); }
+
+// Vehicle capability flags (bitmask); a trip lists the ones it requires
+const int CAP_NONE = 0;
+const int CAP_XL = 1;          // Large vehicle
+const int CAP_ACCESSIBLE = 2;  // Wheelchair accessible
+const int CAP_CARGO = 4;       // Cargo / extra luggage space
+const int CAPABILITY_COUNT = 3;
+const int CAP_ALL = (1 << CAPABILITY_COUNT) - 1;  // Every defined bit; anything else is invalid
+
+// Lookup array for capability names, one per bit (declared in Driver.cpp)
+extern const string CAPABILITY_NAMES[];
+
+const int DEFAULT_SEAT_COUNT = 4;
+
+string capabilitiesToString(int capabilities);
+
+class DriverTable;
+
+// View of one driver's row in a DriverTable (see DriverTable.h). Copies
+// refer to the same driver; the data lives in the table's columns.
 class Driver {
 private:
-    int id;
-    string name;
-    int currentLocationId;
-    int zoneId;
-    int status;  // Using int instead of enum
-    int totalTripsCompleted;
-    int totalDistanceCovered;
+    DriverTable* table;
+    int slot;
 
 public:
-    Driver();
-    Driver(int id, const string& name, int locationId, int zoneId);
+    Driver();  // Detached view
+    Driver(DriverTable* table, int slot);
 
     // Getters
     int getId() const;
@@ -33,13 +64,41 @@ public:
     int getCurrentLocationId() const;
     int getZoneId() const;
     int getStatus() const;  // Returns int instead of enum
+    DriverPosition getPosition() const;  // Location, zone and status in one read
     int getTotalTripsCompleted() const;
     int getTotalDistanceCovered() const;
+    int getCapabilities() const;
+    int getSeatCount() const;
+    bool hasCapabilities(int required) const;
 
     // Setters
     void setCurrentLocationId(int locationId);
     void setZoneId(int zone);
     void setStatus(int newStatus);  // Takes int instead of enum
+    void moveTo(int locationId, int zone);  // Location and zone in one store
+    void setPosition(int locationId, int zone, int newStatus);  // All three in one store
+    void setCapabilities(int mask);
+    void setSeatCount(int seats);
+
+    // Atomically move AVAILABLE -> BUSY; false if another thread got there first
+    bool tryClaim();
+    // Hand a claim back (BUSY -> AVAILABLE) when the trip it was for moved on
+    bool releaseClaim();
+
+    // Forward dispatch
+    int getActiveTripId() const;
+    int getQueuedTripId() const;
+    int getRemainingDistance() const;
+    int getFinishLocationId() const;
+    int getFinishZoneId() const;
+    bool isFinishing() const;  // BUSY on an ongoing trip with no next trip queued
+    void setActiveTripId(int tripId);
+    void setQueuedTripId(int tripId);
+    bool tryQueueTrip(int tripId);  // Atomically claim the empty next-trip slot
+    bool releaseQueuedTrip(int tripId);  // Empty the slot if it still holds tripId
+    void beginRoute(int finishLocation, int finishZone, int remaining);
+    void setRemainingDistance(int remaining);
+    void clearRoute();
 
     // Operations
     void completeTrip(int distance);
@@ -54,4 +113,18 @@ public:
     string getStatusString() const;
 };
 
+// Copy of one driver's fields, for readers outside the commit section
+struct DriverSnapshot {
+    int id;
+    string name;
+    int locationId;
+    int zoneId;
+    int status;
+    int tripsCompleted;
+    int distanceCovered;
+    int queuedTripId;
+    int capabilities;
+    int seatCount;
+};
+
 #endif
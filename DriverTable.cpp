@@ -0,0 +1,104 @@
+#include "DriverTable.h"
+using namespace std;
+
+DriverProfile::DriverProfile(int id, uint32_t nameHandle)
+    : id(id), nameHandle(nameHandle), totalTripsCompleted(0), totalDistanceCovered(0),
+      seatCount(DEFAULT_SEAT_COUNT) {}
+
+DriverTable::DriverTable(int initialCapacity)
+    : profiles(initialCapacity), views(initialCapacity),
+      capacity(initialCapacity > 0 ? initialCapacity : 1), idleDrivers(initialCapacity) {
+    positions = new atomic<uint64_t>[capacity];
+    queuedTrips = new atomic<int>[capacity];
+    activeTrips = new int[capacity];
+    remainingDistances = new atomic<int>[capacity];
+    finishLocations = new atomic<int>[capacity];
+    finishZones = new atomic<int>[capacity];
+    capabilities = new atomic<uint8_t>[capacity];
+}
+
+DriverTable::~DriverTable() {
+    delete[] positions;
+    delete[] queuedTrips;
+    delete[] activeTrips;
+    delete[] remainingDistances;
+    delete[] finishLocations;
+    delete[] finishZones;
+    delete[] capabilities;
+}
+
+void DriverTable::grow(int minCapacity) {
+    int newCapacity = capacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+    int count = views.size();
+
+    atomic<uint64_t>* newPositions = new atomic<uint64_t>[newCapacity];
+    atomic<int>* newQueued = new atomic<int>[newCapacity];
+    int* newActive = new int[newCapacity];
+    atomic<int>* newRemaining = new atomic<int>[newCapacity];
+    atomic<int>* newFinishLocations = new atomic<int>[newCapacity];
+    atomic<int>* newFinishZones = new atomic<int>[newCapacity];
+    atomic<uint8_t>* newCapabilities = new atomic<uint8_t>[newCapacity];
+    for (int i = 0; i < count; i++) {
+        newPositions[i].store(positions[i].load());
+        newQueued[i].store(queuedTrips[i].load());
+        newActive[i] = activeTrips[i];
+        newRemaining[i].store(remainingDistances[i].load());
+        newFinishLocations[i].store(finishLocations[i].load());
+        newFinishZones[i].store(finishZones[i].load());
+        newCapabilities[i].store(capabilities[i].load());
+    }
+
+    delete[] positions;
+    delete[] queuedTrips;
+    delete[] activeTrips;
+    delete[] remainingDistances;
+    delete[] finishLocations;
+    delete[] finishZones;
+    delete[] capabilities;
+    positions = newPositions;
+    queuedTrips = newQueued;
+    activeTrips = newActive;
+    remainingDistances = newRemaining;
+    finishLocations = newFinishLocations;
+    finishZones = newFinishZones;
+    capabilities = newCapabilities;
+    capacity = newCapacity;
+
+    profiles.reserve(newCapacity);
+    views.reserve(newCapacity);
+}
+
+void DriverTable::reserve(int driverCapacity) {
+    if (driverCapacity > capacity) {
+        grow(driverCapacity);
+    }
+}
+
+int DriverTable::add(int id, const string& name, int locationId, int zoneId) {
+    int slot = views.size();
+    if (slot >= capacity) {
+        grow(slot + 1);
+    }
+
+    positions[slot].store(packPosition(locationId, zoneId, DRIVER_AVAILABLE));
+    idleDrivers.update(slot, positions[slot].load());
+    queuedTrips[slot].store(-1);
+    activeTrips[slot] = -1;
+    remainingDistances[slot].store(-1);
+    finishLocations[slot].store(-1);
+    finishZones[slot].store(-1);
+    capabilities[slot].store(CAP_NONE);
+    profiles.emplace(id, names.intern(name));
+    views.emplace(this, slot);
+    return slot;
+}
+
+int DriverTable::getBytesPerDriver() {
+    return (int)(sizeof(atomic<uint64_t>) +                   // Hot
+                 sizeof(atomic<int>) * 4 + sizeof(int) +      // Route
+                 sizeof(atomic<uint8_t>) +                    // Capabilities
+                 sizeof(DriverProfile) + sizeof(Driver));
+}
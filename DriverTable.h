@@ -0,0 +1,119 @@
+#ifndef DRIVER_TABLE_H
+#define DRIVER_TABLE_H
+
+#include "Driver.h"
+#include "GrowableArray.h"
+#include "NameTable.h"
+#include "ZoneIdleIndex.h"
+#include <atomic>
+#include <cstdint>
+
+// Per-driver data read by displays and analytics only. The name is a
+// handle into the table's NameTable (a string inline would be 32 bytes).
+struct DriverProfile {
+    int32_t id;
+    uint32_t nameHandle;
+    int32_t totalTripsCompleted;
+    int32_t totalDistanceCovered;
+    uint8_t seatCount;
+
+    DriverProfile(int id, uint32_t nameHandle);
+};
+
+// Fleet storage as parallel columns (struct of arrays), indexed by slot.
+// Fleet scans read only the hot column (status, location and zone packed
+// in one atomic word), so a pass over every driver streams 8 bytes per
+// driver instead of whole objects with names and stats. Route columns are read when a
+// scan includes finishing drivers; everything else sits in the profiles.
+// Driver objects are views (table + slot) over these columns.
+class DriverTable {
+private:
+    // Hot: every fleet scan. One word per driver so dispatch workers read a
+    // consistent triple without locks and claim a driver with one CAS.
+    atomic<uint64_t>* positions;  // DriverPosition
+
+    // Route: forward dispatch and matching. Everything the unlocked search
+    // reads is atomic; a route is published by storing the remaining
+    // distance last and withdrawn by clearing it first.
+    atomic<int>* queuedTrips;   // Next trip, accepted while finishing the active one
+    int* activeTrips;           // Trip assigned to or being driven (-1 if none)
+    atomic<int>* remainingDistances;  // Distance left on the ongoing trip (-1 if not driving)
+    atomic<int>* finishLocations;
+    atomic<int>* finishZones;
+    atomic<uint8_t>* capabilities;    // CAP_* bitmask
+
+    // Cold
+    GrowableArray<DriverProfile> profiles;
+    NameTable names;
+
+    GrowableArray<Driver> views;
+    int capacity;  // Of the column arrays
+
+    // AVAILABLE drivers by zone, kept in step by every position write
+    ZoneIdleIndex idleDrivers;
+
+    void grow(int minCapacity);
+
+public:
+    DriverTable(int initialCapacity = 10);
+    ~DriverTable();
+
+    DriverTable(const DriverTable&) = delete;
+    DriverTable& operator=(const DriverTable&) = delete;
+
+    // Append an AVAILABLE driver; returns its slot. Growth moves the
+    // columns, so drivers are added before dispatch workers start.
+    int add(int id, const string& name, int locationId, int zoneId);
+    void reserve(int driverCapacity);
+
+    int size() const { return views.size(); }
+    // Fixed bytes per driver: one entry in every column, the profile and
+    // the view (interned names are shared and not included)
+    static int getBytesPerDriver();
+    int getDistinctNameCount() const { return names.size(); }
+    const ZoneIdleIndex& idleByZone() const { return idleDrivers; }
+    Driver* at(int slot) { return &views[slot]; }
+    const Driver* at(int slot) const { return &views[slot]; }
+
+    // Hot column reads for scans (no bounds checks). Each call is its own
+    // load; read positionAt once when fields must agree.
+    DriverPosition positionAt(int slot) const { return positions[slot].load(memory_order_acquire); }
+    int statusAt(int slot) const { return positionStatus(positionAt(slot)); }
+    int locationAt(int slot) const { return positionLocation(positionAt(slot)); }
+    int zoneAt(int slot) const { return positionZone(positionAt(slot)); }
+    int remainingAt(int slot) const { return remainingDistances[slot].load(memory_order_acquire); }
+    int finishLocationAt(int slot) const { return finishLocations[slot].load(memory_order_relaxed); }
+    int finishZoneAt(int slot) const { return finishZones[slot].load(memory_order_relaxed); }
+    int capabilitiesAt(int slot) const { return capabilities[slot].load(memory_order_relaxed); }
+    bool isFinishingAt(int slot) const {
+        return statusAt(slot) == DRIVER_BUSY && remainingAt(slot) >= 0 &&
+               queuedTrips[slot].load() < 0;
+    }
+    // Where a driver would start a new trip from, taken from one position
+    // load: an AVAILABLE driver's own place (extra 0), or with
+    // includeFinishing a finishing driver's dropoff plus the distance still
+    // to drive. False if the driver qualifies for neither.
+    bool startPointAt(int slot, bool includeFinishing,
+                      int& location, int& zone, int& extraDistance) const {
+        DriverPosition position = positionAt(slot);
+        if (positionStatus(position) == DRIVER_AVAILABLE) {
+            location = positionLocation(position);
+            zone = positionZone(position);
+            extraDistance = 0;
+            return true;
+        }
+        if (!includeFinishing || positionStatus(position) != DRIVER_BUSY ||
+            queuedTrips[slot].load() >= 0) {
+            return false;
+        }
+        // Remaining is stored last by beginRoute and cleared first by clearRoute
+        extraDistance = remainingAt(slot);
+        location = finishLocationAt(slot);
+        zone = finishZoneAt(slot);
+        return extraDistance >= 0 && location >= 0;
+    }
+
+    friend class Driver;
+};
+
+#endif
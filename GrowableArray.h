@@ -0,0 +1,93 @@
+#ifndef GROWABLE_ARRAY_H
+#define GROWABLE_ARRAY_H
+
+#include <new>
+#include <utility>
+using namespace std;
+
+// Append-only array over raw storage. Only live slots hold constructed
+// elements; growth move-constructs them into the new buffer (strings and
+// owned lists are handed over, not copied) and destroys the old ones.
+// Capacity doubles, and reserve() lets callers grow once up front.
+// Growth moves elements, so pointers into the array are invalidated.
+template <typename T>
+class GrowableArray {
+private:
+    T* items;
+    int count;
+    int capacity;
+
+    void relocate(int newCapacity) {
+        T* fresh = static_cast<T*>(::operator new(sizeof(T) * newCapacity));
+        for (int i = 0; i < count; i++) {
+            new (&fresh[i]) T(move(items[i]));
+            items[i].~T();
+        }
+        ::operator delete(items);
+        items = fresh;
+        capacity = newCapacity;
+    }
+
+public:
+    explicit GrowableArray(int initialCapacity = 0) : items(nullptr), count(0), capacity(0) {
+        if (initialCapacity > 0) {
+            relocate(initialCapacity);
+        }
+    }
+
+    ~GrowableArray() {
+        clear();
+        ::operator delete(items);
+    }
+
+    GrowableArray(const GrowableArray&) = delete;
+    GrowableArray& operator=(const GrowableArray&) = delete;
+
+    // Make room for at least minCapacity elements in one step
+    void reserve(int minCapacity) {
+        if (minCapacity > capacity) {
+            relocate(minCapacity);
+        }
+    }
+
+    // Construct a new last element in place; returns its index
+    template <typename... Args>
+    int emplace(Args&&... args) {
+        if (count >= capacity) {
+            relocate(capacity > 0 ? capacity * 2 : 4);
+        }
+        new (&items[count]) T(forward<Args>(args)...);
+        return count++;
+    }
+
+    // Move the last element into index and drop the last slot (order not kept)
+    void swapRemove(int index) {
+        if (index != count - 1) {
+            items[index] = move(items[count - 1]);
+        }
+        popBack();
+    }
+
+    void popBack() {
+        if (count > 0) {
+            items[--count].~T();
+        }
+    }
+
+    void clear() {
+        while (count > 0) {
+            items[--count].~T();
+        }
+    }
+
+    T& operator[](int index) { return items[index]; }
+    const T& operator[](int index) const { return items[index]; }
+    T& back() { return items[count - 1]; }
+    const T& back() const { return items[count - 1]; }
+
+    int size() const { return count; }
+    int getCapacity() const { return capacity; }
+    bool isEmpty() const { return count == 0; }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "HandleTable.h"
+using namespace std;
+
+HandleTable::HandleTable(int initialCapacity)
+    : capacity(initialCapacity > 0 ? initialCapacity : 1),
+      slotCount(0), freeHead(-1), liveCount(0), issued(0) {
+    generations = new int[capacity];
+    targets = new int[capacity];
+    nextFree = new int[capacity];
+    sequences = new int[capacity];
+}
+
+HandleTable::~HandleTable() {
+    delete[] generations;
+    delete[] targets;
+    delete[] nextFree;
+    delete[] sequences;
+}
+
+void HandleTable::grow() {
+    int newCapacity = capacity * 2;
+    if (newCapacity > HANDLE_SLOT_MASK + 1) {
+        newCapacity = HANDLE_SLOT_MASK + 1;
+    }
+
+    int* newGenerations = new int[newCapacity];
+    int* newTargets = new int[newCapacity];
+    int* newNextFree = new int[newCapacity];
+    int* newSequences = new int[newCapacity];
+    for (int i = 0; i < slotCount; i++) {
+        newGenerations[i] = generations[i];
+        newTargets[i] = targets[i];
+        newNextFree[i] = nextFree[i];
+        newSequences[i] = sequences[i];
+    }
+
+    delete[] generations;
+    delete[] targets;
+    delete[] nextFree;
+    delete[] sequences;
+    generations = newGenerations;
+    targets = newTargets;
+    nextFree = newNextFree;
+    sequences = newSequences;
+    capacity = newCapacity;
+}
+
+int HandleTable::acquire(int target) {
+    int slot;
+    if (freeHead >= 0) {
+        slot = freeHead;
+        freeHead = nextFree[slot];
+    } else {
+        if (slotCount > HANDLE_SLOT_MASK) {
+            return -1;
+        }
+        if (slotCount >= capacity) {
+            grow();
+        }
+        slot = slotCount++;
+        generations[slot] = 0;
+    }
+
+    targets[slot] = target;
+    nextFree[slot] = -1;
+    sequences[slot] = issued++;
+    liveCount++;
+    return (generations[slot] << HANDLE_SLOT_BITS) | slot;
+}
+
+bool HandleTable::release(int handle) {
+    if (!isLive(handle)) {
+        return false;
+    }
+
+    int slot = handleSlot(handle);
+    targets[slot] = -1;
+    liveCount--;
+
+    // Retire the slot instead of wrapping its generation
+    if (generations[slot] + 1 < HANDLE_GENERATION_LIMIT) {
+        generations[slot]++;
+        nextFree[slot] = freeHead;
+        freeHead = slot;
+    }
+    return true;
+}
+
+bool HandleTable::update(int handle, int target) {
+    if (!isLive(handle)) {
+        return false;
+    }
+    targets[handleSlot(handle)] = target;
+    return true;
+}
+
+int HandleTable::getBytesPerSlot() {
+    return (int)(sizeof(int) * 4);  // Generation, target, free link, sequence
+}
+
+int HandleTable::find(int handle) const {
+    return isLive(handle) ? targets[handleSlot(handle)] : -1;
+}
+
+bool HandleTable::isLive(int handle) const {
+    if (handle < 0) {
+        return false;
+    }
+    int slot = handleSlot(handle);
+    return slot < slotCount && generations[slot] == handleGeneration(handle) &&
+           targets[slot] >= 0;
+}
+
+int HandleTable::getSequence(int handle) const {
+    return isLive(handle) ? sequences[handleSlot(handle)] : -1;
+}
+
+int HandleTable::size() const {
+    return liveCount;
+}
+
+int HandleTable::getSlotCount() const {
+    return slotCount;
+}
@@ -0,0 +1,54 @@
+#ifndef HANDLE_TABLE_H
+#define HANDLE_TABLE_H
+
+// A handle is (generation << HANDLE_SLOT_BITS) | slot. Slots are reused
+// through a free list; each reuse bumps the slot's generation, so a handle
+// kept after its entity was deleted no longer matches and is detected as
+// stale instead of silently naming the entity now in that slot.
+const int HANDLE_SLOT_BITS = 22;
+const int HANDLE_SLOT_MASK = (1 << HANDLE_SLOT_BITS) - 1;
+const int HANDLE_GENERATION_LIMIT = 1 << (31 - HANDLE_SLOT_BITS);  // Handles stay non-negative
+
+inline int handleSlot(int handle) { return handle & HANDLE_SLOT_MASK; }
+inline int handleGeneration(int handle) { return handle >> HANDLE_SLOT_BITS; }
+
+// Generational handles mapping to a target (an array position).
+// acquire, release, find and update are O(1). A slot whose generation
+// would wrap is retired rather than reused, so no handle is ever issued
+// twice and old handles (e.g. of archived trips) stay unambiguous.
+class HandleTable {
+private:
+    int* generations;
+    int* targets;    // Array position, -1 while the slot is free
+    int* nextFree;   // Free-list link, -1 at the end
+    int* sequences;  // Issue order of the slot's current handle
+    int capacity;
+    int slotCount;   // Slots ever handed out
+    int freeHead;
+    int liveCount;
+    int issued;  // Handles handed out so far
+
+    void grow();
+
+public:
+    HandleTable(int initialCapacity = 32);
+    ~HandleTable();
+
+    HandleTable(const HandleTable&) = delete;
+    HandleTable& operator=(const HandleTable&) = delete;
+
+    int acquire(int target);  // New handle, -1 if every slot is in use or retired
+    bool release(int handle);  // False if stale
+    bool update(int handle, int target);
+    int find(int handle) const;  // Target, or -1 if stale or unknown
+    bool isLive(int handle) const;
+    // Position of a live handle in issue order (-1 if stale); handles
+    // themselves are not ordered once slots are reused
+    int getSequence(int handle) const;
+
+    int size() const;  // Live handles
+    int getSlotCount() const;
+    static int getBytesPerSlot();
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "IdIndex.h"
+using namespace std;
+
+IdIndex::IdIndex(int initialCapacity)
+    : capacity(8), liveCount(0), usedCount(0) {
+    while (capacity < initialCapacity) {
+        capacity *= 2;
+    }
+    keys = new int[capacity];
+    slots = new int[capacity];
+    for (int i = 0; i < capacity; i++) {
+        keys[i] = ID_INDEX_EMPTY;
+    }
+}
+
+IdIndex::~IdIndex() {
+    delete[] keys;
+    delete[] slots;
+}
+
+int IdIndex::probeStart(int id) const {
+    // Fibonacci hashing spreads sequential IDs across the table
+    unsigned int h = (unsigned int)id * 2654435769u;
+    return (int)(h ^ (h >> 16)) & (capacity - 1);
+}
+
+int IdIndex::findPosition(int id) const {
+    int pos = probeStart(id);
+    while (keys[pos] != ID_INDEX_EMPTY) {
+        if (keys[pos] == id) {
+            return pos;
+        }
+        pos = (pos + 1) & (capacity - 1);
+    }
+    return -1;
+}
+
+void IdIndex::rehash(int newCapacity) {
+    int* oldKeys = keys;
+    int* oldSlots = slots;
+    int oldCapacity = capacity;
+
+    capacity = newCapacity;
+    keys = new int[capacity];
+    slots = new int[capacity];
+    for (int i = 0; i < capacity; i++) {
+        keys[i] = ID_INDEX_EMPTY;
+    }
+
+    // Tombstones are dropped here
+    for (int i = 0; i < oldCapacity; i++) {
+        if (oldKeys[i] < 0) continue;
+        int pos = probeStart(oldKeys[i]);
+        while (keys[pos] != ID_INDEX_EMPTY) {
+            pos = (pos + 1) & (capacity - 1);
+        }
+        keys[pos] = oldKeys[i];
+        slots[pos] = oldSlots[i];
+    }
+    usedCount = liveCount;
+
+    delete[] oldKeys;
+    delete[] oldSlots;
+}
+
+void IdIndex::insert(int id, int slot) {
+    if (id < 0) {
+        return;
+    }
+
+    int pos = findPosition(id);
+    if (pos >= 0) {
+        slots[pos] = slot;
+        return;
+    }
+
+    if ((usedCount + 1) * 4 > capacity * 3) {
+        // Mostly tombstones: clean up in place instead of growing
+        rehash((liveCount + 1) * 2 > capacity ? capacity * 2 : capacity);
+    }
+
+    // Reuse the first tombstone or empty cell on the probe path
+    pos = probeStart(id);
+    while (keys[pos] >= 0) {
+        pos = (pos + 1) & (capacity - 1);
+    }
+    if (keys[pos] == ID_INDEX_EMPTY) {
+        usedCount++;
+    }
+    keys[pos] = id;
+    slots[pos] = slot;
+    liveCount++;
+}
+
+bool IdIndex::remove(int id) {
+    int pos = (id >= 0) ? findPosition(id) : -1;
+    if (pos < 0) {
+        return false;
+    }
+    keys[pos] = ID_INDEX_REMOVED;
+    liveCount--;
+    return true;
+}
+
+int IdIndex::find(int id) const {
+    int pos = (id >= 0) ? findPosition(id) : -1;
+    return (pos >= 0) ? slots[pos] : -1;
+}
+
+int IdIndex::size() const {
+    return liveCount;
+}
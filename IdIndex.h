@@ -0,0 +1,39 @@
+#ifndef ID_INDEX_H
+#define ID_INDEX_H
+
+const int ID_INDEX_EMPTY = -1;
+const int ID_INDEX_REMOVED = -2;
+
+// Maps an entity ID to its slot in a storage array.
+// Open addressing with linear probing over a power-of-two table; removed
+// keys leave a tombstone so later probes keep going. The table doubles
+// when live keys plus tombstones pass 3/4 of it, so insert, find and
+// remove are O(1) expected.
+class IdIndex {
+private:
+    int* keys;    // ID_INDEX_EMPTY, ID_INDEX_REMOVED or an ID (>= 0)
+    int* slots;
+    int capacity;
+    int liveCount;
+    int usedCount;  // Live keys + tombstones
+
+    int probeStart(int id) const;
+    int findPosition(int id) const;  // -1 if absent
+    void rehash(int newCapacity);
+
+public:
+    IdIndex(int initialCapacity = 32);
+    ~IdIndex();
+
+    IdIndex(const IdIndex&) = delete;
+    IdIndex& operator=(const IdIndex&) = delete;
+
+    // Add or overwrite the slot for id (ids must be non-negative)
+    void insert(int id, int slot);
+    bool remove(int id);
+    int find(int id) const;  // Slot, or -1 if not indexed
+
+    int size() const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "NameTable.h"
+using namespace std;
+
+NameTable::NameTable(int initialCapacity) : names(initialCapacity), capacity(16) {
+    while (capacity < initialCapacity * 2) {
+        capacity *= 2;
+    }
+    buckets = new int[capacity];
+    for (int i = 0; i < capacity; i++) {
+        buckets[i] = -1;
+    }
+}
+
+NameTable::~NameTable() {
+    delete[] buckets;
+}
+
+unsigned int NameTable::hashName(const string& name) {
+    // FNV-1a
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < (int)name.size(); i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void NameTable::rehash(int newCapacity) {
+    delete[] buckets;
+    capacity = newCapacity;
+    buckets = new int[capacity];
+    for (int i = 0; i < capacity; i++) {
+        buckets[i] = -1;
+    }
+    for (int handle = 0; handle < names.size(); handle++) {
+        int pos = hashName(names[handle]) & (capacity - 1);
+        while (buckets[pos] >= 0) {
+            pos = (pos + 1) & (capacity - 1);
+        }
+        buckets[pos] = handle;
+    }
+}
+
+uint32_t NameTable::intern(const string& name) {
+    int pos = hashName(name) & (capacity - 1);
+    while (buckets[pos] >= 0) {
+        if (names[buckets[pos]] == name) {
+            return (uint32_t)buckets[pos];
+        }
+        pos = (pos + 1) & (capacity - 1);
+    }
+
+    int handle = names.emplace(name);
+    buckets[pos] = handle;
+    // Keep the table at most half full
+    if (names.size() * 2 > capacity) {
+        rehash(capacity * 2);
+    }
+    return (uint32_t)handle;
+}
+
+const string& NameTable::get(uint32_t handle) const {
+    return names[(int)handle];
+}
+
+int NameTable::size() const {
+    return names.size();
+}
@@ -0,0 +1,35 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include "GrowableArray.h"
+#include <string>
+#include <cstdint>
+using namespace std;
+
+// Interned strings behind 32-bit handles. Each distinct name is stored
+// once; records keep the handle instead of a string (32 bytes inline).
+// Handles are indexes into the name array and never change. Lookup by
+// text is a hash table of handles (open addressing, linear probing).
+class NameTable {
+private:
+    GrowableArray<string> names;
+    int* buckets;  // Handle, or -1 when empty
+    int capacity;  // Power of two
+
+    static unsigned int hashName(const string& name);
+    void rehash(int newCapacity);
+
+public:
+    NameTable(int initialCapacity = 16);
+    ~NameTable();
+
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    uint32_t intern(const string& name);  // Existing handle if already present
+    const string& get(uint32_t handle) const;
+
+    int size() const;  // Distinct names
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "PendingTripQueue.h"
+using namespace std;
+
+PendingTripQueue::PendingTripQueue(int initialTripCapacity)
+    : tripCapacity(initialTripCapacity > 0 ? initialTripCapacity : 1),
+      zoneCount(0), zoneCapacity(4), totalCount(0) {
+    queuedIds = new int[tripCapacity];
+    nextTrip = new int[tripCapacity];
+    prevTrip = new int[tripCapacity];
+    zoneSlot = new int[tripCapacity];
+    waitSince = new int[tripCapacity];
+    for (int i = 0; i < tripCapacity; i++) {
+        zoneSlot[i] = -1;
+    }
+
+    zoneIds = new int[zoneCapacity];
+    heads = new int[zoneCapacity];
+    tails = new int[zoneCapacity];
+    counts = new int[zoneCapacity];
+}
+
+PendingTripQueue::~PendingTripQueue() {
+    delete[] queuedIds;
+    delete[] nextTrip;
+    delete[] prevTrip;
+    delete[] zoneSlot;
+    delete[] waitSince;
+    delete[] zoneIds;
+    delete[] heads;
+    delete[] tails;
+    delete[] counts;
+}
+
+void PendingTripQueue::growTrips(int minCapacity) {
+    int newCapacity = tripCapacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    int* newIds = new int[newCapacity];
+    int* newNext = new int[newCapacity];
+    int* newPrev = new int[newCapacity];
+    int* newSlot = new int[newCapacity];
+    int* newSince = new int[newCapacity];
+    for (int i = 0; i < newCapacity; i++) {
+        if (i < tripCapacity) {
+            newIds[i] = queuedIds[i];
+            newNext[i] = nextTrip[i];
+            newPrev[i] = prevTrip[i];
+            newSlot[i] = zoneSlot[i];
+            newSince[i] = waitSince[i];
+        } else {
+            newSlot[i] = -1;
+        }
+    }
+
+    delete[] queuedIds;
+    delete[] nextTrip;
+    delete[] prevTrip;
+    delete[] zoneSlot;
+    delete[] waitSince;
+    queuedIds = newIds;
+    nextTrip = newNext;
+    prevTrip = newPrev;
+    zoneSlot = newSlot;
+    waitSince = newSince;
+    tripCapacity = newCapacity;
+}
+
+int PendingTripQueue::findZoneSlot(int zoneId) const {
+    // Zones are few, so a linear lookup is enough
+    for (int i = 0; i < zoneCount; i++) {
+        if (zoneIds[i] == zoneId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int PendingTripQueue::addZoneSlot(int zoneId) {
+    if (zoneCount >= zoneCapacity) {
+        int newCapacity = zoneCapacity * 2;
+        int* newIds = new int[newCapacity];
+        int* newHeads = new int[newCapacity];
+        int* newTails = new int[newCapacity];
+        int* newCounts = new int[newCapacity];
+        for (int i = 0; i < zoneCount; i++) {
+            newIds[i] = zoneIds[i];
+            newHeads[i] = heads[i];
+            newTails[i] = tails[i];
+            newCounts[i] = counts[i];
+        }
+        delete[] zoneIds;
+        delete[] heads;
+        delete[] tails;
+        delete[] counts;
+        zoneIds = newIds;
+        heads = newHeads;
+        tails = newTails;
+        counts = newCounts;
+        zoneCapacity = newCapacity;
+    }
+
+    zoneIds[zoneCount] = zoneId;
+    heads[zoneCount] = -1;
+    tails[zoneCount] = -1;
+    counts[zoneCount] = 0;
+    return zoneCount++;
+}
+
+void PendingTripQueue::push(int tripId, int zoneId, int waitStamp) {
+    if (tripId < 0) {
+        return;
+    }
+    int node = handleSlot(tripId);
+    if (node >= tripCapacity) {
+        growTrips(node + 1);
+    }
+    if (zoneSlot[node] >= 0) {
+        return;  // Already waiting (slots are not shared by live trips)
+    }
+
+    int slot = findZoneSlot(zoneId);
+    if (slot < 0) {
+        slot = addZoneSlot(zoneId);
+    }
+
+    // Walk back from the tail to keep wait order; new trips land at the
+    // tail immediately, only restored (rolled back) trips walk further
+    int after = tails[slot];
+    while (after >= 0 && waitSince[handleSlot(after)] > waitStamp) {
+        after = prevTrip[handleSlot(after)];
+    }
+
+    int before = (after >= 0) ? nextTrip[handleSlot(after)] : heads[slot];
+    prevTrip[node] = after;
+    nextTrip[node] = before;
+    if (after >= 0) {
+        nextTrip[handleSlot(after)] = tripId;
+    } else {
+        heads[slot] = tripId;
+    }
+    if (before >= 0) {
+        prevTrip[handleSlot(before)] = tripId;
+    } else {
+        tails[slot] = tripId;
+    }
+
+    queuedIds[node] = tripId;
+    zoneSlot[node] = slot;
+    waitSince[node] = waitStamp;
+    counts[slot]++;
+    totalCount++;
+}
+
+bool PendingTripQueue::remove(int tripId) {
+    if (!contains(tripId)) {
+        return false;
+    }
+
+    int node = handleSlot(tripId);
+    int slot = zoneSlot[node];
+    int before = prevTrip[node];
+    int after = nextTrip[node];
+
+    if (before >= 0) {
+        nextTrip[handleSlot(before)] = after;
+    } else {
+        heads[slot] = after;
+    }
+    if (after >= 0) {
+        prevTrip[handleSlot(after)] = before;
+    } else {
+        tails[slot] = before;
+    }
+
+    zoneSlot[node] = -1;
+    counts[slot]--;
+    totalCount--;
+    return true;
+}
+
+bool PendingTripQueue::contains(int tripId) const {
+    if (tripId < 0) {
+        return false;
+    }
+    int node = handleSlot(tripId);
+    return node < tripCapacity && zoneSlot[node] >= 0 && queuedIds[node] == tripId;
+}
+
+int PendingTripQueue::getWaitSince(int tripId) const {
+    return contains(tripId) ? waitSince[handleSlot(tripId)] : -1;
+}
+
+int PendingTripQueue::peekOldest(int zoneId) const {
+    int slot = findZoneSlot(zoneId);
+    return (slot >= 0) ? heads[slot] : -1;
+}
+
+int PendingTripQueue::peekNext(int tripId) const {
+    return contains(tripId) ? nextTrip[handleSlot(tripId)] : -1;
+}
+
+int PendingTripQueue::getZoneCount() const {
+    return zoneCount;
+}
+
+int PendingTripQueue::getZoneIdAt(int index) const {
+    if (index < 0 || index >= zoneCount) return -1;
+    return zoneIds[index];
+}
+
+int PendingTripQueue::getOldestAt(int index) const {
+    if (index < 0 || index >= zoneCount) return -1;
+    return heads[index];
+}
+
+int PendingTripQueue::getCount(int zoneId) const {
+    int slot = findZoneSlot(zoneId);
+    return (slot >= 0) ? counts[slot] : 0;
+}
+
+int PendingTripQueue::getBytesPerTrip() {
+    return (int)(sizeof(int) * 5);  // ID, two links, zone slot, wait stamp
+}
+
+int PendingTripQueue::size() const {
+    return totalCount;
+}
+
+bool PendingTripQueue::isEmpty() const {
+    return totalCount == 0;
+}
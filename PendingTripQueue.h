@@ -0,0 +1,62 @@
+#ifndef PENDING_TRIP_QUEUE_H
+#define PENDING_TRIP_QUEUE_H
+
+#include "HandleTable.h"
+
+// Trips waiting for a driver, bucketed by pickup zone.
+// Each zone is an intrusive doubly linked list over trip IDs ordered by
+// wait time (oldest at the head), so a freed driver only looks at the
+// heads of the zone lists instead of rescanning every trip.
+// Per-trip arrays are indexed by the handle slot of the trip ID, so they
+// stay as large as the live trip count however many IDs were issued.
+class PendingTripQueue {
+private:
+    // Per trip handle slot (intrusive links hold full trip IDs)
+    int* queuedIds;   // Trip ID occupying the slot (tells stale IDs apart)
+    int* nextTrip;
+    int* prevTrip;
+    int* zoneSlot;    // Index into the zone arrays, -1 if not queued
+    int* waitSince;   // Wait-order stamp (smaller = waiting longer)
+    int tripCapacity;
+
+    // Per zone
+    int* zoneIds;
+    int* heads;
+    int* tails;
+    int* counts;
+    int zoneCount;
+    int zoneCapacity;
+
+    int totalCount;
+
+    void growTrips(int minCapacity);
+    int findZoneSlot(int zoneId) const;
+    int addZoneSlot(int zoneId);
+
+public:
+    PendingTripQueue(int initialTripCapacity = 20);
+    ~PendingTripQueue();
+
+    // Insert keeping the zone list ordered by waitSince (appending is O(1))
+    void push(int tripId, int zoneId, int waitStamp);
+    bool remove(int tripId);
+    bool contains(int tripId) const;
+    int getWaitSince(int tripId) const;
+
+    // Oldest waiting trip in a zone, -1 if none
+    int peekOldest(int zoneId) const;
+    // Next trip in the same zone after tripId (the one that waited less)
+    int peekNext(int tripId) const;
+
+    // Zone iteration (for drivers whose own zone has nobody waiting)
+    int getZoneCount() const;
+    int getZoneIdAt(int index) const;
+    int getOldestAt(int index) const;
+
+    int getCount(int zoneId) const;
+    int size() const;
+    static int getBytesPerTrip();  // Per trip slot, queued or not
+    bool isEmpty() const;
+};
+
+#endif
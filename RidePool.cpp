@@ -0,0 +1,487 @@
+#include "RidePool.h"
+#include <climits>
+using namespace std;
+
+PoolStop::PoolStop() : tripId(-1), locationId(-1), isPickup(false) {}
+
+PoolStop::PoolStop(int tripId, int locationId, bool isPickup)
+    : tripId(tripId), locationId(locationId), isPickup(isPickup) {}
+
+PoolInsertion::PoolInsertion() : pickupIndex(-1), dropoffIndex(-1), addedDistance(INT_MAX) {}
+
+// Leg distance cache
+LegDistanceCache::LegDistanceCache(City* city)
+    : city(city), rows(nullptr), rowOrigins(new int[LEG_CACHE_MAX_ROWS]), rowCount(0),
+      nextVictim(0), size(0), cityVersion(-1) {}
+
+LegDistanceCache::~LegDistanceCache() {
+    clearRows();
+    delete[] rows;
+    delete[] rowOrigins;
+}
+
+void LegDistanceCache::clearRows() {
+    for (int i = 0; i < rowCount; i++) {
+        delete[] rows[rowOrigins[i]];
+        rows[rowOrigins[i]] = nullptr;
+    }
+    rowCount = 0;
+    nextVictim = 0;
+}
+
+void LegDistanceCache::reset() {
+    clearRows();
+    delete[] rows;
+
+    size = city->getLocationCount();
+    rows = new int*[size > 0 ? size : 1];
+    for (int i = 0; i < size; i++) {
+        rows[i] = nullptr;
+    }
+    cityVersion = city->getVersion();
+}
+
+int LegDistanceCache::get(int from, int to) {
+    if (cityVersion != city->getVersion()) {
+        reset();
+    }
+    if (from < 0 || from >= size || to < 0 || to >= size) {
+        return -1;
+    }
+    if (!rows[from]) {
+        int* row;
+        if (rowCount < LEG_CACHE_MAX_ROWS) {
+            row = new int[size];
+            rowOrigins[rowCount++] = from;
+        } else {
+            // Reuse the oldest row's buffer
+            int victim = rowOrigins[nextVictim];
+            row = rows[victim];
+            rows[victim] = nullptr;
+            rowOrigins[nextVictim] = from;
+            nextVictim = (nextVictim + 1) % LEG_CACHE_MAX_ROWS;
+        }
+        city->getDistancesFrom(from, row);
+        rows[from] = row;
+    }
+    return rows[from][to];
+}
+
+// Ride pool
+RidePool::RidePool(City* city)
+    : legs(city), driverCapacity(10), tripCapacity(20) {
+    stops = new PoolStop[driverCapacity * POOL_MAX_STOPS];
+    stopCounts = new int[driverCapacity];
+    odometers = new int[driverCapacity];
+    poolingSlot = new int[driverCapacity];
+    poolingDrivers = new int[driverCapacity];
+    poolingCount = 0;
+    for (int i = 0; i < driverCapacity; i++) {
+        stopCounts[i] = 0;
+        odometers[i] = 0;
+        poolingSlot[i] = -1;
+    }
+
+    maxRide = new int[tripCapacity];
+    pickedUpAt = new int[tripCapacity];
+    for (int i = 0; i < tripCapacity; i++) {
+        maxRide[i] = 0;
+        pickedUpAt[i] = -1;
+    }
+}
+
+RidePool::~RidePool() {
+    delete[] stops;
+    delete[] stopCounts;
+    delete[] odometers;
+    delete[] poolingSlot;
+    delete[] poolingDrivers;
+    delete[] maxRide;
+    delete[] pickedUpAt;
+}
+
+void RidePool::growDrivers(int minCapacity) {
+    int newCapacity = driverCapacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    PoolStop* newStops = new PoolStop[newCapacity * POOL_MAX_STOPS];
+    int* newCounts = new int[newCapacity];
+    int* newOdometers = new int[newCapacity];
+    int* newPoolingSlot = new int[newCapacity];
+    int* newPoolingDrivers = new int[newCapacity];
+    for (int i = 0; i < newCapacity; i++) {
+        if (i < driverCapacity) {
+            for (int k = 0; k < stopCounts[i]; k++) {
+                newStops[i * POOL_MAX_STOPS + k] = stops[i * POOL_MAX_STOPS + k];
+            }
+            newCounts[i] = stopCounts[i];
+            newOdometers[i] = odometers[i];
+            newPoolingSlot[i] = poolingSlot[i];
+        } else {
+            newCounts[i] = 0;
+            newOdometers[i] = 0;
+            newPoolingSlot[i] = -1;
+        }
+    }
+    for (int i = 0; i < poolingCount; i++) {
+        newPoolingDrivers[i] = poolingDrivers[i];
+    }
+
+    delete[] stops;
+    delete[] stopCounts;
+    delete[] odometers;
+    delete[] poolingSlot;
+    delete[] poolingDrivers;
+    stops = newStops;
+    stopCounts = newCounts;
+    odometers = newOdometers;
+    poolingSlot = newPoolingSlot;
+    poolingDrivers = newPoolingDrivers;
+    driverCapacity = newCapacity;
+}
+
+void RidePool::growTrips(int minCapacity) {
+    int newCapacity = tripCapacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    int* newMaxRide = new int[newCapacity];
+    int* newPickedUpAt = new int[newCapacity];
+    for (int i = 0; i < newCapacity; i++) {
+        if (i < tripCapacity) {
+            newMaxRide[i] = maxRide[i];
+            newPickedUpAt[i] = pickedUpAt[i];
+        } else {
+            newMaxRide[i] = 0;
+            newPickedUpAt[i] = -1;
+        }
+    }
+
+    delete[] maxRide;
+    delete[] pickedUpAt;
+    maxRide = newMaxRide;
+    pickedUpAt = newPickedUpAt;
+    tripCapacity = newCapacity;
+}
+
+PoolStop* RidePool::routeOf(int driverId) const {
+    return &stops[driverId * POOL_MAX_STOPS];
+}
+
+void RidePool::setStopCount(int driverId, int count) {
+    // Keep the pooling list in step with empty / non-empty routes
+    if (count > 0 && poolingSlot[driverId] < 0) {
+        poolingSlot[driverId] = poolingCount;
+        poolingDrivers[poolingCount++] = driverId;
+    } else if (count == 0 && poolingSlot[driverId] >= 0) {
+        int slot = poolingSlot[driverId];
+        int last = poolingDrivers[--poolingCount];
+        poolingDrivers[slot] = last;
+        poolingSlot[last] = slot;
+        poolingSlot[driverId] = -1;
+    }
+    stopCounts[driverId] = count;
+}
+
+int RidePool::rideLimit(int directDistance) const {
+    return directDistance + directDistance * POOL_MAX_DETOUR_PERCENT / 100;
+}
+
+bool RidePool::detoursHold(int driverId, const int* arrival, int pickupIndex, int dropoffIndex,
+                           int pickupShift, int addedDistance) const {
+    // Stops before the new pickup keep their arrival, stops between the new
+    // pickup and dropoff move by pickupShift, later stops by addedDistance
+    const PoolStop* route = routeOf(driverId);
+    int n = stopCounts[driverId];
+
+    for (int k = 0; k < n; k++) {
+        if (route[k].isPickup) continue;
+
+        int tripId = route[k].tripId;
+        int shift = (k < pickupIndex) ? 0 : (k < dropoffIndex ? pickupShift : addedDistance);
+        int dropoffAt = arrival[k] + shift;
+
+        int ride;
+        if (pickedUpAt[handleSlot(tripId)] >= 0) {
+            // Already on board: count what was driven since the pickup
+            ride = odometers[driverId] + dropoffAt - pickedUpAt[handleSlot(tripId)];
+        } else {
+            int j = k - 1;
+            while (j >= 0 && !(route[j].isPickup && route[j].tripId == tripId)) {
+                j--;
+            }
+            if (j < 0) continue;
+            int pickupShiftJ = (j < pickupIndex) ? 0 : (j < dropoffIndex ? pickupShift : addedDistance);
+            ride = dropoffAt - (arrival[j] + pickupShiftJ);
+        }
+
+        if (ride > maxRide[handleSlot(tripId)]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RidePool::findInsertion(int driverId, int startLocation, int pickup, int dropoff,
+                             int seatCount, PoolInsertion& best) {
+    if (driverId >= driverCapacity) {
+        growDrivers(driverId + 1);
+    }
+
+    const PoolStop* route = routeOf(driverId);
+    int n = stopCounts[driverId];
+    if (n + 2 > POOL_MAX_STOPS) {
+        return false;
+    }
+
+    int direct = legs.get(pickup, dropoff);
+    if (direct < 0) {
+        return false;
+    }
+    int limit = rideLimit(direct);
+    int seats = (seatCount < POOL_SEAT_CAPACITY) ? seatCount : POOL_SEAT_CAPACITY;
+
+    // Distance along the current route to each stop, and riders on board
+    // on the leg into it (load[n] = after the last stop)
+    int arrival[POOL_MAX_STOPS];
+    int load[POOL_MAX_STOPS + 1];
+    int onboard = 0;
+    for (int k = 0; k < n; k++) {
+        if (!route[k].isPickup && pickedUpAt[handleSlot(route[k].tripId)] >= 0) {
+            onboard++;
+        }
+    }
+
+    int at = startLocation;
+    int travelled = 0;
+    for (int k = 0; k < n; k++) {
+        int leg = legs.get(at, route[k].locationId);
+        if (leg < 0) {
+            return false;
+        }
+        travelled += leg;
+        arrival[k] = travelled;
+        load[k] = onboard;
+        onboard += route[k].isPickup ? 1 : -1;
+        at = route[k].locationId;
+    }
+    load[n] = onboard;
+
+    // Pickup goes before original stop p, dropoff before original stop d (d >= p)
+    bool found = false;
+    best = PoolInsertion();
+    for (int p = 0; p <= n; p++) {
+        int prevLocation = (p == 0) ? startLocation : route[p - 1].locationId;
+        int prevArrival = (p == 0) ? 0 : arrival[p - 1];
+        int toPickup = legs.get(prevLocation, pickup);
+        if (toPickup < 0) continue;
+
+        int pickupShift = 0;
+        if (p < n) {
+            int intoNext = legs.get(pickup, route[p].locationId);
+            if (intoNext < 0) continue;
+            pickupShift = toPickup + intoNext - (arrival[p] - prevArrival);
+        }
+
+        int maxLoad = load[p];
+        for (int d = p; d <= n; d++) {
+            if (load[d] > maxLoad) {
+                maxLoad = load[d];
+            }
+            // Widening the span only adds riders to overlap with
+            if (maxLoad + 1 > seats) break;
+
+            int added;
+            int ride;
+            int shift = pickupShift;
+            if (d == p) {
+                // Pickup and dropoff back to back
+                added = toPickup + direct;
+                if (p < n) {
+                    int intoNext = legs.get(dropoff, route[p].locationId);
+                    if (intoNext < 0) continue;
+                    added += intoNext - (arrival[p] - prevArrival);
+                }
+                ride = direct;
+                shift = added;
+            } else {
+                int toDropoff = legs.get(route[d - 1].locationId, dropoff);
+                if (toDropoff < 0) continue;
+                added = pickupShift + toDropoff;
+                if (d < n) {
+                    int intoNext = legs.get(dropoff, route[d].locationId);
+                    if (intoNext < 0) continue;
+                    added += intoNext - (arrival[d] - arrival[d - 1]);
+                }
+                ride = (arrival[d - 1] + pickupShift + toDropoff) - (prevArrival + toPickup);
+            }
+
+            // Price first (O(1)); only a cheaper position pays for the limit check
+            if (ride > limit || added >= best.addedDistance) continue;
+            if (!detoursHold(driverId, arrival, p, d, shift, added)) continue;
+
+            best.pickupIndex = p;
+            best.dropoffIndex = d + 1;
+            best.addedDistance = added;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void RidePool::insertTrip(int driverId, int tripId, int pickup, int dropoff,
+                          const PoolInsertion& at) {
+    if (driverId >= driverCapacity) {
+        growDrivers(driverId + 1);
+    }
+    if (handleSlot(tripId) >= tripCapacity) {
+        growTrips(handleSlot(tripId) + 1);
+    }
+
+    PoolStop* route = routeOf(driverId);
+    int n = stopCounts[driverId];
+
+    // Open a slot at pickupIndex, then at dropoffIndex (post-insert indices)
+    for (int k = n; k > at.pickupIndex; k--) {
+        route[k] = route[k - 1];
+    }
+    route[at.pickupIndex] = PoolStop(tripId, pickup, true);
+    n++;
+    for (int k = n; k > at.dropoffIndex; k--) {
+        route[k] = route[k - 1];
+    }
+    route[at.dropoffIndex] = PoolStop(tripId, dropoff, false);
+    setStopCount(driverId, n + 1);
+
+    maxRide[handleSlot(tripId)] = rideLimit(legs.get(pickup, dropoff));
+    pickedUpAt[handleSlot(tripId)] = -1;
+}
+
+bool RidePool::locateTrip(int driverId, int tripId, int& pickupIndex, int& dropoffIndex) const {
+    pickupIndex = -1;
+    dropoffIndex = -1;
+    if (driverId < 0 || driverId >= driverCapacity) {
+        return false;
+    }
+
+    const PoolStop* route = routeOf(driverId);
+    for (int k = 0; k < stopCounts[driverId]; k++) {
+        if (route[k].tripId != tripId) continue;
+        if (route[k].isPickup) {
+            pickupIndex = k;
+        } else {
+            dropoffIndex = k;
+        }
+    }
+    return dropoffIndex >= 0;
+}
+
+bool RidePool::removeTrip(int driverId, int tripId) {
+    if (driverId < 0 || driverId >= driverCapacity) {
+        return false;
+    }
+
+    PoolStop* route = routeOf(driverId);
+    int kept = 0;
+    for (int k = 0; k < stopCounts[driverId]; k++) {
+        if (route[k].tripId != tripId) {
+            route[kept++] = route[k];
+        }
+    }
+    bool removed = kept != stopCounts[driverId];
+    setStopCount(driverId, kept);
+    return removed;
+}
+
+const PoolStop* RidePool::peekNextStop(int driverId) const {
+    if (driverId < 0 || driverId >= driverCapacity || stopCounts[driverId] == 0) {
+        return nullptr;
+    }
+    return &routeOf(driverId)[0];
+}
+
+int RidePool::reachNextStop(int driverId, int fromLocation) {
+    if (!peekNextStop(driverId)) {
+        return 0;
+    }
+
+    PoolStop* route = routeOf(driverId);
+    PoolStop stop = route[0];
+    int leg = legs.get(fromLocation, stop.locationId);
+    if (leg > 0) {
+        odometers[driverId] += leg;
+    }
+    if (stop.isPickup) {
+        pickedUpAt[handleSlot(stop.tripId)] = odometers[driverId];
+    }
+
+    for (int k = 1; k < stopCounts[driverId]; k++) {
+        route[k - 1] = route[k];
+    }
+    setStopCount(driverId, stopCounts[driverId] - 1);
+    return leg;
+}
+
+void RidePool::undoReachStop(int driverId, int fromLocation, const PoolStop& stop) {
+    if (driverId >= driverCapacity) {
+        growDrivers(driverId + 1);
+    }
+
+    PoolStop* route = routeOf(driverId);
+    for (int k = stopCounts[driverId]; k > 0; k--) {
+        route[k] = route[k - 1];
+    }
+    route[0] = stop;
+    setStopCount(driverId, stopCounts[driverId] + 1);
+
+    int leg = legs.get(fromLocation, stop.locationId);
+    if (leg > 0) {
+        odometers[driverId] -= leg;
+    }
+    if (stop.isPickup && handleSlot(stop.tripId) < tripCapacity) {
+        pickedUpAt[handleSlot(stop.tripId)] = -1;
+    }
+}
+
+int RidePool::getBytesPerTrip() {
+    return (int)(sizeof(int) * 2);
+}
+
+int RidePool::getPoolingDriverCount() const {
+    return poolingCount;
+}
+
+int RidePool::getPoolingDriver(int index) const {
+    if (index < 0 || index >= poolingCount) {
+        return -1;
+    }
+    return poolingDrivers[index];
+}
+
+int RidePool::getStopCount(int driverId) const {
+    if (driverId < 0 || driverId >= driverCapacity) {
+        return 0;
+    }
+    return stopCounts[driverId];
+}
+
+const PoolStop* RidePool::getStop(int driverId, int index) const {
+    if (index < 0 || index >= getStopCount(driverId)) {
+        return nullptr;
+    }
+    return &routeOf(driverId)[index];
+}
+
+int RidePool::getOnboardCount(int driverId) const {
+    int onboard = 0;
+    for (int k = 0; k < getStopCount(driverId); k++) {
+        const PoolStop& stop = routeOf(driverId)[k];
+        if (!stop.isPickup && pickedUpAt[handleSlot(stop.tripId)] >= 0) {
+            onboard++;
+        }
+    }
+    return onboard;
+}
@@ -0,0 +1,124 @@
+#ifndef RIDE_POOL_H
+#define RIDE_POOL_H
+
+#include "City.h"
+#include "HandleTable.h"
+
+// Shared-ride limits
+const int POOL_SEAT_CAPACITY = 3;        // Riders on board at the same time
+const int POOL_MAX_STOPS = 8;            // Pickups + dropoffs queued per driver
+const int POOL_MAX_DETOUR_PERCENT = 50;  // Ride may be this much longer than the direct route
+
+// One stop on a driver's shared route
+struct PoolStop {
+    int tripId;
+    int locationId;
+    bool isPickup;
+
+    PoolStop();
+    PoolStop(int tripId, int locationId, bool isPickup);
+};
+
+// Where a new trip goes in a route (indices in the route after insertion)
+struct PoolInsertion {
+    int pickupIndex;
+    int dropoffIndex;
+    int addedDistance;  // Extra route distance the driver covers
+
+    PoolInsertion();
+};
+
+const int LEG_CACHE_MAX_ROWS = 64;  // Origin rows kept at once
+
+// Distances from recently used origins. A missing row is computed with
+// one single-source Dijkstra on first use; at most LEG_CACHE_MAX_ROWS rows
+// are kept (oldest evicted), so memory stays O(V) per cached origin.
+// Any road or location change drops every row.
+class LegDistanceCache {
+private:
+    City* city;
+    int** rows;        // rows[from]: distance to every location, nullptr if not cached
+    int* rowOrigins;   // Cached origins in fill order (eviction ring)
+    int rowCount;
+    int nextVictim;
+    int size;
+    int cityVersion;
+
+    void reset();
+    void clearRows();
+
+public:
+    LegDistanceCache(City* city);
+    ~LegDistanceCache();
+
+    LegDistanceCache(const LegDistanceCache&) = delete;
+    LegDistanceCache& operator=(const LegDistanceCache&) = delete;
+
+    int get(int from, int to);  // -1 if invalid or unreachable
+};
+
+// Ordered stop lists for drivers carrying shared rides. New trips are
+// matched by trying every (pickup, dropoff) position in a route; leg
+// distances come from the cache, so each position costs O(1) to price
+// and O(stops) to check against seat and detour limits.
+class RidePool {
+private:
+    LegDistanceCache legs;
+
+    // Per driver ID: stops[driverId * POOL_MAX_STOPS + k]
+    PoolStop* stops;
+    int* stopCounts;
+    int* odometers;  // Route distance driven through reached stops
+    int* poolingSlot; // Index in poolingDrivers, -1 if the route is empty
+    int driverCapacity;
+
+    // Drivers with a non-empty route (unordered; swap-removed)
+    int* poolingDrivers;
+    int poolingCount;
+
+    // Per trip handle slot (see HandleTable.h)
+    int* maxRide;     // Longest allowed in-vehicle distance
+    int* pickedUpAt;  // Odometer at pickup, -1 while not on board
+    int tripCapacity;
+
+    void growDrivers(int minCapacity);
+    void growTrips(int minCapacity);
+    PoolStop* routeOf(int driverId) const;
+    void setStopCount(int driverId, int count);
+    int rideLimit(int directDistance) const;
+    bool detoursHold(int driverId, const int* arrival, int pickupIndex, int dropoffIndex,
+                     int pickupShift, int addedDistance) const;
+
+public:
+    RidePool(City* city);
+    ~RidePool();
+
+    RidePool(const RidePool&) = delete;
+    RidePool& operator=(const RidePool&) = delete;
+
+    // Cheapest feasible place for (pickup, dropoff) in driverId's route,
+    // starting from the driver's current location; false if nothing fits.
+    // seatCount is the vehicle's; POOL_SEAT_CAPACITY caps it.
+    bool findInsertion(int driverId, int startLocation, int pickup, int dropoff,
+                       int seatCount, PoolInsertion& best);
+    void insertTrip(int driverId, int tripId, int pickup, int dropoff,
+                    const PoolInsertion& at);
+    bool locateTrip(int driverId, int tripId, int& pickupIndex, int& dropoffIndex) const;
+    bool removeTrip(int driverId, int tripId);
+
+    // Route progress: the driver reaches the stop at the head of its route
+    const PoolStop* peekNextStop(int driverId) const;  // nullptr if no stops
+    int reachNextStop(int driverId, int fromLocation);
+    void undoReachStop(int driverId, int fromLocation, const PoolStop& stop);
+
+    // Drivers with at least one queued stop
+    int getPoolingDriverCount() const;
+    int getPoolingDriver(int index) const;
+
+    int getStopCount(int driverId) const;
+    const PoolStop* getStop(int driverId, int index) const;
+    int getOnboardCount(int driverId) const;
+    static int getBytesPerTrip();  // Per trip slot (ride limit, pickup odometer)
+};
+
+#endif
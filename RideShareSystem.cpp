@@ -1,280 +1,1664 @@
 #include "RideShareSystem.h"
 #include <iostream>
+#include <climits>
 using namespace std;
 
 RideShareSystem::RideShareSystem()
-    : driverCount(0), driverCapacity(10),
-      riderCount(0), riderCapacity(10),
-      tripCount(0), tripCapacity(20) {
-    drivers = new Driver[driverCapacity];
-    riders = new Rider[riderCapacity];
-    trips = new Trip[tripCapacity];
+    : riders(10), trips(20),
+      dispatcher(CityDistanceOracle(&city)),
+      forwardDispatch(true),
+      dispatchBudgetMicros(DISPATCH_NO_BUDGET),
+      ridePool(&city),
+      reassignMinSaving(DEFAULT_REASSIGN_MIN_SAVING),
+      rollingBack(false),
+      rebalancer(&city),
+      dispatchRuntime(nullptr),
+      commandLoop(nullptr),
+      heldStripes(0),
+      commitVersion(0),
+      recordsChanged(false) {}
+
+RideShareSystem::~RideShareSystem() {
+    // Workers drain their queues through the writer, so they stop first
+    stopDispatchWorkers();
+    stopCommandLoop();
+}
+
+RideShareSystem::CommitGuard::CommitGuard(RideShareSystem& system) : owner(system) {
+    owner.commitMutex.lock();
+}
+
+RideShareSystem::CommitGuard::~CommitGuard() {
+    for (int i = 0; i < TRIP_LOCK_STRIPES; i++) {
+        if (owner.heldStripes & (1u << i)) {
+            owner.tripStripes[i].unlock();
+        }
+    }
+    for (int i = 0; i < DRIVER_LOCK_STRIPES; i++) {
+        if (owner.heldStripes & (1u << (TRIP_LOCK_STRIPES + i))) {
+            owner.driverStripes[i].unlock();
+        }
+    }
+    owner.heldStripes = 0;
+    if (owner.recordsChanged) {
+        owner.commitVersion++;
+        owner.recordsChanged = false;
+    }
+    owner.commitMutex.unlock();
+}
+
+void RideShareSystem::recordHistory(const Operation& op) {
+    Operation evicted;
+    if (rollbackMgr.recordOperation(op, evicted)) {
+        // The oldest operation fell out of the window for good
+        Trip* old = findTrip(evicted.tripId);
+        if (old) {
+            old->setHistoryOps(old->getHistoryOps() - 1);
+            if (old->getHistoryOps() == 0 && old->isTerminal()) {
+                settledTrips.emplace(old->getId());
+            }
+        }
+    }
+
+    Trip* trip = findTrip(op.tripId);
+    if (trip) {
+        trip->setHistoryOps(trip->getHistoryOps() + 1);
+    }
+}
+
+void RideShareSystem::archiveSettledTrips() {
+    if (settledTrips.isEmpty()) {
+        return;
+    }
+
+    // Records move: readers wait until the array is consistent again
+    unique_lock<shared_mutex> moving(storageLock);
+    for (int i = 0; i < settledTrips.size(); i++) {
+        int slot = tripHandles.find(settledTrips[i]);
+        if (slot < 0 || !trips[slot].isTerminal() || trips[slot].getHistoryOps() > 0) continue;
+        archive.append(trips[slot]);
+        removeTripSlot(slot);
+    }
+    settledTrips.clear();
+}
+
+void RideShareSystem::removeTripSlot(int slot) {
+    // The last live trip fills the hole
+    int last = trips.size() - 1;
+    tripHandles.release(trips[slot].getId());
+    tripIndex.remove(trips[slot].getId());
+    candidateCache.clear(trips[slot].getId());
+    markChunkChanged(tripChunkVersions, slot);
+    markChunkChanged(tripChunkVersions, last);
+    if (slot != last) {
+        tripHandles.update(trips[last].getId(), slot);
+    }
+    trips.swapRemove(slot);
+}
+
+Trip* RideShareSystem::findTrip(int tripId) {
+    int slot = tripHandles.find(tripId);  // -1 for stale handles too
+    if (slot < 0) {
+        return nullptr;
+    }
+
+    // Held until the commit ends: readers of this trip wait for the result
+    holdStripe(handleSlot(tripId) % TRIP_LOCK_STRIPES);
+    markChunkChanged(tripChunkVersions, slot);
+    return &trips[slot];
+}
+
+Driver* RideShareSystem::findDriver(int driverId) {
+    int slot = driverSlots.find(driverId);
+    if (slot < 0) {
+        return nullptr;
+    }
+
+    holdStripe(TRIP_LOCK_STRIPES + driverId % DRIVER_LOCK_STRIPES);
+    markChunkChanged(driverChunkVersions, slot);
+    return fleet.at(slot);
+}
+
+void RideShareSystem::markChunkChanged(GrowableArray<long long>& chunkVersions, int slot) {
+    // Stamped with the version this commit section ends at
+    int chunk = slot / SNAPSHOT_CHUNK_SIZE;
+    while (chunkVersions.size() <= chunk) {
+        chunkVersions.emplace(0LL);
+    }
+    chunkVersions[chunk] = commitVersion + 1;
+    recordsChanged = true;
+}
+
+void RideShareSystem::holdStripe(int stripe) {
+    unsigned int bit = 1u << stripe;
+    if (heldStripes & bit) {
+        return;
+    }
+
+    mutex& lock = (stripe < TRIP_LOCK_STRIPES) ? tripStripes[stripe]
+                                               : driverStripes[stripe - TRIP_LOCK_STRIPES];
+    if ((heldStripes >> stripe) == 0) {
+        // Above every stripe held: blocking keeps the global order
+        lock.lock();
+    } else {
+        // Out of order: never wait while holding a higher stripe. The holder
+        // is a reader with just this stripe (writers are serialized), so it
+        // lets go without needing anything the writer has.
+        while (!lock.try_lock()) {
+            this_thread::yield();
+        }
+    }
+    heldStripes |= bit;
+}
+
+void RideShareSystem::syncTripIndex(const Trip& trip) {
+    unique_lock<shared_mutex> indexing(storageLock);
+    tripIndex.sync(trip);
+}
+
+int RideShareSystem::searchCandidates(int pickupLocationId, int pickupZoneId,
+                                      int requiredCapabilities, DriverCandidate* candidates,
+                                      int budgetMicros, bool& optimal) {
+    // Read-only search outward from the pickup; safe to run on several
+    // workers at once, and never under the commit lock
+    int found = dispatcher.findNearestDriversWithin(fleet,
+                                                    pickupLocationId, pickupZoneId,
+                                                    candidates, DISPATCH_CANDIDATE_COUNT,
+                                                    forwardDispatch, budgetMicros, optimal,
+                                                    &driverClasses, requiredCapabilities);
+    if (found == 0 && !optimal) {
+        // Budget ran out before reaching anyone. Nothing retries an async
+        // dispatch, so search the whole graph now rather than strand the trip
+        cout << "No driver found within the dispatch budget; searching without one." << endl;
+        found = dispatcher.findNearestDriversWithin(fleet,
+                                                    pickupLocationId, pickupZoneId,
+                                                    candidates, DISPATCH_CANDIDATE_COUNT,
+                                                    forwardDispatch, DISPATCH_NO_BUDGET, optimal,
+                                                    &driverClasses, requiredCapabilities);
+    }
+    return found;
+}
+
+void RideShareSystem::cacheCandidates(Trip* trip, const DriverCandidate* candidates, int found) {
+    // One search yields the k best drivers; cache them for re-dispatch
+    candidateCache.clear(trip->getId());
+    for (int i = 0; i < found; i++) {
+        candidateCache.add(trip->getId(), fleet.at(candidates[i].driverIndex)->getId(),
+                           candidates[i].effectiveDistance);
+    }
+}
+
+Driver* RideShareSystem::claimNextCandidate(Trip* trip, bool& queuedBehind) {
+    // Skip cached drivers that have since been claimed or gone offline.
+    // tryClaim() is a compare-and-swap, so two workers never win the same driver.
+    int driverId = candidateCache.pop(trip->getId());
+    while (driverId >= 0) {
+        Driver* driver = findDriver(driverId);
+        if (driver && driver->tryClaim()) {
+            queuedBehind = false;
+            return driver;
+        }
+        // Still finishing a nearby trip: take its next-trip slot instead
+        if (driver && forwardDispatch && driver->isFinishing() &&
+            driver->tryQueueTrip(trip->getId())) {
+            queuedBehind = true;
+            return driver;
+        }
+        driverId = candidateCache.pop(trip->getId());
+    }
+    return nullptr;
+}
+
+bool RideShareSystem::commitAssignment(int tripId, const DriverCandidate* candidates, int found) {
+    CommitGuard guard(*this);
+
+    // Re-check under the lock: another worker may have assigned it meanwhile
+    Trip* trip = findTrip(tripId);
+    if (!trip || trip->getState() != TRIP_REQUESTED) {
+        cout << "Trip cannot be assigned from current state." << endl;
+        return false;
+    }
+
+    cacheCandidates(trip, candidates, found);
+    bool queuedBehind = false;
+    Driver* driver = claimNextCandidate(trip, queuedBehind);
+    if (!driver) {
+        cout << "No available drivers found." << endl;
+        queuePendingTrip(trip);
+        return false;
+    }
+
+    return recordAssignment(trip, driver, queuedBehind);
+}
+
+bool RideShareSystem::recordAssignment(Trip* trip, Driver* driver, bool queuedBehind) {
+    // The claim already moved the driver from AVAILABLE to BUSY, or filled
+    // the next-trip slot of a driver who stays BUSY. Swap the trip to
+    // ASSIGNED next; if it has moved on, hand the claim back.
+    Operation op(OP_TRIP_ASSIGNED, trip->getId(), driver->getId());
+    op.previousTripState = TRIP_REQUESTED;
+    op.previousDriverStatus = queuedBehind ? DRIVER_BUSY : DRIVER_AVAILABLE;
+    op.previousDriverLocation = driver->getCurrentLocationId();
+    op.queuedBehind = queuedBehind ? 1 : 0;
+
+    int actualState;
+    if (!trip->assignDriver(driver->getId(), actualState)) {
+        releaseClaim(driver, trip->getId(), queuedBehind);
+        reportLostTransition(trip->getId(), "assigned", actualState);
+        return false;
+    }
+
+    // Record operation for rollback
+    op.previousPending = pendingTrips.remove(trip->getId()) ? 1 : 0;
+    recordHistory(op);
+
+    trip->setDispatchStatus(DISPATCH_ASSIGNED);
+    syncTripIndex(*trip);
+
+    if (queuedBehind) {
+        cout << "Trip " << trip->getId() << " queued as next trip for Driver " << driver->getId()
+             << " (" << driver->getName() << "), finishing trip "
+             << driver->getActiveTripId() << "." << endl;
+        return true;
+    }
+
+    driver->setActiveTripId(trip->getId());
+    syncAwaiting(trip);
+    cout << "Trip " << trip->getId() << " assigned to Driver " << driver->getId()
+         << " (" << driver->getName() << ")." << endl;
+    return true;
+}
+
+void RideShareSystem::releaseClaim(Driver* driver, int tripId, bool queuedBehind) {
+    // Undo exactly what the claim took: the next-trip slot or AVAILABLE -> BUSY
+    if (queuedBehind) {
+        driver->releaseQueuedTrip(tripId);
+    } else {
+        driver->releaseClaim();
+    }
+}
+
+void RideShareSystem::reportLostTransition(int tripId, const string& action, int actualState) {
+    string stateName = (actualState >= 0 && actualState < TRIP_STATE_COUNT) ?
+                       TRIP_STATE_NAMES[actualState] : "Unknown";
+    cout << "Trip " << tripId << " cannot be " << action << ": it is now "
+         << stateName << "." << endl;
+}
+
+// Pending trips
+void RideShareSystem::queuePendingTrip(Trip* trip) {
+    // Request order is the wait-time stamp (IDs are not ordered once slots are reused)
+    pendingTrips.push(trip->getId(), city.getLocationZone(trip->getPickupLocationId()),
+                      tripHandles.getSequence(trip->getId()));
+    trip->setDispatchStatus(DISPATCH_NO_DRIVER);
+    cout << "Trip " << trip->getId() << " is waiting for the next free driver." << endl;
+}
+
+void RideShareSystem::restorePending(Trip* trip, int wasPending) {
+    if (!trip) {
+        return;
+    }
+    if (wasPending) {
+        queuePendingTrip(trip);
+    } else {
+        pendingTrips.remove(trip->getId());
+    }
+}
+
+bool RideShareSystem::matchPendingTrip(Driver* driver, int skipTripId) {
+    if (!driver || pendingTrips.isEmpty() || driver->getStatus() != DRIVER_AVAILABLE) {
+        return false;
+    }
+
+    int driverLocation = driver->getCurrentLocationId();
+    int driverZone = driver->getZoneId();
+    int bestTripId = -1;
+
+    // Own zone first: the trip that has waited longest there
+    int tripId = nextServablePending(pendingTrips.peekOldest(driverZone), driver, skipTripId);
+    if (tripId >= 0) {
+        Trip* trip = findTrip(tripId);
+        if (trip && city.getDistance(driverLocation, trip->getPickupLocationId()) >= 0) {
+            bestTripId = tripId;
+        }
+    }
+
+    // Otherwise the cheapest of the other zones' oldest trips
+    if (bestTripId < 0) {
+        int bestCost = INT_MAX;
+        for (int z = 0; z < pendingTrips.getZoneCount(); z++) {
+            int zoneId = pendingTrips.getZoneIdAt(z);
+            if (zoneId == driverZone) continue;
+
+            tripId = nextServablePending(pendingTrips.getOldestAt(z), driver, skipTripId);
+            Trip* trip = findTrip(tripId);
+            if (!trip) continue;
+
+            int distance = city.getDistance(driverLocation, trip->getPickupLocationId());
+            if (distance < 0) continue;
+
+            int cost = dispatcher.calculateEffectiveDistance(distance, driverZone, zoneId);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestTripId = tripId;
+            }
+        }
+    }
+
+    if (bestTripId < 0) {
+        return false;
+    }
+
+    Trip* trip = findTrip(bestTripId);
+    if (trip->isPoolRequested()) {
+        // A shared ride goes back through pooling: this driver starts a
+        // route unless a pooling driver can take it more cheaply
+        cout << "Driver " << driver->getId() << " is free; pooling waiting trip "
+             << bestTripId << "." << endl;
+        DriverCandidate freed(driverSlots.find(driver->getId()), 0);
+        return placePooledTrip(trip, &freed, 1) && driver->getStatus() != DRIVER_AVAILABLE;
+    }
+
+    if (!driver->tryClaim()) {
+        return false;
+    }
+    candidateCache.clear(bestTripId);
+    cout << "Driver " << driver->getId() << " is free; dispatching waiting trip "
+         << bestTripId << "." << endl;
+    return recordAssignment(trip, driver, false);
+}
+
+int RideShareSystem::nextServablePending(int tripId, Driver* driver, int skipTripId) {
+    // Walk a zone list from tripId past trips this driver cannot take
+    while (tripId >= 0) {
+        Trip* trip = findTrip(tripId);
+        if (tripId != skipTripId && trip &&
+            driver->hasCapabilities(trip->getRequiredCapabilities())) {
+            return tripId;
+        }
+        tripId = pendingTrips.peekNext(tripId);
+    }
+    return -1;
+}
+
+// Reassignment optimizer
+void RideShareSystem::syncAwaiting(Trip* trip) {
+    if (!trip) {
+        return;
+    }
+    awaitingPickup.remove(trip->getId());
+
+    // Tracked while the driver is heading to this pickup and nothing else
+    Driver* driver = findDriver(trip->getDriverId());
+    if (trip->getState() != TRIP_ASSIGNED || trip->isPooled() ||
+        !driver || driver->getActiveTripId() != trip->getId()) {
+        return;
+    }
+
+    int pickupId = trip->getPickupLocationId();
+    int pickupZone = city.getLocationZone(pickupId);
+    int distance = city.getDistance(driver->getCurrentLocationId(), pickupId);
+    if (distance < 0) {
+        return;
+    }
+    trip->setApproachCost(dispatcher.calculateEffectiveDistance(distance, driver->getZoneId(),
+                                                                pickupZone));
+    awaitingPickup.push(trip->getId(), pickupZone, tripHandles.getSequence(trip->getId()));
+}
+
+Driver* RideShareSystem::reassignToFreedDriver(Driver* driver, int skipTripId) {
+    // A swap recorded during rollback would be the next thing undone, so
+    // repeated rollback(1) calls would never get past it
+    if (!driver || rollingBack || reassignMinSaving < 0 || awaitingPickup.isEmpty() ||
+        driver->getStatus() != DRIVER_AVAILABLE) {
+        return nullptr;
+    }
+
+    // One Dijkstra from the freed driver prices every waiting pickup; the
+    // assigned drivers' costs are cached on the trips
+    int locationCount = city.getLocationCount();
+    int* dist = new int[locationCount > 0 ? locationCount : 1];
+    if (!city.getDistancesFrom(driver->getCurrentLocationId(), dist)) {
+        delete[] dist;
+        return nullptr;
+    }
+
+    Trip* bestTrip = nullptr;
+    int bestCost = 0;
+    int bestSaving = reassignMinSaving;
+    for (int z = 0; z < awaitingPickup.getZoneCount(); z++) {
+        int zoneId = awaitingPickup.getZoneIdAt(z);
+        for (int tripId = awaitingPickup.getOldestAt(z); tripId >= 0;
+             tripId = awaitingPickup.peekNext(tripId)) {
+            if (tripId == skipTripId) continue;
+
+            Trip* trip = findTrip(tripId);
+            if (!trip || dist[trip->getPickupLocationId()] < 0 ||
+                !driver->hasCapabilities(trip->getRequiredCapabilities())) continue;
+
+            int cost = dispatcher.calculateEffectiveDistance(dist[trip->getPickupLocationId()],
+                                                             driver->getZoneId(), zoneId);
+            if (trip->getApproachCost() - cost > bestSaving) {
+                bestSaving = trip->getApproachCost() - cost;
+                bestCost = cost;
+                bestTrip = trip;
+            }
+        }
+    }
+    delete[] dist;
+
+    Driver* previousDriver = bestTrip ? findDriver(bestTrip->getDriverId()) : nullptr;
+    if (!previousDriver || !driver->tryClaim()) {
+        return nullptr;
+    }
+
+    // Record operation for rollback BEFORE making changes
+    Operation op(OP_TRIP_REASSIGNED, bestTrip->getId(), driver->getId());
+    op.previousDriverId = previousDriver->getId();
+    op.previousTripState = bestTrip->getState();
+    op.previousDriverStatus = DRIVER_AVAILABLE;
+    op.previousDriverLocation = driver->getCurrentLocationId();
+    recordHistory(op);
+
+    bestTrip->setDriverId(driver->getId());
+    syncTripIndex(*bestTrip);
+    driver->setActiveTripId(bestTrip->getId());
+    previousDriver->setActiveTripId(-1);
+    previousDriver->setStatus(DRIVER_AVAILABLE);
+
+    awaitingPickup.remove(bestTrip->getId());
+    bestTrip->setApproachCost(bestCost);
+    awaitingPickup.push(bestTrip->getId(), city.getLocationZone(bestTrip->getPickupLocationId()),
+                        tripHandles.getSequence(bestTrip->getId()));
+
+    cout << "Trip " << bestTrip->getId() << " moved from Driver " << previousDriver->getId()
+         << " to closer Driver " << driver->getId() << " (" << driver->getName()
+         << "), saving " << bestSaving << "." << endl;
+    return previousDriver;
+}
+
+void RideShareSystem::onDriverFreed(Driver* driver, int skipTripId) {
+    // A free driver first serves a waiting trip, otherwise takes over an
+    // assigned one it is much closer to. The driver it replaces is free in
+    // turn; every swap lowers total approach cost, so the chain ends.
+    while (driver) {
+        if (matchPendingTrip(driver, skipTripId)) {
+            return;
+        }
+        driver = reassignToFreedDriver(driver, skipTripId);
+        skipTripId = -1;
+    }
+}
+
+void RideShareSystem::reserve(int locationCapacity, int driverCapacity,
+                              int riderCapacity, int tripCapacity, int roadCapacity) {
+    CommitGuard guard(*this);
+    unique_lock<shared_mutex> moving(storageLock);
+    city.reserve(locationCapacity, roadCapacity);
+    fleet.reserve(driverCapacity);
+    riders.reserve(riderCapacity);
+    trips.reserve(tripCapacity);
+}
+
+// City setup
+int RideShareSystem::addLocation(const string& name, int zoneId) {
+    return city.addLocation(name, zoneId);
+}
+
+void RideShareSystem::addRoad(int from, int to, int distance) {
+    city.addRoad(from, to, distance);
+}
+
+// Dispatch cost configuration
+void RideShareSystem::setZonePenalty(int driverZone, int pickupZone, int percent) {
+    dispatcher.getCostPolicy().setZonePenalty(driverZone, pickupZone, percent);
+}
+
+void RideShareSystem::setHourMultiplier(int hour, int percent) {
+    dispatcher.getCostPolicy().setHourMultiplier(hour, percent);
+}
+
+void RideShareSystem::setCurrentHour(int hour) {
+    dispatcher.getCostPolicy().setCurrentHour(hour);
+}
+
+int RideShareSystem::getEffectiveDistance(int actualDistance, int driverZone, int pickupZone) const {
+    return dispatcher.calculateEffectiveDistance(actualDistance, driverZone, pickupZone);
+}
+
+void RideShareSystem::setForwardDispatch(bool enabled) {
+    forwardDispatch = enabled;
+}
+
+void RideShareSystem::setDispatchBudget(int budgetMicros) {
+    dispatchBudgetMicros = budgetMicros;
+}
+
+void RideShareSystem::setReassignThreshold(int minSaving) {
+    reassignMinSaving = minSaving;
+}
+
+// Driver and Rider management
+int RideShareSystem::addDriver(const string& name, int locationId, int zoneId,
+                               int capabilities, int seatCount) {
+    // Searches read the driver columns and classes without any lock, so the
+    // fleet only grows while nothing can be searching
+    if (isDispatchRunning() || isCommandLoopRunning()) {
+        cout << "Drivers cannot be added while dispatch is running." << endl;
+        return -1;
+    }
+
+    CommitGuard guard(*this);
+
+    int id = fleet.size();
+    {
+        // The columns may grow: readers wait until the driver is published
+        unique_lock<shared_mutex> moving(storageLock);
+        driverSlots.insert(id, fleet.add(id, name, locationId, zoneId));
+    }
+    Driver* driver = findDriver(id);
+    driver->setCapabilities(capabilities);
+    driver->setSeatCount(seatCount);
+    driverClasses.place(id, capabilities);
+
+    // A new driver starts AVAILABLE and can take a waiting trip right away
+    onDriverFreed(driver, -1);
+    return id;
+}
+
+bool RideShareSystem::setDriverCapabilities(int driverId, int capabilities, int seatCount) {
+    // Moving a driver between classes races unlocked searches of the lists
+    if (isDispatchRunning() || isCommandLoopRunning()) {
+        cout << "Vehicles cannot be re-tagged while dispatch is running." << endl;
+        return false;
+    }
+
+    CommitGuard guard(*this);
+
+    Driver* driver = findDriver(driverId);
+    if (!driver || seatCount <= 0) {
+        cout << "Invalid driver or seat count." << endl;
+        return false;
+    }
+
+    driver->setCapabilities(capabilities);
+    driver->setSeatCount(seatCount);
+    driverClasses.place(driverId, capabilities);
+
+    // The vehicle may now qualify for a trip that has been waiting
+    onDriverFreed(driver, -1);
+    return true;
+}
+
+int RideShareSystem::getEligibleDriverCount(int requiredCapabilities) const {
+    return driverClasses.countEligible(requiredCapabilities);
+}
+
+bool RideShareSystem::updateDriverLocation(int driverId, int locationId) {
+    CommitGuard guard(*this);
+
+    Driver* driver = findDriver(driverId);
+    if (!driver || city.getLocation(locationId) == nullptr) {
+        cout << "Invalid driver or location." << endl;
+        return false;
+    }
+
+    driver->moveTo(locationId, city.getLocationZone(locationId));
+
+    // Refresh the cached remaining-route estimate once per position report,
+    // so dispatch can score finishing drivers without another query
+    if (driver->getRemainingDistance() >= 0) {
+        driver->setRemainingDistance(city.getDistance(locationId, driver->getFinishLocationId()));
+    }
+    // Still heading to a pickup: refresh the cost a freed driver must beat
+    syncAwaiting(findTrip(driver->getActiveTripId()));
+    return true;
+}
+
+int RideShareSystem::addRider(const string& name) {
+    CommitGuard guard(*this);
+    int id = riders.size();
+    riders.emplace(id, name);
+    return id;
+}
+
+// Trip operations
+int RideShareSystem::requestTrip(int riderId, int pickupId, int dropoffId,
+                                 int requiredCapabilities) {
+    // The route search only reads the map: run it before taking the lock
+    int distance = city.getDistance(pickupId, dropoffId);
+
+    CommitGuard guard(*this);
+    if (riderId < 0 || riderId >= riders.size()) {
+        cout << "Invalid rider ID." << endl;
+        return -1;
+    }
+    if ((requiredCapabilities & ~CAP_ALL) != 0) {
+        cout << "Invalid capability mask." << endl;
+        return -1;
+    }
+
+    // Safe point for compaction: no trip pointers are held here
+    archiveSettledTrips();
+
+    int tripId;
+    {
+        // Growth moves the array: readers wait until the trip is published
+        unique_lock<shared_mutex> moving(storageLock);
+        tripId = tripHandles.acquire(trips.size());
+        if (tripId < 0) {
+            cout << "Trip capacity exhausted." << endl;
+            return -1;
+        }
+        int slot = trips.emplace(tripId, riderId, pickupId, dropoffId);
+        markChunkChanged(tripChunkVersions, slot);
+        trips[slot].setRequiredCapabilities(requiredCapabilities);
+        if (distance >= 0) {
+            trips[slot].setDistance(distance);
+        }
+        tripIndex.add(trips[slot]);
+    }
+
+    // Record operation for rollback
+    Operation op(OP_TRIP_CREATED, tripId, -1);
+    recordHistory(op);
+
+    rebalancer.recordRequest(city.getLocationZone(pickupId));
+
+    cout << "Trip " << tripId << " requested successfully." << endl;
+    return tripId;
+}
+
+bool RideShareSystem::assignTrip(int tripId) {
+    bool optimal;
+    return assignTrip(tripId, dispatchBudgetMicros, optimal);
+}
+
+bool RideShareSystem::assignTrip(int tripId, int budgetMicros, bool& optimal) {
+    optimal = false;
+    // Read-only check: a copy under the trip's stripe, no commit section
+    Trip trip;
+    if (!getTripSnapshot(tripId, trip)) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+    if (trip.getState() != TRIP_REQUESTED) {
+        cout << "Trip cannot be assigned from current state." << endl;
+        return false;
+    }
+    int pickupLocationId = trip.getPickupLocationId();
+    int requiredCapabilities = trip.getRequiredCapabilities();
+
+    // Find the nearest available drivers outside the lock, then claim one
+    DriverCandidate candidates[DISPATCH_CANDIDATE_COUNT];
+    int found = searchCandidates(pickupLocationId, city.getLocationZone(pickupLocationId),
+                                 requiredCapabilities, candidates, budgetMicros, optimal);
+    return submitAssignment(tripId, candidates, found);
+}
+
+bool RideShareSystem::submitAssignment(int tripId, const DriverCandidate* candidates, int found) {
+    if (!isCommandLoopRunning() || commandLoop->isWriterThread()) {
+        return commitAssignment(tripId, candidates, found);
+    }
+
+    // Single-writer mode: the writer claims and commits, in order with
+    // every other mutation. The candidates stay on this stack until it's done.
+    Command command(CMD_COMMIT_ASSIGNMENT, tripId, found, 0, 0);
+    command.candidates = candidates;
+    return commandLoop->execute(command) == 1;
+}
+
+bool RideShareSystem::startTrip(int tripId) {
+    CommitGuard guard(*this);
+
+    Trip* trip = findTrip(tripId);
+    if (!trip) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+
+    int fromState = trip->getState();
+    if (!TRIP_TRANSITIONS[fromState][TRIP_ONGOING]) {
+        cout << "Trip cannot be started from current state (" << trip->getStateString() << ")." << endl;
+        return false;
+    }
+
+    Driver* driver = findDriver(trip->getDriverId());
+
+    // A shared ride starts when its pickup is the driver's next stop
+    if (trip->isPooled()) {
+        const PoolStop* stop = driver ? ridePool.peekNextStop(driver->getId()) : nullptr;
+        if (!stop || stop->tripId != tripId || !stop->isPickup) {
+            cout << "Driver " << trip->getDriverId() << " has other stops before this pickup." << endl;
+            return false;
+        }
+    }
+    // A forward-dispatched trip waits until its driver finishes the current one
+    else if (driver && driver->getActiveTripId() != tripId) {
+        cout << "Driver " << driver->getId() << " is still finishing trip "
+             << driver->getActiveTripId() << "." << endl;
+        return false;
+    }
+
+    // Record operation for rollback
+    Operation op(OP_TRIP_STARTED, tripId, trip->getDriverId());
+    op.previousTripState = fromState;
+    if (driver) {
+        op.previousDriverLocation = driver->getCurrentLocationId();
+    }
+
+    // Start the trip; only the caller whose swap wins touches the driver
+    int actualState;
+    if (!trip->transitionFrom(fromState, TRIP_ONGOING, actualState)) {
+        reportLostTransition(tripId, "started", actualState);
+        return false;
+    }
+    recordHistory(op);
+
+    // Fallback drivers are no longer needed once aboard
+    syncTripIndex(*trip);
+    candidateCache.clear(tripId);
+
+    // Move driver to pickup location; the whole trip is still ahead
+    if (driver && trip->isPooled()) {
+        ridePool.reachNextStop(driver->getId(), driver->getCurrentLocationId());
+        driver->moveTo(trip->getPickupLocationId(),
+                       city.getLocationZone(trip->getPickupLocationId()));
+    }
+    else if (driver) {
+        driver->moveTo(trip->getPickupLocationId(),
+                       city.getLocationZone(trip->getPickupLocationId()));
+        driver->beginRoute(trip->getDropoffLocationId(),
+                           city.getLocationZone(trip->getDropoffLocationId()),
+                           trip->getDistance());
+    }
+
+    syncAwaiting(trip);
+    cout << "Trip " << tripId << " is now ongoing." << endl;
+    return true;
+}
+
+bool RideShareSystem::completeTrip(int tripId) {
+    CommitGuard guard(*this);
+
+    Trip* trip = findTrip(tripId);
+    if (!trip) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+
+    int fromState = trip->getState();
+    if (!TRIP_TRANSITIONS[fromState][TRIP_COMPLETED]) {
+        cout << "Trip cannot be completed from current state (" << trip->getStateString() << ")." << endl;
+        return false;
+    }
+
+    Driver* driver = findDriver(trip->getDriverId());
+
+    if (trip->isPooled()) {
+        const PoolStop* stop = driver ? ridePool.peekNextStop(driver->getId()) : nullptr;
+        if (!stop || stop->tripId != tripId || stop->isPickup) {
+            cout << "Driver " << trip->getDriverId() << " has other stops before this dropoff." << endl;
+            return false;
+        }
+    }
+
+    // Record operation for rollback
+    Operation op(OP_TRIP_COMPLETED, tripId, trip->getDriverId());
+    op.previousTripState = fromState;
+    op.tripDistance = trip->getDistance();
+    if (driver) {
+        op.previousDriverStatus = driver->getStatus();
+        op.previousDriverLocation = driver->getCurrentLocationId();
+        op.previousDriverTripsCompleted = driver->getTotalTripsCompleted();
+        op.previousDriverDistanceCovered = driver->getTotalDistanceCovered();
+    }
+
+    // Complete the trip; a caller that lost the swap leaves the driver alone
+    int actualState;
+    if (!trip->transitionFrom(fromState, TRIP_COMPLETED, actualState)) {
+        reportLostTransition(tripId, "completed", actualState);
+        return false;
+    }
+    recordHistory(op);
+    syncTripIndex(*trip);
+
+    // Update driver stats and location
+    if (driver && trip->isPooled()) {
+        ridePool.reachNextStop(driver->getId(), driver->getCurrentLocationId());
+        driver->moveTo(trip->getDropoffLocationId(),
+                       city.getLocationZone(trip->getDropoffLocationId()));
+        driver->completeTrip(trip->getDistance());
+
+        // Free once the last shared rider is dropped off
+        if (ridePool.getStopCount(driver->getId()) == 0) {
+            driver->setStatus(DRIVER_AVAILABLE);
+        }
+    }
+    else if (driver) {
+        driver->moveTo(trip->getDropoffLocationId(),
+                       city.getLocationZone(trip->getDropoffLocationId()));
+        driver->completeTrip(trip->getDistance());
+        driver->clearRoute();
+
+        int nextTripId = driver->getQueuedTripId();
+        if (nextTripId >= 0) {
+            // Go straight on to the trip queued behind this one
+            driver->setQueuedTripId(-1);
+            driver->setActiveTripId(nextTripId);
+            syncAwaiting(findTrip(nextTripId));
+            cout << "Driver " << driver->getId() << " continues to next trip "
+                 << nextTripId << "." << endl;
+        } else {
+            driver->setActiveTripId(-1);
+            driver->setStatus(DRIVER_AVAILABLE);
+        }
+    }
+
+    cout << "Trip " << tripId << " completed. Distance: " << trip->getDistance() << endl;
+
+    // The freed driver serves the longest-waiting nearby trip, if any
+    onDriverFreed(driver, -1);
+    return true;
+}
+
+bool RideShareSystem::cancelTrip(int tripId) {
+    CommitGuard guard(*this);
+
+    Trip* trip = findTrip(tripId);
+    if (!trip) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+
+    int fromState = trip->getState();
+    if (!TRIP_TRANSITIONS[fromState][TRIP_CANCELLED]) {
+        cout << "Trip cannot be cancelled from current state (" << trip->getStateString() << ")." << endl;
+        return false;
+    }
+
+    Driver* driver = findDriver(trip->getDriverId());
+
+    // Record operation for rollback
+    Operation op(OP_TRIP_CANCELLED, tripId, trip->getDriverId());
+    op.previousTripState = fromState;
+    if (driver) {
+        op.previousDriverStatus = driver->getStatus();
+        op.previousDriverLocation = driver->getCurrentLocationId();
+    }
+
+    // Cancel the trip before undoing anything it holds
+    int actualState;
+    if (!trip->transitionFrom(fromState, TRIP_CANCELLED, actualState)) {
+        reportLostTransition(tripId, "cancelled", actualState);
+        return false;
+    }
+
+    op.previousPending = pendingTrips.remove(tripId) ? 1 : 0;
+    op.queuedBehind = (driver && driver->getQueuedTripId() == tripId) ? 1 : 0;
+    if (driver && trip->isPooled()) {
+        ridePool.locateTrip(driver->getId(), tripId, op.pickupStopIndex, op.dropoffStopIndex);
+    }
+    recordHistory(op);
+    syncTripIndex(*trip);
+    candidateCache.clear(tripId);
+
+    // Restore driver availability if assigned; a driver who only had it
+    // queued as the next trip just keeps driving the current one
+    if (driver && trip->isPooled()) {
+        ridePool.removeTrip(driver->getId(), tripId);
+        if (ridePool.getStopCount(driver->getId()) == 0) {
+            driver->setStatus(DRIVER_AVAILABLE);
+        }
+    }
+    else if (driver && op.queuedBehind) {
+        driver->setQueuedTripId(-1);
+    }
+    else if (driver) {
+        driver->setActiveTripId(-1);
+        driver->setStatus(DRIVER_AVAILABLE);
+    }
+
+    syncAwaiting(trip);
+    cout << "Trip " << tripId << " cancelled." << endl;
+
+    onDriverFreed(driver, -1);
+    return true;
+}
+
+bool RideShareSystem::rejectTrip(int tripId) {
+    // Cached fallbacks first; if none is left, search outside the commit
+    // lock (as assignTrip does), then re-validate and claim under it
+    Trip trip;
+    if (!getTripSnapshot(tripId, trip)) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+    int rejectingDriverId = trip.getDriverId();
+    int result = submitReject(tripId, nullptr, 0, rejectingDriverId);
+    if (result != REJECT_NEEDS_SEARCH) {
+        return result == 1;
+    }
+
+    int pickupLocationId = trip.getPickupLocationId();
+    DriverCandidate candidates[DISPATCH_CANDIDATE_COUNT];
+    bool optimal;
+    int found = searchCandidates(pickupLocationId, city.getLocationZone(pickupLocationId),
+                                 trip.getRequiredCapabilities(), candidates,
+                                 dispatchBudgetMicros, optimal);
+    return submitReject(tripId, candidates, found, rejectingDriverId) == 1;
+}
+
+int RideShareSystem::submitReject(int tripId, const DriverCandidate* candidates, int found,
+                                  int rejectingDriverId) {
+    if (!isCommandLoopRunning() || commandLoop->isWriterThread()) {
+        return finishReject(tripId, candidates, found, rejectingDriverId);
+    }
+
+    // Single-writer mode: the writer re-validates and commits
+    Command command(CMD_FINISH_REJECT, tripId, found, rejectingDriverId, 0);
+    command.candidates = candidates;
+    return commandLoop->execute(command);
+}
+
+int RideShareSystem::finishReject(int tripId, const DriverCandidate* candidates, int found,
+                                  int rejectingDriverId) {
+    CommitGuard guard(*this);
+
+    Trip* trip = findTrip(tripId);
+    if (!trip) {
+        cout << "Trip not found." << endl;
+        return 0;
+    }
+
+    if (trip->getState() == TRIP_ASSIGNED && trip->getDriverId() != rejectingDriverId) {
+        // Reassigned since it was read: this rejection no longer applies
+        cout << "Trip " << tripId << " was reassigned; rejection dropped." << endl;
+        return 0;
+    }
+
+    if (trip->getState() != TRIP_ASSIGNED) {
+        cout << "Only assigned trips can be rejected (" << trip->getStateString() << ")." << endl;
+        return 0;
+    }
+
+    if (trip->isPooled()) {
+        cout << "Shared rides cannot be rejected; cancel the trip instead." << endl;
+        return 0;
+    }
+
+    Driver* previousDriver = findDriver(trip->getDriverId());
+    bool previousQueuedBehind = previousDriver && previousDriver->getQueuedTripId() == tripId;
+
+    // The rejecting driver is still BUSY here, so neither the cached
+    // candidates nor a fresh search can hand the trip back to them
+    bool queuedBehind = false;
+    if (candidates) {
+        cacheCandidates(trip, candidates, found);
+    }
+    Driver* nextDriver = claimNextCandidate(trip, queuedBehind);
+    if (!nextDriver && !candidates) {
+        // Nothing cached is free and nothing has changed yet: search unlocked
+        return REJECT_NEEDS_SEARCH;
+    }
+
+    // Record operation for rollback (a claimed driver was AVAILABLE)
+    Operation op(OP_TRIP_REASSIGNED, tripId, nextDriver ? nextDriver->getId() : -1);
+    op.previousDriverId = trip->getDriverId();
+    op.previousTripState = trip->getState();
+    op.previousQueuedBehind = previousQueuedBehind ? 1 : 0;
+    op.queuedBehind = queuedBehind ? 1 : 0;
+    if (nextDriver) {
+        op.previousDriverStatus = queuedBehind ? DRIVER_BUSY : DRIVER_AVAILABLE;
+        op.previousDriverLocation = nextDriver->getCurrentLocationId();
+        op.candidateDistance = candidateCache.getLastPoppedDistance(tripId);
+    }
+    recordHistory(op);
+
+    // Release the rejecting driver
+    if (previousDriver && previousQueuedBehind) {
+        previousDriver->setQueuedTripId(-1);
+    }
+    else if (previousDriver) {
+        previousDriver->setActiveTripId(-1);
+        previousDriver->setStatus(DRIVER_AVAILABLE);
+    }
+
+    if (!nextDriver) {
+        // Nobody else can take it: back to waiting
+        trip->setDriverId(-1);
+        trip->setState(TRIP_REQUESTED);
+        cout << "Trip " << tripId << " rejected. No other drivers available." << endl;
+    } else {
+        trip->setDriverId(nextDriver->getId());
+        if (!queuedBehind) {
+            nextDriver->setActiveTripId(tripId);
+        }
+        cout << "Trip " << tripId << " rejected by Driver " << op.previousDriverId
+             << ", reassigned to Driver " << nextDriver->getId()
+             << " (" << nextDriver->getName() << ")." << endl;
+    }
+
+    syncTripIndex(*trip);
+    syncAwaiting(trip);
+
+    // The rejecting driver may serve someone else (never the trip it declined)
+    onDriverFreed(previousDriver, tripId);
+    if (!nextDriver) {
+        queuePendingTrip(trip);
+    }
+    return 1;
+}
+
+bool RideShareSystem::assignPooledTrip(int tripId) {
+    // Search for idle drivers before taking the commit lock, as assignTrip does
+    Trip snapshot;
+    if (!getTripSnapshot(tripId, snapshot)) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+
+    if (snapshot.getState() != TRIP_REQUESTED) {
+        cout << "Trip cannot be assigned from current state." << endl;
+        return false;
+    }
+
+    int pickup = snapshot.getPickupLocationId();
+    DriverCandidate candidates[DISPATCH_CANDIDATE_COUNT];
+    bool optimal;
+    int found = dispatcher.findNearestDriversWithin(fleet, pickup, city.getLocationZone(pickup),
+                                                    candidates, DISPATCH_CANDIDATE_COUNT,
+                                                    false, dispatchBudgetMicros, optimal,
+                                                    &driverClasses,
+                                                    snapshot.getRequiredCapabilities());
+    return submitPooledTrip(tripId, candidates, found);
+}
+
+bool RideShareSystem::submitPooledTrip(int tripId, const DriverCandidate* candidates, int found) {
+    if (!isCommandLoopRunning() || commandLoop->isWriterThread()) {
+        return commitPooledTrip(tripId, candidates, found);
+    }
+
+    // Single-writer mode: the writer prices the insertions and commits
+    Command command(CMD_COMMIT_POOL, tripId, found, 0, 0);
+    command.candidates = candidates;
+    return commandLoop->execute(command) == 1;
+}
+
+bool RideShareSystem::commitPooledTrip(int tripId, const DriverCandidate* candidates, int found) {
+    CommitGuard guard(*this);
+
+    Trip* trip = findTrip(tripId);
+    if (!trip) {
+        cout << "Trip not found." << endl;
+        return false;
+    }
+
+    if (trip->getState() != TRIP_REQUESTED) {
+        cout << "Trip cannot be assigned from current state." << endl;
+        return false;
+    }
+
+    // A trip left waiting is matched as a shared ride when a driver frees up
+    trip->setPoolRequested(true);
+    if (!placePooledTrip(trip, candidates, found)) {
+        cout << "No driver can fit this shared ride." << endl;
+        if (!pendingTrips.contains(tripId)) {
+            queuePendingTrip(trip);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool RideShareSystem::placePooledTrip(Trip* trip, const DriverCandidate* candidates, int found) {
+    int tripId = trip->getId();
+    int pickup = trip->getPickupLocationId();
+    int dropoff = trip->getDropoffLocationId();
+    int pickupZone = city.getLocationZone(pickup);
+
+    // Idle drivers start a route; busy drivers join only if already pooling.
+    // An idle driver's added distance is its distance to the pickup plus the
+    // fixed direct leg, so the nearest idle drivers from the anytime search
+    // include the cheapest one. Pooling drivers come from the pool's own
+    // list, and only those in or routed through the pickup zone are priced.
+    Driver* bestDriver = nullptr;
+    PoolInsertion best;
+    int bestCost = INT_MAX;
+    auto consider = [&](Driver* driver) {
+        if (!driver->hasCapabilities(trip->getRequiredCapabilities())) return;
+
+        PoolInsertion insertion;
+        if (!ridePool.findInsertion(driver->getId(), driver->getCurrentLocationId(),
+                                    pickup, dropoff, driver->getSeatCount(), insertion)) return;
+
+        int cost = dispatcher.calculateEffectiveDistance(insertion.addedDistance,
+                                                         driver->getZoneId(), pickupZone);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = insertion;
+            bestDriver = driver;
+        }
+    };
+
+    // Candidates were found without the lock; an idle one that has since
+    // been claimed fails its claim below
+    for (int i = 0; i < found; i++) {
+        consider(fleet.at(candidates[i].driverIndex));
+    }
+
+    for (int i = 0; i < ridePool.getPoolingDriverCount(); i++) {
+        int driverId = ridePool.getPoolingDriver(i);
+        int slot = driverSlots.find(driverId);
+        if (slot < 0) continue;
+        Driver* driver = fleet.at(slot);
+
+        bool nearby = driver->getZoneId() == pickupZone;
+        for (int k = 0; !nearby && k < ridePool.getStopCount(driverId); k++) {
+            nearby = city.getLocationZone(ridePool.getStop(driverId, k)->locationId) == pickupZone;
+        }
+        if (nearby) {
+            consider(driver);
+        }
+    }
+
+    // The scan only read; take the chosen driver's stripe before changing it
+    if (bestDriver) {
+        bestDriver = findDriver(bestDriver->getId());
+    }
+    bool idle = bestDriver && bestDriver->getStatus() == DRIVER_AVAILABLE;
+    if (!bestDriver || (idle && !bestDriver->tryClaim())) {
+        return false;
+    }
+
+    // Swap the trip to ASSIGNED before touching the route; an idle driver's
+    // claim is handed back if the trip has moved on
+    Operation op(OP_TRIP_ASSIGNED, tripId, bestDriver->getId());
+    op.previousTripState = TRIP_REQUESTED;
+    op.previousDriverStatus = idle ? DRIVER_AVAILABLE : DRIVER_BUSY;
+    op.previousDriverLocation = bestDriver->getCurrentLocationId();
+    op.pickupStopIndex = best.pickupIndex;
+    op.dropoffStopIndex = best.dropoffIndex;
+
+    int actualState;
+    if (!trip->assignDriver(bestDriver->getId(), actualState)) {
+        if (idle) {
+            bestDriver->releaseClaim();
+        }
+        reportLostTransition(tripId, "pooled", actualState);
+        return false;
+    }
+
+    // Record operation for rollback
+    op.previousPending = pendingTrips.remove(tripId) ? 1 : 0;
+    recordHistory(op);
+
+    trip->setDispatchStatus(DISPATCH_ASSIGNED);
+    trip->setPooled(true);
+    syncTripIndex(*trip);
+    candidateCache.clear(tripId);
+    ridePool.insertTrip(bestDriver->getId(), tripId, pickup, dropoff, best);
+
+    cout << "Trip " << tripId << " pooled with Driver " << bestDriver->getId()
+         << " (" << bestDriver->getName() << "): stops " << best.pickupIndex << " and "
+         << best.dropoffIndex << ", +" << best.addedDistance << " distance." << endl;
+    return true;
 }
 
-RideShareSystem::~RideShareSystem() {
-    delete[] drivers;
-    delete[] riders;
-    delete[] trips;
+int RideShareSystem::getPoolStopCount(int driverId) const {
+    lock_guard<mutex> guard(commitMutex);
+    return ridePool.getStopCount(driverId);
 }
 
-void RideShareSystem::resizeDrivers() {
-    int newCapacity = driverCapacity * 2;
-    Driver* newDrivers = new Driver[newCapacity];
-    for (int i = 0; i < driverCount; i++) {
-        newDrivers[i] = drivers[i];
-    }
-    delete[] drivers;
-    drivers = newDrivers;
-    driverCapacity = newCapacity;
+// Zone rebalancing
+int RideShareSystem::planRebalance(RebalanceMove* moves, int maxMoves) {
+    CommitGuard guard(*this);
+    return rebalancer.plan(fleet, pendingTrips, moves, maxMoves);
 }
 
-void RideShareSystem::resizeRiders() {
-    int newCapacity = riderCapacity * 2;
-    Rider* newRiders = new Rider[newCapacity];
-    for (int i = 0; i < riderCount; i++) {
-        newRiders[i] = riders[i];
+int RideShareSystem::rebalanceIdleDrivers() {
+    CommitGuard guard(*this);
+
+    int maxMoves = fleet.size() > 0 ? fleet.size() : 1;
+    RebalanceMove* moves = new RebalanceMove[maxMoves];
+    int moveCount = rebalancer.plan(fleet, pendingTrips, moves, maxMoves);
+
+    for (int i = 0; i < moveCount; i++) {
+        Driver* driver = findDriver(moves[i].driverId);
+        if (!driver || driver->getStatus() != DRIVER_AVAILABLE) continue;
+
+        // Record operation for rollback BEFORE making changes
+        Operation op(OP_DRIVER_MOVED, -1, driver->getId());
+        op.previousDriverStatus = DRIVER_AVAILABLE;
+        op.previousDriverLocation = driver->getCurrentLocationId();
+        recordHistory(op);
+
+        driver->moveTo(moves[i].targetLocationId, moves[i].toZone);
+        cout << "Rebalance: Driver " << driver->getId() << " (" << driver->getName()
+             << ") moves from Zone " << moves[i].fromZone << " to Zone " << moves[i].toZone
+             << " (" << city.getLocationName(moves[i].targetLocationId) << ")." << endl;
+
+        // Arriving where riders wait: serve the longest-waiting one
+        onDriverFreed(driver, -1);
     }
-    delete[] riders;
-    riders = newRiders;
-    riderCapacity = newCapacity;
+
+    rebalancer.ageDemand();
+    delete[] moves;
+    return moveCount;
 }
 
-void RideShareSystem::resizeTrips() {
-    int newCapacity = tripCapacity * 2;
-    Trip* newTrips = new Trip[newCapacity];
-    for (int i = 0; i < tripCount; i++) {
-        newTrips[i] = trips[i];
+// Parallel dispatch
+void RideShareSystem::startDispatchWorkers() {
+    if (dispatchRuntime) {
+        return;
     }
-    delete[] trips;
-    trips = newTrips;
-    tripCapacity = newCapacity;
-}
 
-Trip* RideShareSystem::findTrip(int tripId) {
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].getId() == tripId) {
-            return &trips[i];
+    // The map is loaded: lay each location's roads out contiguously
+    city.compactRoads();
+
+    // Collect the distinct zones; one worker per zone
+    int locationCount = city.getLocationCount();
+    int* zones = new int[locationCount > 0 ? locationCount : 1];
+    int zoneCount = 0;
+    for (int i = 0; i < locationCount; i++) {
+        int zone = city.getLocationZone(i);
+        bool seen = false;
+        for (int j = 0; j < zoneCount; j++) {
+            if (zones[j] == zone) {
+                seen = true;
+                break;
+            }
+        }
+        if (!seen) {
+            zones[zoneCount++] = zone;
         }
     }
-    return nullptr;
+
+    dispatchRuntime = new DispatchRuntime(this, zones, zoneCount);
+    delete[] zones;
+    dispatchRuntime->start();
+    cout << "Dispatch workers started (" << dispatchRuntime->getShardCount() << " zones)." << endl;
 }
 
-Driver* RideShareSystem::findDriver(int driverId) {
-    for (int i = 0; i < driverCount; i++) {
-        if (drivers[i].getId() == driverId) {
-            return &drivers[i];
-        }
+void RideShareSystem::stopDispatchWorkers() {
+    if (!dispatchRuntime) {
+        return;
     }
-    return nullptr;
+    dispatchRuntime->stop();
+    delete dispatchRuntime;
+    dispatchRuntime = nullptr;
 }
 
-// City setup
-int RideShareSystem::addLocation(const string& name, int zoneId) {
-    return city.addLocation(name, zoneId);
+bool RideShareSystem::isDispatchRunning() const {
+    return dispatchRuntime != nullptr && dispatchRuntime->isRunning();
 }
 
-void RideShareSystem::addRoad(int from, int to, int distance) {
-    city.addRoad(from, to, distance);
+// Blocks the submitting thread until its worker reports back
+struct DispatchWaiter {
+    mutex lock;
+    condition_variable done;
+    bool finished;
+    bool assigned;
+
+    DispatchWaiter() : finished(false), assigned(false) {}
+};
+
+static void notifyDispatchWaiter(int, bool assigned, void* context) {
+    DispatchWaiter* waiter = (DispatchWaiter*)context;
+    lock_guard<mutex> guard(waiter->lock);
+    waiter->assigned = assigned;
+    waiter->finished = true;
+    waiter->done.notify_one();
 }
 
-// Driver and Rider management
-int RideShareSystem::addDriver(const string& name, int locationId, int zoneId) {
-    if (driverCount >= driverCapacity) {
-        resizeDrivers();
+bool RideShareSystem::dispatchTrip(int tripId) {
+    if (!isDispatchRunning()) {
+        return assignTrip(tripId);
     }
-    int id = driverCount;
-    drivers[driverCount] = Driver(id, name, locationId, zoneId);
-    driverCount++;
-    return id;
-}
 
-int RideShareSystem::addRider(const string& name) {
-    if (riderCount >= riderCapacity) {
-        resizeRiders();
+    Trip trip;
+    if (!getTripSnapshot(tripId, trip)) {
+        cout << "Trip not found." << endl;
+        return false;
     }
-    int id = riderCount;
-    riders[riderCount] = Rider(id, name);
-    riderCount++;
-    return id;
+    int pickupLocationId = trip.getPickupLocationId();
+    int requiredCapabilities = trip.getRequiredCapabilities();
+
+    DispatchWaiter waiter;
+    dispatchRuntime->submit(tripId, pickupLocationId, city.getLocationZone(pickupLocationId),
+                            requiredCapabilities, notifyDispatchWaiter, &waiter);
+
+    unique_lock<mutex> guard(waiter.lock);
+    waiter.done.wait(guard, [&waiter] { return waiter.finished; });
+    return waiter.assigned;
 }
 
-// Trip operations
-int RideShareSystem::requestTrip(int riderId, int pickupId, int dropoffId) {
-    if (riderId < 0 || riderId >= riderCount) {
-        cout << "Invalid rider ID." << endl;
+int RideShareSystem::requestTripAsync(int riderId, int pickupId, int dropoffId,
+                                      DispatchCallback callback, void* context,
+                                      int requiredCapabilities) {
+    int tripId = requestTrip(riderId, pickupId, dropoffId, requiredCapabilities);
+    if (tripId < 0) {
         return -1;
     }
 
-    if (tripCount >= tripCapacity) {
-        resizeTrips();
+    if (!isDispatchRunning()) {
+        // No dispatcher stage: assign inline so callers still get a result
+        bool assigned = assignTrip(tripId);
+        if (callback) {
+            callback(tripId, assigned, context);
+        }
+        return tripId;
     }
 
-    int tripId = tripCount;
-    trips[tripCount] = Trip(tripId, riderId, pickupId, dropoffId);
-
-    // Calculate and set trip distance
-    int distance = city.getDistance(pickupId, dropoffId);
-    if (distance >= 0) {
-        trips[tripCount].setDistance(distance);
+    {
+        CommitGuard guard(*this);
+        Trip* trip = findTrip(tripId);
+        if (trip) {
+            trip->setDispatchStatus(DISPATCH_QUEUED);
+        }
     }
 
-    // Record operation for rollback
-    Operation op(OP_TRIP_CREATED, tripId, -1);
-    rollbackMgr.recordOperation(op);
-
-    tripCount++;
-    cout << "Trip " << tripId << " requested successfully." << endl;
+    // Hand off to the pickup zone's worker and return immediately
+    dispatchRuntime->submit(tripId, pickupId, city.getLocationZone(pickupId), requiredCapabilities,
+                            callback, context);
     return tripId;
 }
 
-bool RideShareSystem::assignTrip(int tripId) {
-    Trip* trip = findTrip(tripId);
-    if (!trip) {
-        cout << "Trip not found." << endl;
-        return false;
+// Single-writer mode
+void RideShareSystem::startCommandLoop() {
+    if (commandLoop) {
+        return;
     }
+    commandLoop = new CommandLoop(this);
+    commandLoop->start();
+    cout << "Command writer started." << endl;
+}
 
-    if (trip->getState() != TRIP_REQUESTED) {
-        cout << "Trip cannot be assigned from current state." << endl;
-        return false;
+void RideShareSystem::stopCommandLoop() {
+    if (!commandLoop) {
+        return;
     }
+    commandLoop->stop();
+    delete commandLoop;
+    commandLoop = nullptr;
+}
 
-    int pickupLocationId = trip->getPickupLocationId();
-    int pickupZoneId = city.getLocationZone(pickupLocationId);
+bool RideShareSystem::isCommandLoopRunning() const {
+    return commandLoop != nullptr && commandLoop->isRunning();
+}
 
-    // Find nearest available driver
-    int driverIndex = dispatcher.findNearestDriver(city, drivers, driverCount,
-                                                    pickupLocationId, pickupZoneId);
+int RideShareSystem::getAppliedCommandCount() const {
+    return commandLoop ? commandLoop->getAppliedCount() : 0;
+}
 
-    if (driverIndex < 0) {
-        cout << "No available drivers found." << endl;
-        return false;
+int RideShareSystem::execute(int type, int arg0, int arg1, int arg2, int arg3) {
+    Command command(type, arg0, arg1, arg2, arg3);
+    if (!isCommandLoopRunning()) {
+        return applyCommand(type, command.args);
     }
-
-    // Record operation for rollback BEFORE making changes
-    Operation op(OP_TRIP_ASSIGNED, tripId, drivers[driverIndex].getId());
-    op.previousTripState = trip->getState();
-    op.previousDriverStatus = drivers[driverIndex].getStatus();
-    op.previousDriverLocation = drivers[driverIndex].getCurrentLocationId();
-    rollbackMgr.recordOperation(op);
-
-    // Assign driver
-    trip->assignDriver(drivers[driverIndex].getId());
-    drivers[driverIndex].setStatus(DRIVER_BUSY);
-
-    cout << "Trip " << tripId << " assigned to Driver " << drivers[driverIndex].getId()
-         << " (" << drivers[driverIndex].getName() << ")." << endl;
-    return true;
+    if (!commandLoop->isWriterThread()) {
+        // Search here, off the writer; only the claim and commit are queued
+        if (type == CMD_ASSIGN_TRIP) {
+            return assignTrip(arg0) ? 1 : 0;
+        }
+        else if (type == CMD_POOL_TRIP) {
+            return assignPooledTrip(arg0) ? 1 : 0;
+        }
+        else if (type == CMD_REJECT_TRIP) {
+            return rejectTrip(arg0) ? 1 : 0;
+        }
+    }
+    return commandLoop->execute(command);
 }
 
-bool RideShareSystem::startTrip(int tripId) {
-    Trip* trip = findTrip(tripId);
-    if (!trip) {
-        cout << "Trip not found." << endl;
-        return false;
+int RideShareSystem::applyCommand(int type, const int* args, const DriverCandidate* candidates) {
+    // Using if-else instead of switch (no enum)
+    if (type == CMD_REQUEST_TRIP) {
+        return requestTrip(args[0], args[1], args[2], args[3]);
     }
-
-    if (!trip->canTransitionTo(TRIP_ONGOING)) {
-        cout << "Trip cannot be started from current state (" << trip->getStateString() << ")." << endl;
-        return false;
+    else if (type == CMD_REQUEST_TRIP_ASYNC) {
+        return requestTripAsync(args[0], args[1], args[2], nullptr, nullptr, args[3]);
     }
-
-    Driver* driver = findDriver(trip->getDriverId());
-
-    // Record operation for rollback
-    Operation op(OP_TRIP_STARTED, tripId, trip->getDriverId());
-    op.previousTripState = trip->getState();
-    if (driver) {
-        op.previousDriverLocation = driver->getCurrentLocationId();
+    else if (type == CMD_ASSIGN_TRIP) {
+        return assignTrip(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_POOL_TRIP) {
+        return assignPooledTrip(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_COMMIT_POOL) {
+        return commitPooledTrip(args[0], candidates, args[1]) ? 1 : 0;
+    }
+    else if (type == CMD_START_TRIP) {
+        return startTrip(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_COMPLETE_TRIP) {
+        return completeTrip(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_CANCEL_TRIP) {
+        return cancelTrip(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_REJECT_TRIP) {
+        return rejectTrip(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_ROLLBACK) {
+        return rollback(args[0]) ? 1 : 0;
+    }
+    else if (type == CMD_UPDATE_LOCATION) {
+        return updateDriverLocation(args[0], args[1]) ? 1 : 0;
+    }
+    else if (type == CMD_REBALANCE) {
+        return rebalanceIdleDrivers();
+    }
+    else if (type == CMD_DISPATCH_WAITING) {
+        return dispatchWaitingTrips();
+    }
+    else if (type == CMD_COMMIT_ASSIGNMENT) {
+        return commitAssignment(args[0], candidates, args[1]) ? 1 : 0;
+    }
+    else if (type == CMD_FINISH_REJECT) {
+        return finishReject(args[0], candidates, args[1], args[2]);
     }
-    rollbackMgr.recordOperation(op);
 
-    // Start the trip
-    trip->transitionTo(TRIP_ONGOING);
+    cout << "Unknown command type." << endl;
+    return -1;
+}
 
-    // Move driver to pickup location
-    if (driver) {
-        driver->setCurrentLocationId(trip->getPickupLocationId());
-    }
+int RideShareSystem::getDispatchStatus(int tripId) {
+    Trip trip;
+    return getTripSnapshot(tripId, trip) ? trip.getDispatchStatus() : -1;
+}
 
-    cout << "Trip " << tripId << " is now ongoing." << endl;
-    return true;
+static void copyDriver(const Driver* driver, DriverSnapshot& out) {
+    out.id = driver->getId();
+    out.name = driver->getName();
+    DriverPosition position = driver->getPosition();  // One consistent read
+    out.locationId = positionLocation(position);
+    out.zoneId = positionZone(position);
+    out.status = positionStatus(position);
+    out.tripsCompleted = driver->getTotalTripsCompleted();
+    out.distanceCovered = driver->getTotalDistanceCovered();
+    out.queuedTripId = driver->getQueuedTripId();
+    out.capabilities = driver->getCapabilities();
+    out.seatCount = driver->getSeatCount();
 }
 
-bool RideShareSystem::completeTrip(int tripId) {
-    Trip* trip = findTrip(tripId);
-    if (!trip) {
-        cout << "Trip not found." << endl;
+bool RideShareSystem::getTripSnapshot(int tripId, Trip& out) {
+    if (tripId < 0) {
         return false;
     }
 
-    if (!trip->canTransitionTo(TRIP_COMPLETED)) {
-        cout << "Trip cannot be completed from current state (" << trip->getStateString() << ")." << endl;
-        return false;
+    // Stripe first (a writer changing this trip holds it), then storage
+    // shared so the array cannot move while the record is copied
+    lock_guard<mutex> stripe(tripStripes[handleSlot(tripId) % TRIP_LOCK_STRIPES]);
+    shared_lock<shared_mutex> storage(storageLock);
+    int slot = tripHandles.find(tripId);
+    if (slot >= 0) {
+        out = trips[slot];
+        return true;
     }
+    return archive.load(tripId, out);
+}
 
-    Driver* driver = findDriver(trip->getDriverId());
-
-    // Record operation for rollback
-    Operation op(OP_TRIP_COMPLETED, tripId, trip->getDriverId());
-    op.previousTripState = trip->getState();
-    op.tripDistance = trip->getDistance();
-    if (driver) {
-        op.previousDriverStatus = driver->getStatus();
-        op.previousDriverLocation = driver->getCurrentLocationId();
-        op.previousDriverTripsCompleted = driver->getTotalTripsCompleted();
-        op.previousDriverDistanceCovered = driver->getTotalDistanceCovered();
+bool RideShareSystem::getDriverSnapshot(int driverId, DriverSnapshot& out) {
+    if (driverId < 0) {
+        return false;
     }
-    rollbackMgr.recordOperation(op);
-
-    // Complete the trip
-    trip->transitionTo(TRIP_COMPLETED);
 
-    // Update driver stats and location
-    if (driver) {
-        driver->setCurrentLocationId(trip->getDropoffLocationId());
-        driver->setZoneId(city.getLocationZone(trip->getDropoffLocationId()));
-        driver->completeTrip(trip->getDistance());
-        driver->setStatus(DRIVER_AVAILABLE);
+    lock_guard<mutex> stripe(driverStripes[driverId % DRIVER_LOCK_STRIPES]);
+    shared_lock<shared_mutex> storage(storageLock);
+    int slot = driverSlots.find(driverId);
+    if (slot < 0) {
+        return false;
     }
 
-    cout << "Trip " << tripId << " completed. Distance: " << trip->getDistance() << endl;
+    copyDriver(fleet.at(slot), out);
     return true;
 }
 
-bool RideShareSystem::cancelTrip(int tripId) {
-    Trip* trip = findTrip(tripId);
-    if (!trip) {
-        cout << "Trip not found." << endl;
-        return false;
+void RideShareSystem::publishSnapshot() {
+    // Declared before the guards: the version it replaces is freed after
+    // both are released
+    shared_ptr<const StateSnapshot> previous;
+
+    // The chunk copies stay under the commit lock so the snapshot is one
+    // cut; only changed chunks are copied (see design.md for the cost)
+    lock_guard<mutex> guard(commitMutex);
+    {
+        lock_guard<mutex> reading(publishedLock);
+        previous = publishedState;
     }
-
-    if (!trip->canTransitionTo(TRIP_CANCELLED)) {
-        cout << "Trip cannot be cancelled from current state (" << trip->getStateString() << ")." << endl;
-        return false;
+    bool sameMap = previous && previous->city->version == city.getVersion();
+    if (sameMap && previous->version == commitVersion) {
+        return;  // Nothing changed since the last one
     }
 
-    Driver* driver = findDriver(trip->getDriverId());
+    shared_ptr<StateSnapshot> state(new StateSnapshot(commitVersion, fleet.size(), trips.size()));
+
+    if (sameMap) {
+        state->city = previous->city;
+    } else {
+        int locationCount = city.getLocationCount();
+        shared_ptr<CitySnapshot> map(new CitySnapshot(city.getVersion(), locationCount,
+                                                      city.getRoadCount() / 2));
+        int road = 0;
+        for (int i = 0; i < locationCount; i++) {
+            Location* location = city.getLocation(i);
+            map->locationNames[i] = location->name;
+            map->locationZones[i] = location->zoneId;
+            // Two-way roads are stored as two edges: keep one
+            for (Edge* edge = location->adjacencyList; edge != nullptr; edge = edge->next) {
+                if (i < edge->destination && road < map->roadCount) {
+                    map->roadFrom[road] = i;
+                    map->roadTo[road] = edge->destination;
+                    map->roadDistance[road] = edge->weight;
+                    road++;
+                }
+            }
+        }
+        map->roadCount = road;
+        state->city = map;
+    }
 
-    // Record operation for rollback
-    Operation op(OP_TRIP_CANCELLED, tripId, trip->getDriverId());
-    op.previousTripState = trip->getState();
-    if (driver) {
-        op.previousDriverStatus = driver->getStatus();
-        op.previousDriverLocation = driver->getCurrentLocationId();
+    // Copy only the chunks changed since the previous version (or resized)
+    for (int c = 0; c < state->driverChunkCount; c++) {
+        int first = c * SNAPSHOT_CHUNK_SIZE;
+        int count = fleet.size() - first < SNAPSHOT_CHUNK_SIZE ? fleet.size() - first
+                                                               : SNAPSHOT_CHUNK_SIZE;
+        bool unchanged = previous && c < previous->driverChunkCount &&
+                         c < driverChunkVersions.size() &&
+                         driverChunkVersions[c] <= previous->version &&
+                         previous->driverChunks[c]->count == count;
+        if (unchanged) {
+            state->driverChunks[c] = previous->driverChunks[c];
+            continue;
+        }
+        shared_ptr<DriverChunk> chunk(new DriverChunk());
+        chunk->count = count;
+        for (int i = 0; i < count; i++) {
+            const Driver* driver = fleet.at(first + i);
+            copyDriver(driver, chunk->drivers[i]);
+            chunk->poolStops[i] = ridePool.getStopCount(driver->getId());
+        }
+        state->driverChunks[c] = chunk;
+    }
+    for (int c = 0; c < state->tripChunkCount; c++) {
+        int first = c * SNAPSHOT_CHUNK_SIZE;
+        int count = trips.size() - first < SNAPSHOT_CHUNK_SIZE ? trips.size() - first
+                                                               : SNAPSHOT_CHUNK_SIZE;
+        bool unchanged = previous && c < previous->tripChunkCount &&
+                         c < tripChunkVersions.size() &&
+                         tripChunkVersions[c] <= previous->version &&
+                         previous->tripChunks[c]->count == count;
+        if (unchanged) {
+            state->tripChunks[c] = previous->tripChunks[c];
+            continue;
+        }
+        shared_ptr<TripChunk> chunk(new TripChunk());
+        chunk->count = count;
+        for (int i = 0; i < count; i++) {
+            chunk->trips[i] = trips[first + i];
+        }
+        state->tripChunks[c] = chunk;
     }
-    rollbackMgr.recordOperation(op);
 
-    // Cancel the trip
-    trip->transitionTo(TRIP_CANCELLED);
+    AnalyticsSnapshot& analytics = state->analytics;
+    analytics.totalTrips = trips.size() + archive.size();
+    analytics.archivedTrips = archive.size();
+    analytics.completedTrips = countCompleted();
+    analytics.cancelledTrips = archive.getCancelledCount() +
+                               tripIndex.getCount(TRIP_INDEX_BY_STATE, TRIP_CANCELLED);
+    long long completedDistance = archive.getCompletedDistance() +
+                                  tripIndex.getDistanceSum(TRIP_INDEX_BY_STATE, TRIP_COMPLETED);
+    analytics.averageTripDistance = analytics.completedTrips > 0
+        ? (double)completedDistance / analytics.completedTrips : 0.0;
+    analytics.tripRecordBytes = getTripRecordBytes();
+    analytics.bytesPerTrip = getBytesPerTrip();
+    analytics.bytesPerDriver = getBytesPerDriver();
+
+    // Readers still holding the previous one keep it until they let go.
+    // std::atomic_store on a shared_ptr would take a hidden global lock
+    // anyway (libstdc++ hashes into a shared mutex pool); this one is ours.
+    lock_guard<mutex> swapping(publishedLock);
+    publishedState = state;
+}
 
-    // Restore driver availability if assigned
-    if (driver) {
-        driver->setStatus(DRIVER_AVAILABLE);
+shared_ptr<const StateSnapshot> RideShareSystem::getStateSnapshot() const {
+    lock_guard<mutex> reading(publishedLock);
+    return publishedState;
+}
+
+int RideShareSystem::copyLiveTrips(Trip* out, int maxTrips) {
+    // IDs first under storage, then each record under its own stripe; a
+    // trip rolled back in between is skipped. Each copy is consistent, the
+    // list is not one cut (published snapshots give that).
+    int* ids = new int[maxTrips > 0 ? maxTrips : 1];
+    int count;
+    {
+        shared_lock<shared_mutex> reading(storageLock);
+        count = trips.size() < maxTrips ? trips.size() : maxTrips;
+        for (int i = 0; i < count; i++) {
+            ids[i] = trips[i].getId();
+        }
     }
 
-    cout << "Trip " << tripId << " cancelled." << endl;
-    return true;
+    int copied = 0;
+    for (int i = 0; i < count; i++) {
+        if (getTripSnapshot(ids[i], out[copied])) {
+            copied++;
+        }
+    }
+    delete[] ids;
+    return copied;
+}
+
+bool RideShareSystem::dispatchQueuedTrip(int tripId, int pickupLocationId, int pickupZoneId,
+                                         int requiredCapabilities) {
+    // Search phase runs in parallel across shards; only the claim/commit serializes
+    DriverCandidate candidates[DISPATCH_CANDIDATE_COUNT];
+    bool optimal;
+    int found = searchCandidates(pickupLocationId, pickupZoneId, requiredCapabilities,
+                                 candidates, dispatchBudgetMicros, optimal);
+    return submitAssignment(tripId, candidates, found);
 }
 
 bool RideShareSystem::rollback(int k) {
@@ -283,30 +1667,50 @@ bool RideShareSystem::rollback(int k) {
         return false;
     }
 
+    CommitGuard guard(*this);
+
+    // Drivers freed here stay idle: matching them would record new
+    // operations, and the next rollback would undo those instead of
+    // reaching older history. dispatchWaitingTrips() matches them.
+    rollingBack = true;
     int rolledBack = 0;
     for (int i = 0; i < k && rollbackMgr.canRollback(); i++) {
         Operation op = rollbackMgr.popOperation();
         Trip* trip = findTrip(op.tripId);
         Driver* driver = findDriver(op.driverId);
+        if (trip) {
+            trip->setHistoryOps(trip->getHistoryOps() - 1);
+        }
 
         // Using if-else instead of switch (no enum)
         if (op.type == OP_TRIP_CREATED) {
-            // Remove the trip (mark as invalid)
+            // Remove the trip; its slot is reused under a new generation
             if (trip) {
-                // We can't truly delete from array, so we decrement count
-                // This works because we add sequentially
-                if (op.tripId == tripCount - 1) {
-                    tripCount--;
-                }
+                rebalancer.forgetRequest(city.getLocationZone(trip->getPickupLocationId()));
+                unique_lock<shared_mutex> moving(storageLock);
+                removeTripSlot(tripHandles.find(op.tripId));
+                trip = nullptr;
             }
+            pendingTrips.remove(op.tripId);
             cout << "Rolled back: Trip " << op.tripId << " creation." << endl;
         }
         else if (op.type == OP_TRIP_ASSIGNED) {
             if (trip) {
                 trip->setState(op.previousTripState);
                 trip->setDriverId(-1);
+                trip->setDispatchStatus(DISPATCH_NONE);
             }
-            if (driver) {
+            restorePending(trip, op.previousPending);
+            if (driver && trip && trip->isPooled()) {
+                trip->setPooled(false);
+                ridePool.removeTrip(driver->getId(), op.tripId);
+                driver->setStatus(op.previousDriverStatus);
+            }
+            else if (driver && op.queuedBehind) {
+                driver->setQueuedTripId(-1);
+            }
+            else if (driver) {
+                driver->setActiveTripId(-1);
                 driver->setStatus(op.previousDriverStatus);
             }
             cout << "Rolled back: Trip " << op.tripId << " assignment." << endl;
@@ -315,8 +1719,16 @@ bool RideShareSystem::rollback(int k) {
             if (trip) {
                 trip->setState(op.previousTripState);
             }
-            if (driver) {
-                driver->setCurrentLocationId(op.previousDriverLocation);
+            if (driver && trip && trip->isPooled()) {
+                ridePool.undoReachStop(driver->getId(), op.previousDriverLocation,
+                                       PoolStop(op.tripId, trip->getPickupLocationId(), true));
+                driver->moveTo(op.previousDriverLocation,
+                               city.getLocationZone(op.previousDriverLocation));
+            }
+            else if (driver) {
+                driver->moveTo(op.previousDriverLocation,
+                               city.getLocationZone(op.previousDriverLocation));
+                driver->clearRoute();
             }
             cout << "Rolled back: Trip " << op.tripId << " start." << endl;
         }
@@ -325,84 +1737,260 @@ bool RideShareSystem::rollback(int k) {
                 trip->setState(op.previousTripState);
             }
             if (driver) {
-                driver->setStatus(op.previousDriverStatus);
-                driver->setCurrentLocationId(op.previousDriverLocation);
+                // One store: no reader sees the old status at the new place
+                driver->setPosition(op.previousDriverLocation,
+                                    city.getLocationZone(op.previousDriverLocation),
+                                    op.previousDriverStatus);
                 driver->setTotalTripsCompleted(op.previousDriverTripsCompleted);
                 driver->setTotalDistanceCovered(op.previousDriverDistanceCovered);
             }
+
+            if (driver && trip && trip->isPooled()) {
+                ridePool.undoReachStop(driver->getId(), op.previousDriverLocation,
+                                       PoolStop(op.tripId, trip->getDropoffLocationId(), false));
+            }
+            else if (driver) {
+                // A next trip promoted on completion goes back in the queue slot
+                int promotedTripId = driver->getActiveTripId();
+                if (promotedTripId >= 0 && promotedTripId != op.tripId) {
+                    driver->setQueuedTripId(promotedTripId);
+                }
+                driver->setActiveTripId(op.tripId);
+                if (promotedTripId != op.tripId) {
+                    syncAwaiting(findTrip(promotedTripId));
+                }
+                if (trip) {
+                    driver->beginRoute(trip->getDropoffLocationId(),
+                                       city.getLocationZone(trip->getDropoffLocationId()),
+                                       city.getDistance(op.previousDriverLocation,
+                                                        trip->getDropoffLocationId()));
+                }
+            }
             cout << "Rolled back: Trip " << op.tripId << " completion." << endl;
         }
         else if (op.type == OP_TRIP_CANCELLED) {
             if (trip) {
                 trip->setState(op.previousTripState);
             }
-            if (driver) {
+            restorePending(trip, op.previousPending);
+            if (driver && trip && trip->isPooled()) {
+                PoolInsertion at;
+                at.pickupIndex = op.pickupStopIndex;
+                at.dropoffIndex = op.dropoffStopIndex;
+                ridePool.insertTrip(driver->getId(), op.tripId, trip->getPickupLocationId(),
+                                    trip->getDropoffLocationId(), at);
+                driver->setStatus(op.previousDriverStatus);
+            }
+            else if (driver && op.queuedBehind) {
+                driver->setQueuedTripId(op.tripId);
+            }
+            else if (driver) {
                 driver->setStatus(op.previousDriverStatus);
+                driver->setActiveTripId(op.tripId);
             }
             cout << "Rolled back: Trip " << op.tripId << " cancellation." << endl;
         }
+        else if (op.type == OP_TRIP_REASSIGNED) {
+            Driver* previousDriver = findDriver(op.previousDriverId);
+            if (trip) {
+                trip->setState(op.previousTripState);
+                trip->setDriverId(op.previousDriverId);
+                trip->setDispatchStatus(DISPATCH_ASSIGNED);
+            }
+            restorePending(trip, 0);
+            if (driver && op.queuedBehind) {
+                driver->setQueuedTripId(-1);
+            }
+            else if (driver) {
+                driver->setActiveTripId(-1);
+                driver->setStatus(op.previousDriverStatus);
+            }
+            if (driver && op.candidateDistance >= 0) {
+                // The rejection used up this fallback; offer it again
+                candidateCache.unpop(op.tripId, driver->getId(), op.candidateDistance);
+            }
+            if (previousDriver && op.previousQueuedBehind) {
+                previousDriver->setQueuedTripId(op.tripId);
+            }
+            else if (previousDriver) {
+                previousDriver->setStatus(DRIVER_BUSY);
+                previousDriver->setActiveTripId(op.tripId);
+            }
+            cout << "Rolled back: Trip " << op.tripId << " reassignment." << endl;
+        }
+        else if (op.type == OP_DRIVER_MOVED) {
+            if (driver) {
+                driver->moveTo(op.previousDriverLocation,
+                               city.getLocationZone(op.previousDriverLocation));
+            }
+            cout << "Rolled back: Driver " << op.driverId << " rebalancing move." << endl;
+        }
+
+        // Keep the secondary and reassignment indexes in step with the restored state
+        if (op.type == OP_TRIP_CREATED) {
+            awaitingPickup.remove(op.tripId);
+        } else {
+            if (trip) syncTripIndex(*trip);
+            syncAwaiting(trip);
+        }
         rolledBack++;
     }
+    rollingBack = false;
 
     cout << "Successfully rolled back " << rolledBack << " operation(s)." << endl;
+    if (pendingTrips.size() > 0) {
+        cout << pendingTrips.size() << " trip(s) waiting; dispatch them to use freed drivers." << endl;
+    }
     return rolledBack > 0;
 }
 
-// Analytics
-double RideShareSystem::getAverageTripDistance() const {
-    int completedCount = 0;
-    int totalDistance = 0;
+int RideShareSystem::dispatchWaitingTrips() {
+    CommitGuard guard(*this);
 
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].getState() == TRIP_COMPLETED) {
-            completedCount++;
-            totalDistance += trips[i].getDistance();
+    // Each match is an ordinary recorded assignment
+    int matched = 0;
+    for (int i = 0; i < fleet.size() && pendingTrips.size() > 0; i++) {
+        Driver* driver = fleet.at(i);
+        if (driver->getStatus() != DRIVER_AVAILABLE) continue;
+        if (matchPendingTrip(findDriver(driver->getId()), -1)) {
+            matched++;
         }
     }
+    cout << "Dispatched " << matched << " waiting trip(s)." << endl;
+    return matched;
+}
+
+// Analytics
+double RideShareSystem::getAverageTripDistance() const {
+    shared_lock<shared_mutex> reading(storageLock);
+    // Archive totals plus the completed list's running sum: no scan
+    int completedCount = countCompleted();
+    long long totalDistance = archive.getCompletedDistance() +
+                              tripIndex.getDistanceSum(TRIP_INDEX_BY_STATE, TRIP_COMPLETED);
 
     if (completedCount == 0) return 0.0;
     return (double)totalDistance / completedCount;
 }
 
 double RideShareSystem::getDriverUtilization(int driverId) const {
-    const Driver* driver = nullptr;
-    for (int i = 0; i < driverCount; i++) {
-        if (drivers[i].getId() == driverId) {
-            driver = &drivers[i];
-            break;
-        }
-    }
-
-    if (!driver) return 0.0;
-
-    int totalCompleted = getCompletedTripCount();
+    if (driverId < 0) return 0.0;
+    // The driver's stripe for its counters, then storage for the totals
+    lock_guard<mutex> stripe(driverStripes[driverId % DRIVER_LOCK_STRIPES]);
+    shared_lock<shared_mutex> reading(storageLock);
+    int slot = driverSlots.find(driverId);
+    if (slot < 0) return 0.0;
+    const Driver* driver = fleet.at(slot);
+
+    int totalCompleted = countCompleted();
     if (totalCompleted == 0) return 0.0;
 
     return (double)driver->getTotalTripsCompleted() / totalCompleted * 100.0;
 }
 
+int RideShareSystem::countCompleted() const {
+    return archive.getCompletedCount() + tripIndex.getCount(TRIP_INDEX_BY_STATE, TRIP_COMPLETED);
+}
+
 int RideShareSystem::getCompletedTripCount() const {
-    int count = 0;
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].getState() == TRIP_COMPLETED) {
-            count++;
-        }
-    }
-    return count;
+    shared_lock<shared_mutex> reading(storageLock);
+    return countCompleted();
 }
 
 int RideShareSystem::getCancelledTripCount() const {
-    int count = 0;
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].getState() == TRIP_CANCELLED) {
-            count++;
+    shared_lock<shared_mutex> reading(storageLock);
+    return archive.getCancelledCount() + tripIndex.getCount(TRIP_INDEX_BY_STATE, TRIP_CANCELLED);
+}
+
+int RideShareSystem::getTotalTripCount() const {
+    shared_lock<shared_mutex> reading(storageLock);
+    return trips.size() + archive.size();
+}
+
+int RideShareSystem::getArchivedTripCount() const {
+    shared_lock<shared_mutex> reading(storageLock);
+    return archive.size();
+}
+
+int RideShareSystem::getRiderTrips(int riderId, int* tripIds, int maxTrips) {
+    shared_lock<shared_mutex> reading(storageLock);
+    int written = 0;
+    for (int id = tripIndex.first(TRIP_INDEX_BY_RIDER, riderId); id >= 0 && written < maxTrips;
+         id = tripIndex.next(TRIP_INDEX_BY_RIDER, id)) {
+        tripIds[written++] = id;
+    }
+    return written + archive.collectByRider(riderId, tripIds + written, maxTrips - written);
+}
+
+int RideShareSystem::getDriverTrips(int driverId, int* tripIds, int maxTrips) {
+    shared_lock<shared_mutex> reading(storageLock);
+    int written = 0;
+    for (int id = tripIndex.first(TRIP_INDEX_BY_DRIVER, driverId); id >= 0 && written < maxTrips;
+         id = tripIndex.next(TRIP_INDEX_BY_DRIVER, id)) {
+        tripIds[written++] = id;
+    }
+    return written + archive.collectByDriver(driverId, tripIds + written, maxTrips - written);
+}
+
+int RideShareSystem::getTripsInState(int state, int* tripIds, int maxTrips) {
+    shared_lock<shared_mutex> reading(storageLock);
+    int written = 0;
+    for (int id = tripIndex.first(TRIP_INDEX_BY_STATE, state); id >= 0 && written < maxTrips;
+         id = tripIndex.next(TRIP_INDEX_BY_STATE, id)) {
+        tripIds[written++] = id;
+    }
+    return written;
+}
+
+int RideShareSystem::getLiveTripCountInState(int state) {
+    shared_lock<shared_mutex> reading(storageLock);
+    return tripIndex.getCount(TRIP_INDEX_BY_STATE, state);
+}
+
+int RideShareSystem::getActiveTripForRider(int riderId) {
+    // Archived trips are terminal, so only the live list can hold it. The
+    // state is atomic, so the record needs no stripe to be read here.
+    shared_lock<shared_mutex> reading(storageLock);
+    for (int id = tripIndex.first(TRIP_INDEX_BY_RIDER, riderId); id >= 0;
+         id = tripIndex.next(TRIP_INDEX_BY_RIDER, id)) {
+        int slot = tripHandles.find(id);
+        if (slot >= 0 && trips[slot].isActive()) {
+            return id;
         }
     }
-    return count;
+    return -1;
 }
 
-int RideShareSystem::getTotalTripCount() const {
-    return tripCount;
+int RideShareSystem::getTripRecordBytes() const {
+    return (int)sizeof(Trip);
+}
+
+int RideShareSystem::getBytesPerTrip() const {
+    return getTripRecordBytes() + HandleTable::getBytesPerSlot() +
+           TripIndex::getBytesPerTrip() +
+           PendingTripQueue::getBytesPerTrip() * 2 +  // Pending and awaiting pickup
+           RidePool::getBytesPerTrip() + CandidateCache::getBytesPerTrip();
+}
+
+int RideShareSystem::getBytesPerDriver() const {
+    return DriverTable::getBytesPerDriver();
+}
+
+double RideShareSystem::getArchivedBytesPerTrip() const {
+    shared_lock<shared_mutex> reading(storageLock);
+    if (archive.size() == 0) {
+        return 0.0;
+    }
+    return (double)archive.getByteSize() / archive.size();
+}
+
+int RideShareSystem::getAwaitingPickupCount() const {
+    lock_guard<mutex> guard(commitMutex);
+    return awaitingPickup.size();
+}
+
+int RideShareSystem::getPendingTripCount() const {
+    lock_guard<mutex> guard(commitMutex);
+    return pendingTrips.size();
 }
 
 // Getters
@@ -411,11 +1999,11 @@ City& RideShareSystem::getCity() {
 }
 
 int RideShareSystem::getDriverCount() const {
-    return driverCount;
+    return fleet.size();
 }
 
 int RideShareSystem::getRiderCount() const {
-    return riderCount;
+    return riders.size();
 }
 
 // Display methods
@@ -425,66 +2013,94 @@ void RideShareSystem::displayCity() const {
 
 void RideShareSystem::displayDrivers() const {
     cout << "\n=== Drivers ===" << endl;
-    if (driverCount == 0) {
+    if (fleet.size() == 0) {
         cout << "No drivers registered." << endl;
         return;
     }
-    for (int i = 0; i < driverCount; i++) {
-        drivers[i].display();
+    for (int i = 0; i < fleet.size(); i++) {
+        fleet.at(i)->display();
     }
 }
 
 void RideShareSystem::displayRiders() const {
     cout << "\n=== Riders ===" << endl;
-    if (riderCount == 0) {
+    if (riders.size() == 0) {
         cout << "No riders registered." << endl;
         return;
     }
-    for (int i = 0; i < riderCount; i++) {
+    for (int i = 0; i < riders.size(); i++) {
         riders[i].display();
     }
 }
 
 void RideShareSystem::displayTrips() const {
+    lock_guard<mutex> guard(commitMutex);
     cout << "\n=== Trips ===" << endl;
-    if (tripCount == 0) {
+    if (trips.size() + archive.size() == 0) {
         cout << "No trips recorded." << endl;
         return;
     }
-    for (int i = 0; i < tripCount; i++) {
+    for (int i = 0; i < trips.size(); i++) {
         trips[i].display();
     }
+    if (archive.size() > 0) {
+        cout << "(" << archive.size() << " settled trips archived)" << endl;
+    }
 }
 
 void RideShareSystem::displayAnalytics() const {
     cout << "\n=== Analytics ===" << endl;
-    cout << "Total Trips: " << tripCount << endl;
+    cout << "Total Trips: " << getTotalTripCount() << endl;
     cout << "Completed Trips: " << getCompletedTripCount() << endl;
     cout << "Cancelled Trips: " << getCancelledTripCount() << endl;
     cout << "Average Trip Distance: " << getAverageTripDistance() << endl;
+    cout << "Record Size: " << getTripRecordBytes() << " bytes/trip record ("
+         << getBytesPerTrip() << " with side tables), "
+         << getBytesPerDriver() << " bytes/driver" << endl;
 
     cout << "\nDriver Utilization:" << endl;
-    for (int i = 0; i < driverCount; i++) {
-        cout << "  Driver " << i << " (" << drivers[i].getName() << "): "
+    for (int i = 0; i < fleet.size(); i++) {
+        cout << "  Driver " << i << " (" << fleet.at(i)->getName() << "): "
              << getDriverUtilization(i) << "%" << endl;
     }
 }
 
 void RideShareSystem::displayOperationHistory() const {
+    lock_guard<mutex> guard(commitMutex);
     rollbackMgr.displayHistory();
 }
 
 // For testing
 Driver* RideShareSystem::getDriver(int index) {
-    if (index < 0 || index >= driverCount) return nullptr;
-    return &drivers[index];
+    if (index < 0 || index >= fleet.size()) return nullptr;
+    return fleet.at(index);
 }
 
-Trip* RideShareSystem::getTrip(int index) {
-    if (index < 0 || index >= tripCount) return nullptr;
+Trip* RideShareSystem::getTrip(int tripId) {
+    int slot = tripHandles.find(tripId);
+    return (slot >= 0) ? &trips[slot] : nullptr;
+}
+
+int RideShareSystem::getLiveTripCount() const {
+    shared_lock<shared_mutex> reading(storageLock);
+    return trips.size();
+}
+
+Trip* RideShareSystem::getLiveTrip(int index) {
+    if (index < 0 || index >= trips.size()) return nullptr;
     return &trips[index];
 }
 
+int RideShareSystem::getCandidateCount(int tripId) const {
+    lock_guard<mutex> guard(commitMutex);
+    return candidateCache.getCount(tripId);
+}
+
+int RideShareSystem::getRemainingCandidates(int tripId) const {
+    lock_guard<mutex> guard(commitMutex);
+    return candidateCache.getRemaining(tripId);
+}
+
 int RideShareSystem::getDistance(int from, int to) {
     return city.getDistance(from, to);
 }
@@ -7,54 +7,292 @@
 #include "Trip.h"
 #include "DispatchEngine.h"
 #include "RollbackManager.h"
+#include "DispatchRuntime.h"
+#include "CommandLoop.h"
+#include "PendingTripQueue.h"
+#include "RidePool.h"
+#include "ZoneRebalancer.h"
+#include "IdIndex.h"
+#include "HandleTable.h"
+#include "TripIndex.h"
+#include "TripArchive.h"
+#include "StateSnapshot.h"
+#include <mutex>
+#include <shared_mutex>
+
+// Minimum effective-distance saving before an assigned trip moves to a
+// driver who just became free (negative disables reassignment)
+const int DEFAULT_REASSIGN_MIN_SAVING = 3;
+
+// Lock stripes for record reads (32 in total): a trip's stripe is its
+// handle slot modulo the count, a driver's its ID modulo the count
+const int TRIP_LOCK_STRIPES = 16;
+const int DRIVER_LOCK_STRIPES = 16;
+static_assert(TRIP_LOCK_STRIPES + DRIVER_LOCK_STRIPES <= 32, "held stripes fit one mask");
+
+// finishReject result: no cached fallback is free, search and try again
+const int REJECT_NEEDS_SEARCH = -1;
 
 class RideShareSystem {
 private:
     City city;
-    Driver* drivers;
-    int driverCount;
-    int driverCapacity;
+    // Drivers as columns; Driver objects are views into it
+    DriverTable fleet;
+
+    GrowableArray<Rider> riders;
+    GrowableArray<Trip> trips;  // Live trips; growth moves the array: only under storageLock
+    // Trip IDs are generational handles onto the live array: any trip can be
+    // removed in O(1) and its slot reused, and stale IDs no longer resolve
+    HandleTable tripHandles;
+    // Live trips by rider, driver and state (kept in step with every change)
+    TripIndex tripIndex;
 
-    Rider* riders;
-    int riderCount;
-    int riderCapacity;
+    // Settled trips (terminal, no operation left in the rollback window)
+    // leave the live array for a compact archive
+    TripArchive archive;
+    GrowableArray<int> settledTrips;  // Trip IDs to archive at the next request
 
-    Trip* trips;
-    int tripCount;
-    int tripCapacity;
+    // Ranked fallback drivers per dispatched trip, kept out of the trip records
+    CandidateCache candidateCache;
+
+    // Driver ID -> array slot, so lookups do not scan (slots survive resizes)
+    IdIndex driverSlots;
 
     DispatchEngine dispatcher;
     RollbackManager rollbackMgr;
+    bool forwardDispatch;  // Also offer trips to drivers finishing nearby
+    int dispatchBudgetMicros;  // Search time cap per dispatch (DISPATCH_NO_BUDGET = none)
 
-    // Helper methods
-    void resizeDrivers();
-    void resizeRiders();
-    void resizeTrips();
+    // Trips that found no driver, waiting by pickup zone
+    PendingTripQueue pendingTrips;
+
+    // Stop sequences of drivers carrying shared rides
+    RidePool ridePool;
+
+    // Assigned trips whose driver is still on the way, by pickup zone.
+    // Only these can move to a closer driver who frees up.
+    PendingTripQueue awaitingPickup;
+    int reassignMinSaving;
+    bool rollingBack;  // Set while rollback() undoes history; no swaps are recorded
+
+    // Idle-driver repositioning across zones
+    ZoneRebalancer rebalancer;
+
+    // Drivers partitioned by capability class for filtered dispatch
+    CapabilityIndex driverClasses;
+
+    // Zone-sharded dispatch workers (null until started)
+    DispatchRuntime* dispatchRuntime;
+    // Single writer thread applying queued mutations (null until started)
+    CommandLoop* commandLoop;
+
+    // Locking. commitMutex serializes state changes (dispatch searches run
+    // outside it), which also gives the rollback history one total order.
+    // A writer takes the stripe of every trip and driver it resolves through
+    // findTrip/findDriver and keeps it until the commit ends, so readers copy
+    // a single record under its stripe alone. Stripes are ordered (trip
+    // stripes, then driver stripes): a writer blocks only on a stripe above
+    // all it holds and spins on try_lock otherwise (see holdStripe).
+    // storageLock is taken exclusively to move records (growth, swap-removal,
+    // archiving) and to change the trip index or the archive; readers of
+    // those hold it shared and never the commit lock.
+    // Order: commitMutex, stripes (ascending), storageLock.
+    mutable mutex commitMutex;
+    mutable mutex tripStripes[TRIP_LOCK_STRIPES];
+    mutable mutex driverStripes[DRIVER_LOCK_STRIPES];
+    unsigned int heldStripes;  // Bit per stripe taken by the current writer (trips first)
+    mutable shared_mutex storageLock;
+    long long commitVersion;  // Commit sections that changed a record (under commitMutex)
+    bool recordsChanged;      // The current commit section marked a chunk
+    // Per SNAPSHOT_CHUNK_SIZE slots: the commitVersion that last changed the
+    // chunk, so a publish copies only those and shares the rest
+    GrowableArray<long long> tripChunkVersions;
+    GrowableArray<long long> driverChunkVersions;
+
+    // Latest published state. publishedLock is held only to copy or swap
+    // the pointer (a reference count change), never while building one.
+    shared_ptr<const StateSnapshot> publishedState;
+    mutable mutex publishedLock;
+
+    // Commit section: on exit releases the writer's stripes, then commitMutex.
+    // Only sections that changed a record advance commitVersion.
+    class CommitGuard {
+    private:
+        RideShareSystem& owner;
+
+    public:
+        explicit CommitGuard(RideShareSystem& system);
+        ~CommitGuard();
+    };
 
+    // Helper methods
+    void recordHistory(const Operation& op);  // Record for rollback; tracks settled trips
+    void archiveSettledTrips();
+    void removeTripSlot(int slot);  // Caller holds storageLock exclusively
+    // Writer lookups (inside a CommitGuard): hold the record's stripe and
+    // mark its snapshot chunk changed
     Trip* findTrip(int tripId);
     Driver* findDriver(int driverId);
+    void markChunkChanged(GrowableArray<long long>& chunkVersions, int slot);
+    void holdStripe(int stripe);  // Global stripe number: trips, then drivers
+    void syncTripIndex(const Trip& trip);  // Re-key under storageLock for index readers
+    int countCompleted() const;  // Caller holds storageLock (shared is enough)
+
+    // Dispatch helpers: search is read-only (and falls back to one unbudgeted
+    // search if the budget ran out with nobody found), commit claims a driver
+    int searchCandidates(int pickupLocationId, int pickupZoneId, int requiredCapabilities,
+                         DriverCandidate* candidates, int budgetMicros, bool& optimal);
+    void cacheCandidates(Trip* trip, const DriverCandidate* candidates, int found);
+    Driver* claimNextCandidate(Trip* trip, bool& queuedBehind);
+    // Claim and record only; the search (widened if the budget found
+    // nobody) already ran outside the lock
+    bool commitAssignment(int tripId, const DriverCandidate* candidates, int found);
+    // commitAssignment on the writer in single-writer mode, inline otherwise
+    bool submitAssignment(int tripId, const DriverCandidate* candidates, int found);
+    bool recordAssignment(Trip* trip, Driver* driver, bool queuedBehind);
+    void releaseClaim(Driver* driver, int tripId, bool queuedBehind);
+    // Rejection under the lock: falls back to a cached candidate, or (given
+    // no candidates) returns REJECT_NEEDS_SEARCH without changing anything
+    int finishReject(int tripId, const DriverCandidate* candidates, int found,
+                     int rejectingDriverId);
+    // finishReject on the writer in single-writer mode, inline otherwise
+    int submitReject(int tripId, const DriverCandidate* candidates, int found,
+                     int rejectingDriverId);
+    // Pooling under the lock: price the searched idle drivers and the
+    // pooling ones, then claim and insert; a trip with no fit waits
+    bool commitPooledTrip(int tripId, const DriverCandidate* candidates, int found);
+    // commitPooledTrip on the writer in single-writer mode, inline otherwise
+    bool submitPooledTrip(int tripId, const DriverCandidate* candidates, int found);
+    bool placePooledTrip(Trip* trip, const DriverCandidate* candidates, int found);
+    void reportLostTransition(int tripId, const string& action, int actualState);
+
+    // Pending-trip helpers (event driven: run when a driver frees up)
+    void queuePendingTrip(Trip* trip);
+    void restorePending(Trip* trip, int wasPending);
+    bool matchPendingTrip(Driver* driver, int skipTripId);
+    int nextServablePending(int tripId, Driver* driver, int skipTripId);
+
+    // Reassignment optimizer (event driven: run when a driver frees up)
+    void syncAwaiting(Trip* trip);
+    Driver* reassignToFreedDriver(Driver* driver, int skipTripId);
+    void onDriverFreed(Driver* driver, int skipTripId);
 
 public:
     RideShareSystem();
     ~RideShareSystem();
 
+    // Owns raw arrays, locks and worker threads
+    RideShareSystem(const RideShareSystem&) = delete;
+    RideShareSystem& operator=(const RideShareSystem&) = delete;
+
+    // Capacity hints: grow storage once up front instead of doubling
+    // under load (drivers before starting dispatch workers)
+    void reserve(int locationCapacity, int driverCapacity, int riderCapacity, int tripCapacity,
+                 int roadCapacity = 0);
+
     // City setup
     int addLocation(const string& name, int zoneId);
     void addRoad(int from, int to, int distance);
 
-    // Driver and Rider management
-    int addDriver(const string& name, int locationId, int zoneId);
+    // Dispatch cost configuration (set before starting dispatch workers)
+    void setZonePenalty(int driverZone, int pickupZone, int percent);
+    void setHourMultiplier(int hour, int percent);
+    void setCurrentHour(int hour);
+    int getEffectiveDistance(int actualDistance, int driverZone, int pickupZone) const;
+    void setForwardDispatch(bool enabled);
+    void setDispatchBudget(int budgetMicros);  // Default budget for every dispatch search
+    void setReassignThreshold(int minSaving);
+
+    // Driver and Rider management. Drivers are added and re-tagged before
+    // dispatch workers or the command loop start; both refuse while running.
+    int addDriver(const string& name, int locationId, int zoneId,
+                  int capabilities = CAP_NONE, int seatCount = DEFAULT_SEAT_COUNT);
+    // Re-tag a vehicle
+    bool setDriverCapabilities(int driverId, int capabilities, int seatCount);
+    int getEligibleDriverCount(int requiredCapabilities) const;
     int addRider(const string& name);
+    // Position report; refreshes the remaining-route estimate of an ongoing trip
+    bool updateDriverLocation(int driverId, int locationId);
 
     // Trip operations (core functionality)
-    int requestTrip(int riderId, int pickupId, int dropoffId);
+    int requestTrip(int riderId, int pickupId, int dropoffId,
+                    int requiredCapabilities = CAP_NONE);
     bool assignTrip(int tripId);
+    // Best driver found within budgetMicros; optimal tells whether the search
+    // proved nobody better exists. Finding nobody before the budget runs out
+    // falls back to an unbudgeted search, then to the pending queue.
+    bool assignTrip(int tripId, int budgetMicros, bool& optimal);
     bool startTrip(int tripId);
     bool completeTrip(int tripId);
     bool cancelTrip(int tripId);
+    bool rejectTrip(int tripId);  // Assigned driver declines; fall back to next candidate
+    // Shared ride: insert pickup and dropoff where they add the least distance
+    // to an idle or already-pooling driver's route (seat and detour limits apply)
+    bool assignPooledTrip(int tripId);
+    int getPoolStopCount(int driverId) const;
 
-    // Rollback functionality
+    // Parallel dispatch (one worker per zone). Register drivers and
+    // locations before starting; the search phase reads them unlocked.
+    void startDispatchWorkers();
+    void stopDispatchWorkers();
+    bool isDispatchRunning() const;
+    // Assign via the workers when running (waits for the result), inline otherwise
+    bool dispatchTrip(int tripId);
+    // Create a trip and queue it for background assignment; returns the trip ID
+    // without waiting. Completion is reported through the callback (on a
+    // worker thread) and can be polled with getDispatchStatus().
+    int requestTripAsync(int riderId, int pickupId, int dropoffId,
+                         DispatchCallback callback = nullptr, void* context = nullptr,
+                         int requiredCapabilities = CAP_NONE);
+    int getDispatchStatus(int tripId);  // DISPATCH_* constant, -1 if no such trip
+
+    // Concurrent reads (HTTP workers): copy one record under its lock stripe
+    // without waiting for commits on other records. Live or archived trips.
+    bool getTripSnapshot(int tripId, Trip& out);
+    bool getDriverSnapshot(int driverId, DriverSnapshot& out);
+    // Up to maxTrips live trips, each copied under its own stripe (not one
+    // cut; use the published snapshot for that); returns how many
+    int copyLiveTrips(Trip* out, int maxTrips);
+    // Worker entry point: search without locks, then claim and commit (on the
+    // command writer when single-writer mode is on)
+    bool dispatchQueuedTrip(int tripId, int pickupLocationId, int pickupZoneId,
+                            int requiredCapabilities);
+
+    // Published state for lock-free readers (dashboards). publishSnapshot()
+    // takes one cut under the commit lock if anything changed since the last
+    // one and swaps it in under a pointer-sized lock. Only record chunks changed since then
+    // are copied; the rest, and the road map while it is the same, are
+    // shared with the previous version. getStateSnapshot() never waits for
+    // writers; it returns null before the first publish.
+    void publishSnapshot();
+    shared_ptr<const StateSnapshot> getStateSnapshot() const;
+
+    // Single-writer mode: mutations submitted through execute() are queued
+    // and applied in submission order by one writer thread. Stop it only
+    // once the submitting threads are done; dispatch workers submit too, so
+    // stop them first.
+    void startCommandLoop();
+    void stopCommandLoop();
+    bool isCommandLoopRunning() const;
+    int getAppliedCommandCount() const;  // Applied by the writer since it started
+    // Apply a CMD_* command (see CommandLoop.h) on the writer thread and wait
+    // for its result; inline when the loop is not running. Yes/no commands
+    // return 1 or 0.
+    int execute(int type, int arg0 = 0, int arg1 = 0, int arg2 = 0, int arg3 = 0);
+    // Writer entry point: run one command against the system
+    int applyCommand(int type, const int* args, const DriverCandidate* candidates = nullptr);
+
+    // Zone rebalancing: plan moves for idle drivers (read-only), or plan and
+    // apply them (drivers jump to the target hub and may take a waiting trip)
+    int planRebalance(RebalanceMove* moves, int maxMoves);
+    int rebalanceIdleDrivers();
+
+    // Rollback functionality. Undoes exactly k recorded operations; drivers
+    // it frees stay idle until the next event or dispatchWaitingTrips().
     bool rollback(int k = 1);
+    // Match idle drivers to waiting trips (new, recorded assignments);
+    // returns how many trips were assigned
+    int dispatchWaitingTrips();
 
     // Analytics
     double getAverageTripDistance() const;
@@ -62,6 +300,28 @@ public:
     int getCompletedTripCount() const;
     int getCancelledTripCount() const;
     int getTotalTripCount() const;
+    int getArchivedTripCount() const;
+    int getPendingTripCount() const;
+    int getAwaitingPickupCount() const;
+
+    // Secondary-index ranges: write up to maxTrips trip IDs and return how
+    // many were written, in O(result). Rider and driver histories list live
+    // trips newest first, then archived ones newest first; state ranges
+    // cover live trips (archived ones are only counted, see above).
+    int getRiderTrips(int riderId, int* tripIds, int maxTrips);
+    int getDriverTrips(int driverId, int* tripIds, int maxTrips);
+    int getTripsInState(int state, int* tripIds, int maxTrips);
+    int getLiveTripCountInState(int state);
+    int getActiveTripForRider(int riderId);  // Newest non-terminal trip, -1 if none
+
+    // Record footprint: the trip record alone; fixed bytes per live trip
+    // including its side tables (handle slot, index node, pending and
+    // awaiting entries, pool slot, and a candidate block while dispatching);
+    // per driver; and the average encoded size of an archived trip (0 if none)
+    int getTripRecordBytes() const;
+    int getBytesPerTrip() const;
+    int getBytesPerDriver() const;
+    double getArchivedBytesPerTrip() const;
 
     // Getters for display
     City& getCity();
@@ -76,9 +336,13 @@ public:
     void displayAnalytics() const;
     void displayOperationHistory() const;
 
-    // For testing
+    // For testing (unlocked: concurrent callers use the snapshots above)
     Driver* getDriver(int index);
-    Trip* getTrip(int index);
+    Trip* getTrip(int tripId);  // Live slots only; archived trips via getTripSnapshot
+    int getLiveTripCount() const;
+    Trip* getLiveTrip(int index);  // Live array order (not ID order)
+    int getCandidateCount(int tripId) const;  // Cached fallback drivers for a trip
+    int getRemainingCandidates(int tripId) const;  // Cached ones not yet tried
     int getDistance(int from, int to);
 };
 
@@ -8,96 +8,141 @@ const string OP_TYPE_NAMES[] = {
     "ASSIGNED",   // 1 = OP_TRIP_ASSIGNED
     "STARTED",    // 2 = OP_TRIP_STARTED
     "COMPLETED",  // 3 = OP_TRIP_COMPLETED
-    "CANCELLED"   // 4 = OP_TRIP_CANCELLED
+    "CANCELLED",  // 4 = OP_TRIP_CANCELLED
+    "REASSIGNED", // 5 = OP_TRIP_REASSIGNED
+    "MOVED"       // 6 = OP_DRIVER_MOVED
 };
 
 Operation::Operation()
-    : type(OP_TRIP_CREATED), tripId(-1), driverId(-1),
+    : type(OP_TRIP_CREATED), sequence(-1), tripId(-1), driverId(-1),
+      previousDriverId(-1), previousPending(0), queuedBehind(0), previousQueuedBehind(0),
+      pickupStopIndex(-1), dropoffStopIndex(-1), candidateDistance(-1),
       previousTripState(TRIP_REQUESTED), previousDriverStatus(DRIVER_AVAILABLE),
       previousDriverLocation(-1), previousDriverTripsCompleted(0),
       previousDriverDistanceCovered(0), tripDistance(0) {}
 
 Operation::Operation(int type, int tripId, int driverId)
-    : type(type), tripId(tripId), driverId(driverId),
+    : type(type), sequence(-1), tripId(tripId), driverId(driverId),
+      previousDriverId(-1), previousPending(0), queuedBehind(0), previousQueuedBehind(0),
+      pickupStopIndex(-1), dropoffStopIndex(-1), candidateDistance(-1),
       previousTripState(TRIP_REQUESTED), previousDriverStatus(DRIVER_AVAILABLE),
       previousDriverLocation(-1), previousDriverTripsCompleted(0),
       previousDriverDistanceCovered(0), tripDistance(0) {}
 
-RollbackManager::RollbackManager(int initialCapacity)
-    : top(-1), capacity(initialCapacity) {
-    operationStack = new Operation[capacity];
+RollbackManager::RollbackManager(int initialCapacity, int historyLimit)
+    : oldest(0), count(0), historyLimit(historyLimit > 0 ? historyLimit : 1), nextSequence(0) {
+    capacity = initialCapacity > 0 ? initialCapacity : 1;
+    if (capacity > this->historyLimit) {
+        capacity = this->historyLimit;
+    }
+    ring = new Operation[capacity];
 }
 
 RollbackManager::~RollbackManager() {
-    delete[] operationStack;
+    delete[] ring;
+}
+
+int RollbackManager::ringIndex(int depth) const {
+    return (oldest + depth) % capacity;
 }
 
-void RollbackManager::resize() {
+void RollbackManager::grow() {
     int newCapacity = capacity * 2;
-    Operation* newStack = new Operation[newCapacity];
+    if (newCapacity > historyLimit) {
+        newCapacity = historyLimit;
+    }
+    Operation* newRing = new Operation[newCapacity];
 
-    for (int i = 0; i <= top; i++) {
-        newStack[i] = operationStack[i];
+    // Unwrap so the bottom of the stack lands at index 0
+    for (int i = 0; i < count; i++) {
+        newRing[i] = ring[ringIndex(i)];
     }
 
-    delete[] operationStack;
-    operationStack = newStack;
+    delete[] ring;
+    ring = newRing;
+    oldest = 0;
     capacity = newCapacity;
 }
 
-void RollbackManager::recordOperation(const Operation& op) {
-    if (top + 1 >= capacity) {
-        resize();
+bool RollbackManager::recordOperation(const Operation& op, Operation& evicted) {
+    if (count == capacity && capacity < historyLimit) {
+        grow();
+    }
+
+    if (count == capacity) {
+        // Full at the limit: the new top overwrites the bottom
+        evicted = ring[oldest];
+        ring[oldest] = op;
+        ring[oldest].sequence = nextSequence++;
+        oldest = (oldest + 1) % capacity;
+        return true;
     }
-    operationStack[++top] = op;
+
+    int index = ringIndex(count++);
+    ring[index] = op;
+    ring[index].sequence = nextSequence++;
+    return false;
 }
 
 Operation RollbackManager::popOperation() {
-    if (top < 0) {
+    if (count == 0) {
         return Operation(); // Return empty operation
     }
-    return operationStack[top--];
+    return ring[ringIndex(--count)];
 }
 
 Operation RollbackManager::peekOperation() const {
-    if (top < 0) {
+    if (count == 0) {
         return Operation();
     }
-    return operationStack[top];
+    return ring[ringIndex(count - 1)];
 }
 
 bool RollbackManager::canRollback() const {
-    return top >= 0;
+    return count > 0;
 }
 
 int RollbackManager::getOperationCount() const {
-    return top + 1;
+    return count;
 }
 
 void RollbackManager::clear() {
-    top = -1;
+    oldest = 0;
+    count = 0;
 }
 
 void RollbackManager::displayHistory() const {
     cout << "\n=== Operation History (Stack) ===" << endl;
+    int top = count - 1;
     if (top < 0) {
         cout << "No operations recorded." << endl;
         return;
     }
 
     for (int i = top; i >= 0; i--) {
-        cout << "[" << (top - i + 1) << "] Trip " << operationStack[i].tripId << " ";
+        const Operation& op = ring[ringIndex(i)];
+        cout << "[" << (top - i + 1) << "] #" << op.sequence << " ";
+        if (op.type == OP_DRIVER_MOVED) {
+            cout << "Driver " << op.driverId << " MOVED from Location "
+                 << op.previousDriverLocation << endl;
+            continue;
+        }
+        cout << "Trip " << op.tripId << " ";
 
         // Use lookup array instead of switch
-        if (operationStack[i].type >= 0 && operationStack[i].type < OP_TYPE_COUNT) {
-            cout << OP_TYPE_NAMES[operationStack[i].type];
+        if (op.type >= 0 && op.type < OP_TYPE_COUNT) {
+            cout << OP_TYPE_NAMES[op.type];
         } else {
             cout << "UNKNOWN";
         }
 
         // Add driver info for assignment
-        if (operationStack[i].type == OP_TRIP_ASSIGNED) {
-            cout << " to Driver " << operationStack[i].driverId;
+        if (op.type == OP_TRIP_ASSIGNED) {
+            cout << " to Driver " << op.driverId;
+        }
+        else if (op.type == OP_TRIP_REASSIGNED) {
+            cout << " from Driver " << op.previousDriverId
+                 << " to Driver " << op.driverId;
         }
 
         cout << endl;
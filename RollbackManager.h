@@ -10,16 +10,29 @@ const int OP_TRIP_ASSIGNED = 1;
 const int OP_TRIP_STARTED = 2;
 const int OP_TRIP_COMPLETED = 3;
 const int OP_TRIP_CANCELLED = 4;
-const int OP_TYPE_COUNT = 5;
+const int OP_TRIP_REASSIGNED = 5;
+const int OP_DRIVER_MOVED = 6;  // Rebalancing move of an idle driver (tripId = -1)
+const int OP_TYPE_COUNT = 7;
 
 // Lookup array for operation names (declared in RollbackManager.cpp)
 extern const string OP_TYPE_NAMES[];
 
+// Operations kept for rollback; older ones fall off and become permanent
+const int ROLLBACK_HISTORY_LIMIT = 1000;
+
 // Stores all information needed to rollback an operation
 struct Operation {
     int type;  // Using int instead of enum
+    int sequence;  // Commit order, assigned when recorded (never reused)
     int tripId;
     int driverId;
+    int previousDriverId;  // Driver replaced by a reassignment
+    int previousPending;   // 1 if the trip was waiting in the pending queue
+    int queuedBehind;          // 1 if driverId holds the trip as its queued next trip
+    int previousQueuedBehind;  // Same for previousDriverId (reassignment only)
+    int pickupStopIndex;       // Shared-ride stop positions removed by a cancellation
+    int dropoffStopIndex;
+    int candidateDistance;     // Cached fallback a rejection used up (driverId), -1 if none
 
     // Previous state for rollback (using int instead of enum)
     int previousTripState;
@@ -33,20 +46,32 @@ struct Operation {
     Operation(int type, int tripId, int driverId);
 };
 
+// Bounded undo stack: a ring buffer holding the newest historyLimit
+// operations. Recording past the limit drops the oldest one.
+// Not locked itself: the owner records and pops inside its commit section,
+// so the stack order is the order in which the changes took effect.
 class RollbackManager {
 private:
-    Operation* operationStack;
-    int top;
-    int capacity;
+    Operation* ring;
+    int oldest;    // Ring index of the bottom of the stack
+    int count;
+    int capacity;  // Grows by doubling up to historyLimit
+    int historyLimit;
+    int nextSequence;
 
-    void resize();
+    void grow();
+    int ringIndex(int depth) const;  // depth 0 = bottom of the stack
 
 public:
-    RollbackManager(int initialCapacity = 100);
+    RollbackManager(int initialCapacity = 100, int historyLimit = ROLLBACK_HISTORY_LIMIT);
     ~RollbackManager();
 
-    // Stack operations
-    void recordOperation(const Operation& op);
+    RollbackManager(const RollbackManager&) = delete;
+    RollbackManager& operator=(const RollbackManager&) = delete;
+
+    // Stack operations. Returns true and fills evicted when the oldest
+    // operation had to make room (it can no longer be rolled back).
+    bool recordOperation(const Operation& op, Operation& evicted);
     Operation popOperation();
     Operation peekOperation() const;
 
@@ -0,0 +1,48 @@
+#include "StateSnapshot.h"
+using namespace std;
+
+CitySnapshot::CitySnapshot(int version, int locationCount, int roadCount)
+    : version(version), locationCount(locationCount), roadCount(roadCount) {
+    locationNames = new string[locationCount > 0 ? locationCount : 1];
+    locationZones = new int[locationCount > 0 ? locationCount : 1];
+    roadFrom = new int[roadCount > 0 ? roadCount : 1];
+    roadTo = new int[roadCount > 0 ? roadCount : 1];
+    roadDistance = new int[roadCount > 0 ? roadCount : 1];
+}
+
+CitySnapshot::~CitySnapshot() {
+    delete[] locationNames;
+    delete[] locationZones;
+    delete[] roadFrom;
+    delete[] roadTo;
+    delete[] roadDistance;
+}
+
+DriverChunk::DriverChunk() : count(0) {}
+
+TripChunk::TripChunk() : count(0) {}
+
+StateSnapshot::StateSnapshot(long long version, int driverCount, int tripCount)
+    : version(version), driverCount(driverCount), tripCount(tripCount), analytics() {
+    driverChunkCount = (driverCount + SNAPSHOT_CHUNK_SIZE - 1) / SNAPSHOT_CHUNK_SIZE;
+    tripChunkCount = (tripCount + SNAPSHOT_CHUNK_SIZE - 1) / SNAPSHOT_CHUNK_SIZE;
+    driverChunks = new shared_ptr<const DriverChunk>[driverChunkCount > 0 ? driverChunkCount : 1];
+    tripChunks = new shared_ptr<const TripChunk>[tripChunkCount > 0 ? tripChunkCount : 1];
+}
+
+StateSnapshot::~StateSnapshot() {
+    delete[] driverChunks;
+    delete[] tripChunks;
+}
+
+const DriverSnapshot& StateSnapshot::getDriver(int index) const {
+    return driverChunks[index / SNAPSHOT_CHUNK_SIZE]->drivers[index % SNAPSHOT_CHUNK_SIZE];
+}
+
+int StateSnapshot::getPoolStops(int index) const {
+    return driverChunks[index / SNAPSHOT_CHUNK_SIZE]->poolStops[index % SNAPSHOT_CHUNK_SIZE];
+}
+
+const Trip& StateSnapshot::getTrip(int index) const {
+    return tripChunks[index / SNAPSHOT_CHUNK_SIZE]->trips[index % SNAPSHOT_CHUNK_SIZE];
+}
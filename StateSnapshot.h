@@ -0,0 +1,85 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include "Trip.h"
+#include "Driver.h"
+#include <memory>
+#include <string>
+using namespace std;
+
+// Road map part of a published state. Every snapshot taken while the map
+// is unchanged points at the same one.
+struct CitySnapshot {
+    int version;  // City::getVersion() when taken
+    int locationCount;
+    string* locationNames;
+    int* locationZones;
+    int roadCount;  // Each two-way road once
+    int* roadFrom;
+    int* roadTo;
+    int* roadDistance;
+
+    CitySnapshot(int version, int locationCount, int roadCount);
+    ~CitySnapshot();
+
+    CitySnapshot(const CitySnapshot&) = delete;
+    CitySnapshot& operator=(const CitySnapshot&) = delete;
+};
+
+// Records per shared chunk: a publish copies only the chunks written since
+// the previous snapshot and points at the rest
+const int SNAPSHOT_CHUNK_SIZE = 64;
+
+struct DriverChunk {
+    int count;
+    DriverSnapshot drivers[SNAPSHOT_CHUNK_SIZE];
+    int poolStops[SNAPSHOT_CHUNK_SIZE];  // Per driver
+
+    DriverChunk();
+};
+
+struct TripChunk {
+    int count;
+    Trip trips[SNAPSHOT_CHUNK_SIZE];
+
+    TripChunk();
+};
+
+struct AnalyticsSnapshot {
+    int totalTrips;
+    int archivedTrips;
+    int completedTrips;
+    int cancelledTrips;
+    double averageTripDistance;
+    int tripRecordBytes;
+    int bytesPerTrip;  // Record plus per-trip side tables
+    int bytesPerDriver;
+};
+
+// Immutable, versioned copy of what the dashboard shows, taken in one cut
+// and published whole. Readers keep it through a shared_ptr, so it stays
+// valid and unchanged while they serialize it; the last reader frees it.
+// Chunks nobody wrote to are shared with the previous snapshot.
+struct StateSnapshot {
+    long long version;  // Changing commits applied when taken
+    shared_ptr<const CitySnapshot> city;
+    int driverCount;
+    int driverChunkCount;
+    shared_ptr<const DriverChunk>* driverChunks;
+    int tripCount;   // Live trips, in array order
+    int tripChunkCount;
+    shared_ptr<const TripChunk>* tripChunks;
+    AnalyticsSnapshot analytics;
+
+    StateSnapshot(long long version, int driverCount, int tripCount);
+    ~StateSnapshot();
+
+    const DriverSnapshot& getDriver(int index) const;
+    int getPoolStops(int index) const;
+    const Trip& getTrip(int index) const;
+
+    StateSnapshot(const StateSnapshot&) = delete;
+    StateSnapshot& operator=(const StateSnapshot&) = delete;
+};
+
+#endif
@@ -11,13 +11,48 @@ const string TRIP_STATE_NAMES[] = {
     "Cancelled"    // 4 = TRIP_CANCELLED
 };
 
+// Lookup array for dispatch status names
+const string DISPATCH_STATUS_NAMES[] = {
+    "None",       // 0 = DISPATCH_NONE
+    "Queued",     // 1 = DISPATCH_QUEUED
+    "Assigned",   // 2 = DISPATCH_ASSIGNED
+    "Waiting"     // 3 = DISPATCH_NO_DRIVER
+};
+
 Trip::Trip()
     : id(-1), riderId(-1), driverId(-1), pickupLocationId(-1),
-      dropoffLocationId(-1), state(TRIP_REQUESTED), distance(0) {}
+      dropoffLocationId(-1), distance(0), approachCost(0), historyOps(0),
+      state(TRIP_REQUESTED), dispatchStatus(DISPATCH_NONE), requiredCapabilities(0),
+      poolFlags(0) {}
 
 Trip::Trip(int id, int riderId, int pickupId, int dropoffId)
     : id(id), riderId(riderId), driverId(-1), pickupLocationId(pickupId),
-      dropoffLocationId(dropoffId), state(TRIP_REQUESTED), distance(0) {}
+      dropoffLocationId(dropoffId), distance(0), approachCost(0), historyOps(0),
+      state(TRIP_REQUESTED), dispatchStatus(DISPATCH_NONE), requiredCapabilities(0),
+      poolFlags(0) {}
+
+Trip::Trip(const Trip& other)
+    : id(other.id), riderId(other.riderId), driverId(other.driverId),
+      pickupLocationId(other.pickupLocationId), dropoffLocationId(other.dropoffLocationId),
+      distance(other.distance), approachCost(other.approachCost), historyOps(other.historyOps),
+      state(other.state.load(memory_order_acquire)), dispatchStatus(other.dispatchStatus),
+      requiredCapabilities(other.requiredCapabilities), poolFlags(other.poolFlags) {}
+
+Trip& Trip::operator=(const Trip& other) {
+    id = other.id;
+    riderId = other.riderId;
+    driverId = other.driverId;
+    pickupLocationId = other.pickupLocationId;
+    dropoffLocationId = other.dropoffLocationId;
+    distance = other.distance;
+    approachCost = other.approachCost;
+    historyOps = other.historyOps;
+    state.store(other.state.load(memory_order_acquire), memory_order_release);
+    dispatchStatus = other.dispatchStatus;
+    requiredCapabilities = other.requiredCapabilities;
+    poolFlags = other.poolFlags;
+    return *this;
+}
 
 int Trip::getId() const {
     return id;
@@ -40,80 +75,159 @@ int Trip::getDropoffLocationId() const {
 }
 
 int Trip::getState() const {
-    return state;
+    return state.load(memory_order_acquire);
 }
 
 int Trip::getDistance() const {
     return distance;
 }
 
+int Trip::getDispatchStatus() const {
+    return dispatchStatus;
+}
+
+string Trip::getDispatchStatusString() const {
+    if (dispatchStatus < DISPATCH_STATUS_COUNT) {
+        return DISPATCH_STATUS_NAMES[dispatchStatus];
+    }
+    return "Unknown";
+}
+
+void Trip::setDispatchStatus(int status) {
+    dispatchStatus = status;
+}
+
+bool Trip::isPooled() const {
+    return (poolFlags & TRIP_POOL_JOINED) != 0;
+}
+
+void Trip::setPooled(bool shared) {
+    poolFlags = shared ? (poolFlags | TRIP_POOL_JOINED) : (poolFlags & ~TRIP_POOL_JOINED);
+}
+
+bool Trip::isPoolRequested() const {
+    return (poolFlags & TRIP_POOL_REQUESTED) != 0;
+}
+
+void Trip::setPoolRequested(bool requested) {
+    poolFlags = requested ? (poolFlags | TRIP_POOL_REQUESTED) : (poolFlags & ~TRIP_POOL_REQUESTED);
+}
+
+int Trip::getApproachCost() const {
+    return approachCost;
+}
+
+void Trip::setApproachCost(int cost) {
+    approachCost = cost;
+}
+
+int Trip::getRequiredCapabilities() const {
+    return requiredCapabilities;
+}
+
+void Trip::setRequiredCapabilities(int mask) {
+    requiredCapabilities = mask;
+}
+
 void Trip::setDriverId(int id) {
     driverId = id;
 }
 
 void Trip::setState(int newState) {
-    state = newState;
+    state.store(newState, memory_order_release);
 }
 
 void Trip::setDistance(int dist) {
     distance = dist;
 }
 
+int Trip::getHistoryOps() const {
+    return historyOps;
+}
+
+void Trip::setHistoryOps(int count) {
+    historyOps = count;
+}
+
 bool Trip::canTransitionTo(int newState) const {
-    // State machine validation using if-else (no switch on enum)
-    // Valid transitions:
-    // REQUESTED -> ASSIGNED, CANCELLED
-    // ASSIGNED -> ONGOING, CANCELLED
-    // ONGOING -> COMPLETED
-    // COMPLETED -> (terminal)
-    // CANCELLED -> (terminal)
-
-    if (state == TRIP_REQUESTED) {
-        return (newState == TRIP_ASSIGNED || newState == TRIP_CANCELLED);
-    }
-    else if (state == TRIP_ASSIGNED) {
-        return (newState == TRIP_ONGOING || newState == TRIP_CANCELLED);
-    }
-    else if (state == TRIP_ONGOING) {
-        return (newState == TRIP_COMPLETED);
-    }
-    else if (state == TRIP_COMPLETED || state == TRIP_CANCELLED) {
-        return false; // Terminal states
+    int current = getState();
+    if (current < 0 || current >= TRIP_STATE_COUNT ||
+        newState < 0 || newState >= TRIP_STATE_COUNT) {
+        return false;
     }
-
-    return false;
+    return TRIP_TRANSITIONS[current][newState];
 }
 
 bool Trip::transitionTo(int newState) {
-    if (canTransitionTo(newState)) {
-        state = newState;
+    int actualState;
+    return transitionTo(newState, actualState);
+}
+
+bool Trip::transitionTo(int newState, int& actualState) {
+    // Retry only while the state that beat us still allows the move
+    int current = getState();
+    while (true) {
+        if (!transitionFrom(current, newState, actualState)) {
+            if (actualState == current) {
+                return false;  // Invalid from here, not a lost race
+            }
+            current = actualState;
+            continue;
+        }
         return true;
     }
+}
+
+bool Trip::transitionFrom(int expectedState, int newState, int& actualState) {
+    if (expectedState < 0 || expectedState >= TRIP_STATE_COUNT ||
+        newState < 0 || newState >= TRIP_STATE_COUNT ||
+        !TRIP_TRANSITIONS[expectedState][newState]) {
+        actualState = getState();
+        return false;
+    }
+
+    uint8_t observed = static_cast<uint8_t>(expectedState);
+    if (state.compare_exchange_strong(observed, static_cast<uint8_t>(newState),
+                                      memory_order_acq_rel, memory_order_acquire)) {
+        actualState = newState;
+        return true;
+    }
+    actualState = observed;
     return false;
 }
 
 bool Trip::assignDriver(int driver) {
-    if (state == TRIP_REQUESTED) {
-        driverId = driver;
-        return transitionTo(TRIP_ASSIGNED);
+    int actualState;
+    return assignDriver(driver, actualState);
+}
+
+bool Trip::assignDriver(int driver, int& actualState) {
+    // Only the caller that wins the swap writes the driver, so a loser never
+    // touches it. Readers that need both fields copy under the trip's stripe.
+    if (!transitionFrom(TRIP_REQUESTED, TRIP_ASSIGNED, actualState)) {
+        return false;
     }
-    return false;
+    driverId = driver;
+    return true;
 }
 
 string Trip::getStateString() const {
     // Use lookup array instead of switch
-    if (state >= 0 && state < TRIP_STATE_COUNT) {
-        return TRIP_STATE_NAMES[state];
+    int current = getState();
+    if (current < TRIP_STATE_COUNT) {
+        return TRIP_STATE_NAMES[current];
     }
     return "Unknown";
 }
 
 bool Trip::isActive() const {
-    return (state == TRIP_REQUESTED || state == TRIP_ASSIGNED || state == TRIP_ONGOING);
+    int current = getState();
+    return (current == TRIP_REQUESTED || current == TRIP_ASSIGNED || current == TRIP_ONGOING);
 }
 
 bool Trip::isTerminal() const {
-    return (state == TRIP_COMPLETED || state == TRIP_CANCELLED);
+    int current = getState();
+    return (current == TRIP_COMPLETED || current == TRIP_CANCELLED);
 }
 
 void Trip::display() const {
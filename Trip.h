@@ -2,6 +2,8 @@
 #define TRIP_H
 
 #include <string>
+#include <cstdint>
+#include <atomic>
 using namespace std;
 
 // Trip State Constants (instead of enum)
@@ -15,20 +17,56 @@ const int TRIP_STATE_COUNT = 5;
 // Lookup array for state names (declared in Trip.cpp)
 extern const string TRIP_STATE_NAMES[];
 
+// Valid transitions, [from][to]. COMPLETED and CANCELLED are terminal.
+constexpr bool TRIP_TRANSITIONS[TRIP_STATE_COUNT][TRIP_STATE_COUNT] = {
+    // REQ    ASSIGN  ONGOING COMPL  CANCEL
+    { false, true,  false, false, true  },  // from REQUESTED
+    { false, false, true,  false, true  },  // from ASSIGNED
+    { false, false, false, true,  false },  // from ONGOING
+    { false, false, false, false, false },  // from COMPLETED
+    { false, false, false, false, false }   // from CANCELLED
+};
+
+// Dispatch Status Constants (progress of background assignment)
+const int DISPATCH_NONE = 0;       // Never queued for dispatch
+const int DISPATCH_QUEUED = 1;     // Waiting for a dispatch worker
+const int DISPATCH_ASSIGNED = 2;   // A driver was claimed
+const int DISPATCH_NO_DRIVER = 3;  // No driver yet; waiting in the pending queue
+const int DISPATCH_STATUS_COUNT = 4;
+
+// Lookup array for dispatch status names (declared in Trip.cpp)
+extern const string DISPATCH_STATUS_NAMES[];
+
+// Pool flag bits (share one byte of the record)
+const int TRIP_POOL_JOINED = 1;     // On a driver's shared route
+const int TRIP_POOL_REQUESTED = 2;  // Asked to share; a waiting trip is re-dispatched as pooled
+
+// Packed layout: 32-bit IDs and counters first, then the small enumerations
+// as single bytes, so a record is 36 bytes with no padding holes. The
+// dispatch candidate cache lives in CandidateCache, not here.
 class Trip {
 private:
-    int id;
-    int riderId;
-    int driverId;
-    int pickupLocationId;
-    int dropoffLocationId;
-    int state;  // Using int instead of enum
-    int distance;
+    int32_t id;
+    int32_t riderId;
+    int32_t driverId;
+    int32_t pickupLocationId;
+    int32_t dropoffLocationId;
+    int32_t distance;
+    int32_t approachCost;  // Effective distance of the assigned driver to the pickup
+    int32_t historyOps;  // Operations on this trip still in the rollback window
+    atomic<uint8_t> state;  // TRIP_* value; changed by compare-and-swap
+    uint8_t dispatchStatus;  // DISPATCH_* value
+    uint8_t requiredCapabilities;  // CAP_* bitmask the vehicle must have
+    uint8_t poolFlags;  // TRIP_POOL_* bits
 
 public:
     Trip();
     Trip(int id, int riderId, int pickupId, int dropoffId);
 
+    // Copies (snapshots, archive, array growth) take the state as loaded
+    Trip(const Trip& other);
+    Trip& operator=(const Trip& other);
+
     // Getters
     int getId() const;
     int getRiderId() const;
@@ -37,18 +75,38 @@ public:
     int getDropoffLocationId() const;
     int getState() const;  // Returns int instead of enum
     int getDistance() const;
+    int getDispatchStatus() const;
+    string getDispatchStatusString() const;
 
     // Setters (for rollback)
     void setDriverId(int id);
     void setState(int newState);  // Takes int instead of enum
     void setDistance(int dist);
+    void setDispatchStatus(int status);
+    bool isPooled() const;
+    void setPooled(bool shared);
+    bool isPoolRequested() const;
+    void setPoolRequested(bool requested);
+    int getApproachCost() const;
+    void setApproachCost(int cost);
+    int getRequiredCapabilities() const;
+    void setRequiredCapabilities(int mask);
+    int getHistoryOps() const;
+    void setHistoryOps(int count);
 
     // State machine operations
     bool canTransitionTo(int newState) const;  // Takes int instead of enum
     bool transitionTo(int newState);
+    // Compare-and-swap from the current state; on failure actualState is
+    // the state that made the move invalid
+    bool transitionTo(int newState, int& actualState);
+    // Compare-and-swap from expectedState only, so a caller that validated
+    // against one state never moves a trip that has since changed
+    bool transitionFrom(int expectedState, int newState, int& actualState);
 
-    // Assign driver
+    // Assign driver (REQUESTED -> ASSIGNED)
     bool assignDriver(int driverId);
+    bool assignDriver(int driverId, int& actualState);
 
     // Display
     void display() const;
@@ -0,0 +1,141 @@
+#include "TripArchive.h"
+using namespace std;
+
+const int ARCHIVE_FLAG_POOLED = 1;
+const int ARCHIVE_FIELDS_BEFORE_LINKS = 9;  // Rider through flags
+
+TripArchive::TripArchive()
+    : segment(256), offsets(64), riderHeads(64), driverHeads(64), completedCount(0), cancelledCount(0), completedDistance(0) {}
+
+void TripArchive::putVarint(unsigned int value) {
+    // 7 bits per byte, high bit set while more bytes follow
+    while (value >= 0x80) {
+        segment.emplace((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    segment.emplace((uint8_t)value);
+}
+
+unsigned int TripArchive::getVarint(int& offset) const {
+    unsigned int value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = segment[offset++];
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+void TripArchive::append(const Trip& trip) {
+    if (contains(trip.getId())) {
+        return;
+    }
+
+    int offset = segment.size();
+    int previousByRider = riderHeads.find(trip.getRiderId());
+    int previousByDriver = driverHeads.find(trip.getDriverId());
+
+    offsets.insert(trip.getId(), offset);
+    putVarint(trip.getId());
+    putVarint(trip.getRiderId());
+    putVarint(trip.getDriverId() + 1);  // -1 (never assigned) stored as 0
+    putVarint(trip.getPickupLocationId());
+    putVarint(trip.getDropoffLocationId());
+    putVarint(trip.getState());
+    putVarint(trip.getDistance());
+    putVarint(trip.getDispatchStatus());
+    putVarint(trip.getRequiredCapabilities());
+    putVarint(trip.isPooled() ? ARCHIVE_FLAG_POOLED : 0);
+    // Back links as distances to the earlier record (0 = none)
+    putVarint(previousByRider >= 0 ? offset - previousByRider : 0);
+    putVarint(previousByDriver >= 0 ? offset - previousByDriver : 0);
+
+    riderHeads.insert(trip.getRiderId(), offset);
+    if (trip.getDriverId() >= 0) {
+        driverHeads.insert(trip.getDriverId(), offset);
+    }
+
+    if (trip.getState() == TRIP_COMPLETED) {
+        completedCount++;
+        completedDistance += trip.getDistance();
+    } else if (trip.getState() == TRIP_CANCELLED) {
+        cancelledCount++;
+    }
+}
+
+bool TripArchive::contains(int tripId) const {
+    return offsets.find(tripId) >= 0;
+}
+
+bool TripArchive::load(int tripId, Trip& out) const {
+    int offset = offsets.find(tripId);
+    if (offset < 0) {
+        return false;
+    }
+
+    int id = getVarint(offset);
+    int riderId = getVarint(offset);
+    int driverId = (int)getVarint(offset) - 1;
+    int pickup = getVarint(offset);
+    int dropoff = getVarint(offset);
+    int state = getVarint(offset);
+    int distance = getVarint(offset);
+    int dispatchStatus = getVarint(offset);
+    int required = getVarint(offset);
+    int flags = getVarint(offset);
+
+    out = Trip(id, riderId, pickup, dropoff);
+    out.setDriverId(driverId);
+    out.setState(state);
+    out.setDistance(distance);
+    out.setDispatchStatus(dispatchStatus);
+    out.setRequiredCapabilities(required);
+    out.setPooled((flags & ARCHIVE_FLAG_POOLED) != 0);
+    return true;
+}
+
+int TripArchive::collectChain(int offset, bool byDriver, int* tripIds, int maxTrips) const {
+    int written = 0;
+    while (offset >= 0 && written < maxTrips) {
+        int cursor = offset;
+        tripIds[written++] = getVarint(cursor);
+        for (int i = 0; i < ARCHIVE_FIELDS_BEFORE_LINKS; i++) {
+            getVarint(cursor);
+        }
+        int riderLink = getVarint(cursor);
+        int driverLink = getVarint(cursor);
+        int link = byDriver ? driverLink : riderLink;
+        offset = (link > 0) ? offset - link : -1;
+    }
+    return written;
+}
+
+int TripArchive::collectByRider(int riderId, int* tripIds, int maxTrips) const {
+    return collectChain(riderHeads.find(riderId), false, tripIds, maxTrips);
+}
+
+int TripArchive::collectByDriver(int driverId, int* tripIds, int maxTrips) const {
+    return collectChain(driverHeads.find(driverId), true, tripIds, maxTrips);
+}
+
+int TripArchive::size() const {
+    return offsets.size();
+}
+
+int TripArchive::getByteSize() const {
+    return segment.size();
+}
+
+int TripArchive::getCompletedCount() const {
+    return completedCount;
+}
+
+int TripArchive::getCancelledCount() const {
+    return cancelledCount;
+}
+
+long long TripArchive::getCompletedDistance() const {
+    return completedDistance;
+}
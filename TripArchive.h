@@ -0,0 +1,51 @@
+#ifndef TRIP_ARCHIVE_H
+#define TRIP_ARCHIVE_H
+
+#include "Trip.h"
+#include "IdIndex.h"
+#include "GrowableArray.h"
+#include <cstdint>
+
+// Append-only store for settled trips (terminal and out of the rollback
+// window). Each trip is one variable-length record: small fields take a
+// byte, IDs and distances two or three, so a record is ~12 bytes instead
+// of a full Trip. An ID index gives O(1) lookup; running totals keep
+// analytics from decoding the segment. Each record also links back to the
+// previous record of the same rider and of the same driver, so a history
+// is a walk down one chain.
+class TripArchive {
+private:
+    GrowableArray<uint8_t> segment;
+    IdIndex offsets;  // Trip ID -> record offset in segment
+    IdIndex riderHeads;   // Rider ID -> offset of their newest record
+    IdIndex driverHeads;  // Driver ID -> offset of their newest record
+
+    int completedCount;
+    int cancelledCount;
+    long long completedDistance;
+
+    void putVarint(unsigned int value);
+    unsigned int getVarint(int& offset) const;
+    int collectChain(int offset, bool byDriver, int* tripIds, int maxTrips) const;
+
+public:
+    TripArchive();
+
+    TripArchive(const TripArchive&) = delete;
+    TripArchive& operator=(const TripArchive&) = delete;
+
+    void append(const Trip& trip);
+    bool contains(int tripId) const;
+    bool load(int tripId, Trip& out) const;  // Decode a copy; false if absent
+    // Archived trips of a rider or driver, newest first; returns how many were written
+    int collectByRider(int riderId, int* tripIds, int maxTrips) const;
+    int collectByDriver(int driverId, int* tripIds, int maxTrips) const;
+
+    int size() const;
+    int getByteSize() const;
+    int getCompletedCount() const;
+    int getCancelledCount() const;
+    long long getCompletedDistance() const;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "TripIndex.h"
+using namespace std;
+
+TripIndexNode::TripIndexNode() : tripId(-1), distance(0) {
+    for (int k = 0; k < TRIP_INDEX_KIND_COUNT; k++) {
+        keys[k] = -1;
+        next[k] = -1;
+        prev[k] = -1;
+    }
+}
+
+TripIndexList::TripIndexList() : head(-1), count(0), distanceSum(0) {}
+
+TripIndex::TripIndex() : nodes(32) {
+    for (int s = 0; s < TRIP_STATE_COUNT; s++) {
+        lists[TRIP_INDEX_BY_STATE].emplace();
+    }
+}
+
+TripIndexList* TripIndex::listFor(int kind, int key, bool create) {
+    if (key < 0) {
+        return nullptr;
+    }
+    GrowableArray<TripIndexList>& byKey = lists[kind];
+    if (key >= byKey.size()) {
+        if (!create) {
+            return nullptr;
+        }
+        // Rider and driver IDs are dense, so keys index the array directly
+        while (byKey.size() <= key) {
+            byKey.emplace();
+        }
+    }
+    return &byKey[key];
+}
+
+void TripIndex::link(int node, int kind, int key) {
+    TripIndexNode& entry = nodes[node];
+    entry.keys[kind] = key;
+    entry.prev[kind] = -1;
+    entry.next[kind] = -1;
+
+    TripIndexList* list = listFor(kind, key, true);
+    if (!list) {
+        return;  // Unkeyed (no driver yet)
+    }
+    entry.next[kind] = list->head;
+    if (list->head >= 0) {
+        nodes[list->head].prev[kind] = node;
+    }
+    list->head = node;
+    list->count++;
+    list->distanceSum += entry.distance;
+}
+
+void TripIndex::unlink(int node, int kind) {
+    TripIndexNode& entry = nodes[node];
+    TripIndexList* list = listFor(kind, entry.keys[kind], false);
+    if (!list) {
+        return;
+    }
+    if (entry.prev[kind] >= 0) {
+        nodes[entry.prev[kind]].next[kind] = entry.next[kind];
+    } else {
+        list->head = entry.next[kind];
+    }
+    if (entry.next[kind] >= 0) {
+        nodes[entry.next[kind]].prev[kind] = entry.prev[kind];
+    }
+    list->count--;
+    list->distanceSum -= entry.distance;
+    entry.keys[kind] = -1;
+}
+
+int TripIndex::nodeOf(int tripId) const {
+    if (tripId < 0) {
+        return -1;
+    }
+    int node = handleSlot(tripId);
+    return (node < nodes.size() && nodes[node].tripId == tripId) ? node : -1;
+}
+
+int TripIndex::getBytesPerTrip() {
+    return (int)sizeof(TripIndexNode);
+}
+
+void TripIndex::add(const Trip& trip) {
+    int node = handleSlot(trip.getId());
+    if (node >= nodes.size()) {
+        while (nodes.size() <= node) {
+            nodes.emplace();
+        }
+    }
+    if (nodes[node].tripId >= 0) {
+        remove(nodes[node].tripId);
+    }
+
+    nodes[node].tripId = trip.getId();
+    nodes[node].distance = trip.getDistance();
+    link(node, TRIP_INDEX_BY_RIDER, trip.getRiderId());
+    link(node, TRIP_INDEX_BY_DRIVER, trip.getDriverId());
+    link(node, TRIP_INDEX_BY_STATE, trip.getState());
+}
+
+void TripIndex::remove(int tripId) {
+    int node = nodeOf(tripId);
+    if (node < 0) {
+        return;
+    }
+    for (int k = 0; k < TRIP_INDEX_KIND_COUNT; k++) {
+        unlink(node, k);
+    }
+    nodes[node].tripId = -1;
+}
+
+void TripIndex::sync(const Trip& trip) {
+    int node = nodeOf(trip.getId());
+    if (node < 0) {
+        return;
+    }
+    if (nodes[node].keys[TRIP_INDEX_BY_DRIVER] != trip.getDriverId()) {
+        unlink(node, TRIP_INDEX_BY_DRIVER);
+        link(node, TRIP_INDEX_BY_DRIVER, trip.getDriverId());
+    }
+    if (nodes[node].keys[TRIP_INDEX_BY_STATE] != trip.getState()) {
+        unlink(node, TRIP_INDEX_BY_STATE);
+        link(node, TRIP_INDEX_BY_STATE, trip.getState());
+    }
+}
+
+int TripIndex::first(int kind, int key) const {
+    if (kind < 0 || kind >= TRIP_INDEX_KIND_COUNT || key < 0 || key >= lists[kind].size()) {
+        return -1;
+    }
+    int node = lists[kind][key].head;
+    return (node >= 0) ? nodes[node].tripId : -1;
+}
+
+int TripIndex::next(int kind, int tripId) const {
+    int node = nodeOf(tripId);
+    if (node < 0 || kind < 0 || kind >= TRIP_INDEX_KIND_COUNT) {
+        return -1;
+    }
+    int after = nodes[node].next[kind];
+    return (after >= 0) ? nodes[after].tripId : -1;
+}
+
+int TripIndex::getCount(int kind, int key) const {
+    if (kind < 0 || kind >= TRIP_INDEX_KIND_COUNT || key < 0 || key >= lists[kind].size()) {
+        return 0;
+    }
+    return lists[kind][key].count;
+}
+
+long long TripIndex::getDistanceSum(int kind, int key) const {
+    if (kind < 0 || kind >= TRIP_INDEX_KIND_COUNT || key < 0 || key >= lists[kind].size()) {
+        return 0;
+    }
+    return lists[kind][key].distanceSum;
+}
@@ -0,0 +1,67 @@
+#ifndef TRIP_INDEX_H
+#define TRIP_INDEX_H
+
+#include "Trip.h"
+#include "HandleTable.h"
+#include "GrowableArray.h"
+
+// List kinds (instead of enum)
+const int TRIP_INDEX_BY_RIDER = 0;
+const int TRIP_INDEX_BY_DRIVER = 1;
+const int TRIP_INDEX_BY_STATE = 2;
+const int TRIP_INDEX_KIND_COUNT = 3;
+
+// One live trip's membership in the three list kinds
+struct TripIndexNode {
+    int tripId;  // -1 while the slot is not indexed
+    int distance;  // Fixed at request time
+    int keys[TRIP_INDEX_KIND_COUNT];  // Rider, driver (-1 = none), state it is listed under
+    int next[TRIP_INDEX_KIND_COUNT];  // Node links (handle slots), -1 at the end
+    int prev[TRIP_INDEX_KIND_COUNT];
+
+    TripIndexNode();
+};
+
+struct TripIndexList {
+    int head;  // Newest trip's node
+    int count;
+    long long distanceSum;  // Over the listed trips
+
+    TripIndexList();
+};
+
+// Secondary indexes over live trips: rider -> trips, driver -> trips and
+// state -> trips, each an intrusive doubly linked list threaded through
+// one node per trip (nodes indexed by trip handle slot). Adding, removing
+// or re-keying a trip is O(1); walking a list costs O(result). Each list
+// also keeps its length and distance total, so per-state analytics are
+// O(1) reads that rollback reverses through the same re-keying.
+class TripIndex {
+private:
+    GrowableArray<TripIndexNode> nodes;
+    GrowableArray<TripIndexList> lists[TRIP_INDEX_KIND_COUNT];  // By key
+
+    TripIndexList* listFor(int kind, int key, bool create);
+    void link(int node, int kind, int key);
+    void unlink(int node, int kind);
+    int nodeOf(int tripId) const;  // -1 if not indexed
+
+public:
+    TripIndex();
+
+    TripIndex(const TripIndex&) = delete;
+    TripIndex& operator=(const TripIndex&) = delete;
+
+    void add(const Trip& trip);
+    void remove(int tripId);
+    void sync(const Trip& trip);  // Re-key after a driver or state change
+    static int getBytesPerTrip();  // One node
+
+    // Walk a list newest first: first(kind, key), then next(kind, tripId); -1 ends
+    int first(int kind, int key) const;
+    int next(int kind, int tripId) const;
+    int getCount(int kind, int key) const;
+    long long getDistanceSum(int kind, int key) const;
+};
+
+#endif
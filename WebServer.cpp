@@ -7,7 +7,8 @@
 
 using namespace std;
 
-WebServer::WebServer(RideShareSystem* sys, int port) : system(sys), port(port) {
+WebServer::WebServer(RideShareSystem* sys, int port) : system(sys), port(port), maintaining(false) {
+    server.new_task_queue = [] { return new httplib::ThreadPool(WEB_HTTP_WORKERS); };
     setupRoutes();
 }
 
@@ -27,130 +28,126 @@ string WebServer::createJSONResponse(bool success, const string& message, const
     return json.str();
 }
 
-string WebServer::locationsToJSON() {
+shared_ptr<const StateSnapshot> WebServer::currentState() {
+    shared_ptr<const StateSnapshot> state = system->getStateSnapshot();
+    if (!state) {
+        // First request before the background tick: publish one now
+        system->publishSnapshot();
+        state = system->getStateSnapshot();
+    }
+    return state;
+}
+
+string WebServer::locationsToJSON(const CitySnapshot& city) {
     ostringstream json;
     json << "[";
 
-    City& city = system->getCity();
-    int locationCount = city.getLocationCount();
-
-    for (int i = 0; i < locationCount; i++) {
-        Location* loc = city.getLocation(i);
-        if (loc) {
-            if (i > 0) json << ", ";
-            json << "{";
-            json << "\"id\": " << loc->id << ", ";
-            json << "\"name\": \"" << loc->name << "\", ";
-            json << "\"zone\": " << loc->zoneId;
-            json << "}";
-        }
+    for (int i = 0; i < city.locationCount; i++) {
+        if (i > 0) json << ", ";
+        json << "{";
+        json << "\"id\": " << i << ", ";
+        json << "\"name\": \"" << city.locationNames[i] << "\", ";
+        json << "\"zone\": " << city.locationZones[i];
+        json << "}";
     }
 
     json << "]";
     return json.str();
 }
 
-string WebServer::roadsToJSON() {
+string WebServer::roadsToJSON(const CitySnapshot& city) {
     ostringstream json;
     json << "[";
 
-    City& city = system->getCity();
-    int locationCount = city.getLocationCount();
-    bool first = true;
-
-    for (int i = 0; i < locationCount; i++) {
-        Location* loc = city.getLocation(i);
-        if (loc) {
-            Edge* edge = loc->adjacencyList;
-            while (edge) {
-                // Only export each edge once (avoid duplicates for undirected graph)
-                if (i < edge->destination) {
-                    if (!first) json << ", ";
-                    json << "{";
-                    json << "\"from\": " << i << ", ";
-                    json << "\"to\": " << edge->destination << ", ";
-                    json << "\"distance\": " << edge->weight;
-                    json << "}";
-                    first = false;
-                }
-                edge = edge->next;
-            }
-        }
+    // The snapshot already lists each two-way road once
+    for (int i = 0; i < city.roadCount; i++) {
+        if (i > 0) json << ", ";
+        json << "{";
+        json << "\"from\": " << city.roadFrom[i] << ", ";
+        json << "\"to\": " << city.roadTo[i] << ", ";
+        json << "\"distance\": " << city.roadDistance[i];
+        json << "}";
     }
 
     json << "]";
     return json.str();
 }
 
-string WebServer::driversToJSON() {
+string WebServer::driversToJSON(const StateSnapshot& state) {
     ostringstream json;
     json << "[";
 
-    int driverCount = system->getDriverCount();
-    for (int i = 0; i < driverCount; i++) {
-        Driver* driver = system->getDriver(i);
-        if (driver) {
-            if (i > 0) json << ", ";
-            json << "{";
-            json << "\"id\": " << driver->getId() << ", ";
-            json << "\"name\": \"" << driver->getName() << "\", ";
-            json << "\"location\": " << driver->getCurrentLocationId() << ", ";
-            json << "\"zone\": " << driver->getZoneId() << ", ";
-            json << "\"status\": " << driver->getStatus() << ", ";
-            json << "\"trips\": " << driver->getTotalTripsCompleted() << ", ";
-            json << "\"distance\": " << driver->getTotalDistanceCovered();
-            json << "}";
-        }
+    for (int i = 0; i < state.driverCount; i++) {
+        const DriverSnapshot& driver = state.getDriver(i);
+        if (i > 0) json << ", ";
+        json << "{";
+        json << "\"id\": " << driver.id << ", ";
+        json << "\"name\": \"" << driver.name << "\", ";
+        json << "\"location\": " << driver.locationId << ", ";
+        json << "\"zone\": " << driver.zoneId << ", ";
+        json << "\"status\": " << driver.status << ", ";
+        json << "\"trips\": " << driver.tripsCompleted << ", ";
+        json << "\"distance\": " << driver.distanceCovered << ", ";
+        json << "\"nextTrip\": " << driver.queuedTripId << ", ";
+        json << "\"poolStops\": " << state.getPoolStops(i) << ", ";
+        json << "\"capabilities\": " << driver.capabilities << ", ";
+        json << "\"seats\": " << driver.seatCount;
+        json << "}";
     }
 
     json << "]";
     return json.str();
 }
 
-string WebServer::tripsToJSON() {
+string WebServer::tripsToJSON(const StateSnapshot& state) {
     ostringstream json;
     json << "[";
 
-    int tripCount = system->getTotalTripCount();
-    for (int i = 0; i < tripCount; i++) {
-        Trip* trip = system->getTrip(i);
-        if (trip) {
-            if (i > 0) json << ", ";
-            json << "{";
-            json << "\"id\": " << trip->getId() << ", ";
-            json << "\"riderId\": " << trip->getRiderId() << ", ";
-            json << "\"driverId\": " << trip->getDriverId() << ", ";
-            json << "\"pickup\": " << trip->getPickupLocationId() << ", ";
-            json << "\"dropoff\": " << trip->getDropoffLocationId() << ", ";
-            json << "\"state\": " << trip->getState() << ", ";
-            json << "\"distance\": " << trip->getDistance();
-            json << "}";
-        }
+    // Live trips only; settled ones are archived and counted in analytics
+    for (int i = 0; i < state.tripCount; i++) {
+        const Trip& trip = state.getTrip(i);
+        if (i > 0) json << ", ";
+        json << "{";
+        json << "\"id\": " << trip.getId() << ", ";
+        json << "\"riderId\": " << trip.getRiderId() << ", ";
+        json << "\"driverId\": " << trip.getDriverId() << ", ";
+        json << "\"pickup\": " << trip.getPickupLocationId() << ", ";
+        json << "\"dropoff\": " << trip.getDropoffLocationId() << ", ";
+        json << "\"state\": " << trip.getState() << ", ";
+        json << "\"distance\": " << trip.getDistance();
+        json << "}";
     }
 
     json << "]";
     return json.str();
 }
 
-string WebServer::analyticsToJSON() {
+string WebServer::analyticsToJSON(const StateSnapshot& state) {
+    const AnalyticsSnapshot& analytics = state.analytics;
     ostringstream json;
     json << "{";
-    json << "\"totalTrips\": " << system->getTotalTripCount() << ", ";
-    json << "\"completedTrips\": " << system->getCompletedTripCount() << ", ";
-    json << "\"cancelledTrips\": " << system->getCancelledTripCount() << ", ";
-    json << "\"avgTripDistance\": " << system->getAverageTripDistance();
+    json << "\"totalTrips\": " << analytics.totalTrips << ", ";
+    json << "\"archivedTrips\": " << analytics.archivedTrips << ", ";
+    json << "\"completedTrips\": " << analytics.completedTrips << ", ";
+    json << "\"cancelledTrips\": " << analytics.cancelledTrips << ", ";
+    json << "\"avgTripDistance\": " << analytics.averageTripDistance << ", ";
+    json << "\"tripRecordBytes\": " << analytics.tripRecordBytes << ", ";
+    json << "\"bytesPerTrip\": " << analytics.bytesPerTrip << ", ";
+    json << "\"bytesPerDriver\": " << analytics.bytesPerDriver;
     json << "}";
     return json.str();
 }
 
-string WebServer::systemStateToJSON() {
+string WebServer::systemStateToJSON(const StateSnapshot& state) {
+    // Every section comes from the same snapshot, so they agree
     ostringstream json;
     json << "{";
-    json << "\"locations\": " << locationsToJSON() << ", ";
-    json << "\"roads\": " << roadsToJSON() << ", ";
-    json << "\"drivers\": " << driversToJSON() << ", ";
-    json << "\"trips\": " << tripsToJSON() << ", ";
-    json << "\"analytics\": " << analyticsToJSON();
+    json << "\"version\": " << state.version << ", ";
+    json << "\"locations\": " << locationsToJSON(*state.city) << ", ";
+    json << "\"roads\": " << roadsToJSON(*state.city) << ", ";
+    json << "\"drivers\": " << driversToJSON(state) << ", ";
+    json << "\"trips\": " << tripsToJSON(state) << ", ";
+    json << "\"analytics\": " << analyticsToJSON(state);
     json << "}";
     return json.str();
 }
@@ -166,25 +163,25 @@ void WebServer::setupRoutes() {
     // GET /api/state - Get complete system state
     server.Get("/api/state", [this](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
-        res.set_content(systemStateToJSON(), "application/json");
+        res.set_content(systemStateToJSON(*currentState()), "application/json");
     });
 
     // GET /api/drivers - Get all drivers
     server.Get("/api/drivers", [this](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
-        res.set_content(driversToJSON(), "application/json");
+        res.set_content(driversToJSON(*currentState()), "application/json");
     });
 
     // GET /api/trips - Get all trips
     server.Get("/api/trips", [this](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
-        res.set_content(tripsToJSON(), "application/json");
+        res.set_content(tripsToJSON(*currentState()), "application/json");
     });
 
     // GET /api/analytics - Get analytics
     server.Get("/api/analytics", [this](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
-        res.set_content(analyticsToJSON(), "application/json");
+        res.set_content(analyticsToJSON(*currentState()), "application/json");
     });
 
     // POST /api/trips/request - Request a new trip
@@ -193,29 +190,73 @@ void WebServer::setupRoutes() {
         res.set_header("Content-Type", "application/json");
 
         // Parse parameters
-        int riderId = -1, pickup = -1, dropoff = -1;
+        int riderId = -1, pickup = -1, dropoff = -1, capabilities = CAP_NONE;
 
         if (req.has_param("riderId")) riderId = stoi(req.get_param_value("riderId"));
         if (req.has_param("pickup")) pickup = stoi(req.get_param_value("pickup"));
         if (req.has_param("dropoff")) dropoff = stoi(req.get_param_value("dropoff"));
+        if (req.has_param("capabilities")) capabilities = stoi(req.get_param_value("capabilities"));
 
-        if (riderId < 0 || pickup < 0 || dropoff < 0) {
+        if (riderId < 0 || pickup < 0 || dropoff < 0 || (capabilities & ~CAP_ALL) != 0) {
             res.set_content(createJSONResponse(false, "Invalid parameters"), "application/json");
             return;
         }
 
-        int tripId = system->requestTrip(riderId, pickup, dropoff);
+        // Shared rides are matched inline against the drivers' stop lists
+        if (req.has_param("pooled") && req.get_param_value("pooled") == "1") {
+            int tripId = system->execute(CMD_REQUEST_TRIP, riderId, pickup, dropoff, capabilities);
+            if (tripId < 0) {
+                res.set_content(createJSONResponse(false, "Failed to request trip"), "application/json");
+                return;
+            }
+            bool pooled = system->execute(CMD_POOL_TRIP, tripId) == 1;
+            ostringstream data;
+            data << "{\"tripId\": " << tripId << ", \"pooled\": " << (pooled ? "true" : "false") << "}";
+            res.set_content(createJSONResponse(true, pooled ? "Shared ride assigned" : "Shared ride waiting for a driver",
+                                               data.str()), "application/json");
+            return;
+        }
+
+        // Returns as soon as the trip is queued; a zone worker assigns it
+        int tripId = system->execute(CMD_REQUEST_TRIP_ASYNC, riderId, pickup, dropoff, capabilities);
         if (tripId >= 0) {
-            // Auto-assign driver
-            bool assigned = system->assignTrip(tripId);
             ostringstream data;
-            data << "{\"tripId\": " << tripId << ", \"assigned\": " << (assigned ? "true" : "false") << "}";
-            res.set_content(createJSONResponse(true, "Trip requested and assigned", data.str()), "application/json");
+            data << "{\"tripId\": " << tripId << ", \"dispatch\": " << system->getDispatchStatus(tripId) << "}";
+            res.set_content(createJSONResponse(true, "Trip requested, dispatch queued", data.str()), "application/json");
         } else {
             res.set_content(createJSONResponse(false, "Failed to request trip"), "application/json");
         }
     });
 
+    // GET /api/trips/status - Poll a trip's state and dispatch progress
+    server.Get("/api/trips/status", [this](const httplib::Request& req, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+
+        if (!req.has_param("tripId")) {
+            res.set_content(createJSONResponse(false, "Missing tripId parameter"), "application/json");
+            return;
+        }
+
+        int tripId = stoi(req.get_param_value("tripId"));
+        // One snapshot, so state and dispatch status agree with each other
+        Trip trip;
+        if (!system->getTripSnapshot(tripId, trip)) {
+            res.set_content(createJSONResponse(false, "Trip not found"), "application/json");
+            return;
+        }
+        int dispatch = trip.getDispatchStatus();
+
+        ostringstream data;
+        data << "{";
+        data << "\"tripId\": " << tripId << ", ";
+        data << "\"state\": " << trip.getState() << ", ";
+        data << "\"driverId\": " << trip.getDriverId() << ", ";
+        data << "\"dispatch\": " << dispatch << ", ";
+        data << "\"dispatchName\": \"" << DISPATCH_STATUS_NAMES[dispatch] << "\"";
+        data << "}";
+        res.set_content(createJSONResponse(true, "Trip status", data.str()), "application/json");
+    });
+
     // POST /api/trips/start - Start a trip
     server.Post("/api/trips/start", [this](const httplib::Request& req, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
@@ -227,7 +268,7 @@ void WebServer::setupRoutes() {
         }
 
         int tripId = stoi(req.get_param_value("tripId"));
-        bool success = system->startTrip(tripId);
+        bool success = system->execute(CMD_START_TRIP, tripId) == 1;
 
         if (success) {
             res.set_content(createJSONResponse(true, "Trip started successfully"), "application/json");
@@ -247,7 +288,7 @@ void WebServer::setupRoutes() {
         }
 
         int tripId = stoi(req.get_param_value("tripId"));
-        bool success = system->completeTrip(tripId);
+        bool success = system->execute(CMD_COMPLETE_TRIP, tripId) == 1;
 
         if (success) {
             res.set_content(createJSONResponse(true, "Trip completed successfully"), "application/json");
@@ -267,7 +308,7 @@ void WebServer::setupRoutes() {
         }
 
         int tripId = stoi(req.get_param_value("tripId"));
-        bool success = system->cancelTrip(tripId);
+        bool success = system->execute(CMD_CANCEL_TRIP, tripId) == 1;
 
         if (success) {
             res.set_content(createJSONResponse(true, "Trip cancelled successfully"), "application/json");
@@ -276,6 +317,73 @@ void WebServer::setupRoutes() {
         }
     });
 
+    // POST /api/trips/reject - Assigned driver rejects a trip
+    server.Post("/api/trips/reject", [this](const httplib::Request& req, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Content-Type", "application/json");
+
+        if (!req.has_param("tripId")) {
+            res.set_content(createJSONResponse(false, "Missing tripId parameter"), "application/json");
+            return;
+        }
+
+        int tripId = stoi(req.get_param_value("tripId"));
+        bool success = system->execute(CMD_REJECT_TRIP, tripId) == 1;
+
+        if (success) {
+            Trip trip;
+            bool found = system->getTripSnapshot(tripId, trip);
+            ostringstream data;
+            data << "{\"tripId\": " << tripId << ", \"driverId\": " << (found ? trip.getDriverId() : -1) << "}";
+            res.set_content(createJSONResponse(true, "Trip rejected", data.str()), "application/json");
+        } else {
+            res.set_content(createJSONResponse(false, "Failed to reject trip"), "application/json");
+        }
+    });
+
+    // POST /api/drivers/location - Driver position report
+    server.Post("/api/drivers/location", [this](const httplib::Request& req, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Content-Type", "application/json");
+
+        if (!req.has_param("driverId") || !req.has_param("location")) {
+            res.set_content(createJSONResponse(false, "Missing driverId or location parameter"), "application/json");
+            return;
+        }
+
+        int driverId = stoi(req.get_param_value("driverId"));
+        int location = stoi(req.get_param_value("location"));
+        bool success = system->execute(CMD_UPDATE_LOCATION, driverId, location) == 1;
+
+        if (success) {
+            res.set_content(createJSONResponse(true, "Driver location updated"), "application/json");
+        } else {
+            res.set_content(createJSONResponse(false, "Failed to update driver location"), "application/json");
+        }
+    });
+
+    // POST /api/rebalance - Reposition idle drivers now
+    server.Post("/api/rebalance", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Content-Type", "application/json");
+
+        int moved = system->execute(CMD_REBALANCE);
+        ostringstream data;
+        data << "{\"moved\": " << moved << "}";
+        res.set_content(createJSONResponse(true, "Idle drivers rebalanced", data.str()), "application/json");
+    });
+
+    // POST /api/dispatch - Match idle drivers to waiting trips (e.g. after a rollback)
+    server.Post("/api/dispatch", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Content-Type", "application/json");
+
+        int matched = system->execute(CMD_DISPATCH_WAITING);
+        ostringstream data;
+        data << "{\"assigned\": " << matched << "}";
+        res.set_content(createJSONResponse(true, "Waiting trips dispatched", data.str()), "application/json");
+    });
+
     // POST /api/rollback - Rollback operations
     server.Post("/api/rollback", [this](const httplib::Request& req, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
@@ -286,7 +394,7 @@ void WebServer::setupRoutes() {
             count = stoi(req.get_param_value("count"));
         }
 
-        bool success = system->rollback(count);
+        bool success = system->execute(CMD_ROLLBACK, count) == 1;
 
         if (success) {
             ostringstream data;
@@ -316,9 +424,34 @@ void WebServer::start() {
     cout << "\nPress Ctrl+C to stop the server..." << endl;
     cout << "========================================\n" << endl;
 
+    system->setDispatchBudget(WEB_DISPATCH_BUDGET_MICROS);
+    system->startDispatchWorkers();
+    system->startCommandLoop();
+    system->publishSnapshot();
+    maintaining = true;
+    maintenanceThread = thread(&WebServer::maintenanceLoop, this);
     server.listen("0.0.0.0", port);
 }
 
+void WebServer::maintenanceLoop() {
+    // Short ticks: fresh dashboard state, and stop() never waits long
+    int ticks = 0;
+    while (maintaining) {
+        this_thread::sleep_for(chrono::milliseconds(WEB_PUBLISH_INTERVAL_MS));
+        system->publishSnapshot();
+        if (++ticks >= REBALANCE_INTERVAL_SECONDS * 1000 / WEB_PUBLISH_INTERVAL_MS) {
+            ticks = 0;
+            system->execute(CMD_REBALANCE);
+        }
+    }
+}
+
 void WebServer::stop() {
+    maintaining = false;
+    if (maintenanceThread.joinable()) {
+        maintenanceThread.join();
+    }
     server.stop();
+    system->stopDispatchWorkers();
+    system->stopCommandLoop();
 }
@@ -7,6 +7,19 @@
 #include "RideShareSystem.h"
 #include "httplib.h"
 #include <string>
+#include <thread>
+#include <atomic>
+
+// Per-request dispatch search budget for the HTTP API (5 ms)
+const int WEB_DISPATCH_BUDGET_MICROS = 5000;
+
+// HTTP worker threads; handlers read published snapshots and submit
+// changes as commands to the system's single writer
+const int WEB_HTTP_WORKERS = 8;
+
+// Background tick: republishes the dashboard state (if it changed), so
+// listings are at most this old
+const int WEB_PUBLISH_INTERVAL_MS = 100;
 
 class WebServer {
 private:
@@ -14,14 +27,21 @@ private:
     httplib::Server server;
     int port;
 
+    // Periodic state publishing and idle-driver rebalancing while the server runs
+    std::thread maintenanceThread;
+    std::atomic<bool> maintaining;
+    void maintenanceLoop();
+
     // Helper methods for JSON responses
     std::string createJSONResponse(bool success, const std::string& message, const std::string& data = "");
-    std::string driversToJSON();
-    std::string tripsToJSON();
-    std::string analyticsToJSON();
-    std::string systemStateToJSON();
-    std::string locationsToJSON();
-    std::string roadsToJSON();
+    // Listings serialize one published snapshot, without locks
+    std::shared_ptr<const StateSnapshot> currentState();
+    std::string driversToJSON(const StateSnapshot& state);
+    std::string tripsToJSON(const StateSnapshot& state);
+    std::string analyticsToJSON(const StateSnapshot& state);
+    std::string systemStateToJSON(const StateSnapshot& state);
+    std::string locationsToJSON(const CitySnapshot& city);
+    std::string roadsToJSON(const CitySnapshot& city);
 
     // Setup all API routes
     void setupRoutes();
@@ -0,0 +1,157 @@
+#include "ZoneIdleIndex.h"
+using namespace std;
+
+ZoneIdleIndex::ZoneIdleIndex(int initialCapacity)
+    : zoneCount(0), zoneCapacity(4), capacity(initialCapacity > 0 ? initialCapacity : 1) {
+    zoneIds = new int[zoneCapacity];
+    heads = new int[zoneCapacity];
+    counts = new int[zoneCapacity];
+
+    nextDriver = new int[capacity];
+    prevDriver = new int[capacity];
+    zoneOf = new int[capacity];
+    for (int i = 0; i < capacity; i++) {
+        zoneOf[i] = -1;
+    }
+}
+
+ZoneIdleIndex::~ZoneIdleIndex() {
+    delete[] zoneIds;
+    delete[] heads;
+    delete[] counts;
+    delete[] nextDriver;
+    delete[] prevDriver;
+    delete[] zoneOf;
+}
+
+void ZoneIdleIndex::grow(int minCapacity) {
+    int newCapacity = capacity;
+    while (newCapacity < minCapacity) {
+        newCapacity *= 2;
+    }
+
+    int* newNext = new int[newCapacity];
+    int* newPrev = new int[newCapacity];
+    int* newZone = new int[newCapacity];
+    for (int i = 0; i < newCapacity; i++) {
+        if (i < capacity) {
+            newNext[i] = nextDriver[i];
+            newPrev[i] = prevDriver[i];
+            newZone[i] = zoneOf[i];
+        } else {
+            newZone[i] = -1;
+        }
+    }
+
+    delete[] nextDriver;
+    delete[] prevDriver;
+    delete[] zoneOf;
+    nextDriver = newNext;
+    prevDriver = newPrev;
+    zoneOf = newZone;
+    capacity = newCapacity;
+}
+
+int ZoneIdleIndex::zoneIndex(int zoneId) const {
+    for (int z = 0; z < zoneCount; z++) {
+        if (zoneIds[z] == zoneId) {
+            return z;
+        }
+    }
+    return -1;
+}
+
+int ZoneIdleIndex::addZone(int zoneId) {
+    if (zoneCount >= zoneCapacity) {
+        int newCapacity = zoneCapacity * 2;
+        int* newIds = new int[newCapacity];
+        int* newHeads = new int[newCapacity];
+        int* newCounts = new int[newCapacity];
+        for (int z = 0; z < zoneCount; z++) {
+            newIds[z] = zoneIds[z];
+            newHeads[z] = heads[z];
+            newCounts[z] = counts[z];
+        }
+        delete[] zoneIds;
+        delete[] heads;
+        delete[] counts;
+        zoneIds = newIds;
+        heads = newHeads;
+        counts = newCounts;
+        zoneCapacity = newCapacity;
+    }
+
+    zoneIds[zoneCount] = zoneId;
+    heads[zoneCount] = -1;
+    counts[zoneCount] = 0;
+    return zoneCount++;
+}
+
+void ZoneIdleIndex::unlink(int slot) {
+    int z = zoneOf[slot];
+    if (z < 0) {
+        return;
+    }
+
+    if (prevDriver[slot] >= 0) {
+        nextDriver[prevDriver[slot]] = nextDriver[slot];
+    } else {
+        heads[z] = nextDriver[slot];
+    }
+    if (nextDriver[slot] >= 0) {
+        prevDriver[nextDriver[slot]] = prevDriver[slot];
+    }
+    counts[z]--;
+    zoneOf[slot] = -1;
+}
+
+void ZoneIdleIndex::update(int slot, DriverPosition position) {
+    if (slot < 0) {
+        return;
+    }
+    if (slot >= capacity) {
+        grow(slot + 1);
+    }
+
+    int z = -1;
+    if (positionStatus(position) == DRIVER_AVAILABLE) {
+        z = zoneIndex(positionZone(position));
+        if (z < 0) {
+            z = addZone(positionZone(position));
+        }
+    }
+    if (zoneOf[slot] == z) {
+        return;
+    }
+    unlink(slot);
+    if (z < 0) {
+        return;
+    }
+
+    // Push at the head of its zone list
+    nextDriver[slot] = heads[z];
+    prevDriver[slot] = -1;
+    if (heads[z] >= 0) {
+        prevDriver[heads[z]] = slot;
+    }
+    heads[z] = slot;
+    zoneOf[slot] = z;
+    counts[z]++;
+}
+
+int ZoneIdleIndex::firstIdle(int zoneId) const {
+    int z = zoneIndex(zoneId);
+    return (z >= 0) ? heads[z] : -1;
+}
+
+int ZoneIdleIndex::nextIdle(int slot) const {
+    if (slot < 0 || slot >= capacity || zoneOf[slot] < 0) {
+        return -1;
+    }
+    return nextDriver[slot];
+}
+
+int ZoneIdleIndex::getIdleCount(int zoneId) const {
+    int z = zoneIndex(zoneId);
+    return (z >= 0) ? counts[z] : 0;
+}
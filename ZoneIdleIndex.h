@@ -0,0 +1,46 @@
+#ifndef ZONE_IDLE_INDEX_H
+#define ZONE_IDLE_INDEX_H
+
+#include "Driver.h"
+
+// AVAILABLE drivers partitioned by the zone they stand in, each zone an
+// intrusive doubly linked list over driver slots. DriverTable updates it on
+// every position write, so rebalancing reads idle supply per zone and picks
+// drivers from one zone's list instead of scanning the fleet.
+// Position writes happen inside commit sections; so do the readers.
+class ZoneIdleIndex {
+private:
+    // Per zone index (zones are found by ID, as in ZoneRebalancer)
+    int* zoneIds;
+    int* heads;
+    int* counts;
+    int zoneCount;
+    int zoneCapacity;
+
+    // Per driver slot
+    int* nextDriver;
+    int* prevDriver;
+    int* zoneOf;  // Zone index, -1 if not idle
+    int capacity;
+
+    void grow(int minCapacity);
+    int zoneIndex(int zoneId) const;
+    int addZone(int zoneId);
+    void unlink(int slot);
+
+public:
+    ZoneIdleIndex(int initialCapacity = 10);
+    ~ZoneIdleIndex();
+
+    ZoneIdleIndex(const ZoneIdleIndex&) = delete;
+    ZoneIdleIndex& operator=(const ZoneIdleIndex&) = delete;
+
+    // Insert, move or drop a driver to match its new position
+    void update(int slot, DriverPosition position);
+
+    int firstIdle(int zoneId) const;   // -1 if none
+    int nextIdle(int slot) const;      // -1 at the end
+    int getIdleCount(int zoneId) const;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "ZoneRebalancer.h"
+#include <climits>
+using namespace std;
+
+RebalanceMove::RebalanceMove()
+    : driverId(-1), fromZone(-1), toZone(-1), targetLocationId(-1), distance(0) {}
+
+ZoneRebalancer::ZoneRebalancer(City* city)
+    : city(city), cityVersion(-1), zoneCount(0), zoneCapacity(4),
+      hubDistances(nullptr), locationCount(0) {
+    zoneIds = new int[zoneCapacity];
+    hubLocations = new int[zoneCapacity];
+    recentDemand = new int[zoneCapacity];
+}
+
+ZoneRebalancer::~ZoneRebalancer() {
+    delete[] zoneIds;
+    delete[] hubLocations;
+    delete[] recentDemand;
+    delete[] hubDistances;
+}
+
+int ZoneRebalancer::zoneIndex(int zoneId) const {
+    for (int z = 0; z < zoneCount; z++) {
+        if (zoneIds[z] == zoneId) {
+            return z;
+        }
+    }
+    return -1;
+}
+
+int ZoneRebalancer::addZone(int zoneId) {
+    if (zoneCount >= zoneCapacity) {
+        int newCapacity = zoneCapacity * 2;
+        int* newIds = new int[newCapacity];
+        int* newHubs = new int[newCapacity];
+        int* newDemand = new int[newCapacity];
+        for (int z = 0; z < zoneCount; z++) {
+            newIds[z] = zoneIds[z];
+            newHubs[z] = hubLocations[z];
+            newDemand[z] = recentDemand[z];
+        }
+        delete[] zoneIds;
+        delete[] hubLocations;
+        delete[] recentDemand;
+        zoneIds = newIds;
+        hubLocations = newHubs;
+        recentDemand = newDemand;
+        zoneCapacity = newCapacity;
+    }
+
+    zoneIds[zoneCount] = zoneId;
+    hubLocations[zoneCount] = -1;
+    recentDemand[zoneCount] = 0;
+    return zoneCount++;
+}
+
+void ZoneRebalancer::refreshZones() {
+    if (cityVersion == city->getVersion()) {
+        return;
+    }
+
+    // Zones only ever appear; hubs are the first location seen in each zone
+    locationCount = city->getLocationCount();
+    for (int z = 0; z < zoneCount; z++) {
+        hubLocations[z] = -1;
+    }
+    for (int v = 0; v < locationCount; v++) {
+        int z = zoneIndex(city->getLocationZone(v));
+        if (z < 0) {
+            z = addZone(city->getLocationZone(v));
+        }
+        if (hubLocations[z] < 0) {
+            hubLocations[z] = v;
+        }
+    }
+
+    // One Dijkstra per hub, reused by every run until the graph changes
+    delete[] hubDistances;
+    hubDistances = new int[zoneCount * locationCount > 0 ? zoneCount * locationCount : 1];
+    for (int z = 0; z < zoneCount; z++) {
+        if (hubLocations[z] >= 0) {
+            city->getDistancesFrom(hubLocations[z], &hubDistances[z * locationCount]);
+        } else {
+            for (int v = 0; v < locationCount; v++) {
+                hubDistances[z * locationCount + v] = -1;
+            }
+        }
+    }
+    cityVersion = city->getVersion();
+}
+
+int ZoneRebalancer::zoneDistance(int from, int to) const {
+    if (hubLocations[to] < 0) {
+        return -1;
+    }
+    return hubDistances[from * locationCount + hubLocations[to]];
+}
+
+void ZoneRebalancer::solveFlow(const int* surplus, const int* deficit, int* flow) const {
+    // Nodes: source, zones as senders, zones as receivers, sink
+    int source = 0;
+    int sink = 2 * zoneCount + 1;
+    int nodeCount = 2 * zoneCount + 2;
+    int maxEdges = 2 * (zoneCount * zoneCount + 2 * zoneCount);
+
+    int* head = new int[nodeCount];
+    int* edgeTo = new int[maxEdges];
+    int* edgeCap = new int[maxEdges];
+    int* edgeCost = new int[maxEdges];
+    int* edgeNext = new int[maxEdges];
+    int edgeCount = 0;
+    for (int v = 0; v < nodeCount; v++) {
+        head[v] = -1;
+    }
+
+    // Each edge is stored next to its residual twin (index ^ 1)
+    auto addEdge = [&](int from, int to, int cap, int cost) {
+        edgeTo[edgeCount] = to;
+        edgeCap[edgeCount] = cap;
+        edgeCost[edgeCount] = cost;
+        edgeNext[edgeCount] = head[from];
+        head[from] = edgeCount++;
+        edgeTo[edgeCount] = from;
+        edgeCap[edgeCount] = 0;
+        edgeCost[edgeCount] = -cost;
+        edgeNext[edgeCount] = head[to];
+        head[to] = edgeCount++;
+    };
+
+    for (int i = 0; i < zoneCount; i++) {
+        if (surplus[i] > 0) addEdge(source, 1 + i, surplus[i], 0);
+        if (deficit[i] > 0) addEdge(1 + zoneCount + i, sink, deficit[i], 0);
+    }
+    for (int i = 0; i < zoneCount; i++) {
+        if (surplus[i] <= 0) continue;
+        for (int j = 0; j < zoneCount; j++) {
+            if (deficit[j] <= 0) continue;
+            int distance = zoneDistance(i, j);
+            if (distance >= 0) {
+                addEdge(1 + i, 1 + zoneCount + j, INT_MAX, distance);
+            }
+        }
+    }
+
+    // Successive shortest paths: augment along the cheapest residual path
+    int* dist = new int[nodeCount];
+    int* viaEdge = new int[nodeCount];
+    while (true) {
+        for (int v = 0; v < nodeCount; v++) {
+            dist[v] = INT_MAX;
+            viaEdge[v] = -1;
+        }
+        dist[source] = 0;
+
+        // Bellman-Ford (reverse edges carry negative costs)
+        bool changed = true;
+        for (int round = 0; round < nodeCount - 1 && changed; round++) {
+            changed = false;
+            for (int u = 0; u < nodeCount; u++) {
+                if (dist[u] == INT_MAX) continue;
+                for (int e = head[u]; e >= 0; e = edgeNext[e]) {
+                    if (edgeCap[e] > 0 && dist[u] + edgeCost[e] < dist[edgeTo[e]]) {
+                        dist[edgeTo[e]] = dist[u] + edgeCost[e];
+                        viaEdge[edgeTo[e]] = e;
+                        changed = true;
+                    }
+                }
+            }
+        }
+        if (dist[sink] == INT_MAX) break;
+
+        int amount = INT_MAX;
+        for (int v = sink; v != source; v = edgeTo[viaEdge[v] ^ 1]) {
+            if (edgeCap[viaEdge[v]] < amount) amount = edgeCap[viaEdge[v]];
+        }
+        for (int v = sink; v != source; v = edgeTo[viaEdge[v] ^ 1]) {
+            edgeCap[viaEdge[v]] -= amount;
+            edgeCap[viaEdge[v] ^ 1] += amount;
+        }
+    }
+
+    // Read the zone-to-zone flow off the reverse edges
+    for (int k = 0; k < zoneCount * zoneCount; k++) {
+        flow[k] = 0;
+    }
+    for (int i = 0; i < zoneCount; i++) {
+        for (int e = head[1 + i]; e >= 0; e = edgeNext[e]) {
+            int to = edgeTo[e];
+            if ((e & 1) == 0 && to > zoneCount && to < sink) {
+                flow[i * zoneCount + (to - zoneCount - 1)] = edgeCap[e ^ 1];
+            }
+        }
+    }
+
+    delete[] head;
+    delete[] edgeTo;
+    delete[] edgeCap;
+    delete[] edgeCost;
+    delete[] edgeNext;
+    delete[] dist;
+    delete[] viaEdge;
+}
+
+void ZoneRebalancer::recordRequest(int pickupZoneId) {
+    refreshZones();
+    int z = zoneIndex(pickupZoneId);
+    if (z >= 0) {
+        recentDemand[z]++;
+    }
+}
+
+void ZoneRebalancer::forgetRequest(int pickupZoneId) {
+    int z = zoneIndex(pickupZoneId);
+    if (z >= 0 && recentDemand[z] > 0) {
+        recentDemand[z]--;
+    }
+}
+
+void ZoneRebalancer::ageDemand() {
+    for (int z = 0; z < zoneCount; z++) {
+        recentDemand[z] /= 2;
+    }
+}
+
+int ZoneRebalancer::plan(const DriverTable& fleet, const PendingTripQueue& pending,
+                         RebalanceMove* moves, int maxMoves) {
+    refreshZones();
+    if (zoneCount == 0 || maxMoves <= 0) {
+        return 0;
+    }
+
+    // Supply: idle drivers by zone (kept by the fleet). Demand: waiting + recent requests.
+    const ZoneIdleIndex& idle = fleet.idleByZone();
+    int* supply = new int[zoneCount];
+    int* surplus = new int[zoneCount];
+    int* deficit = new int[zoneCount];
+    for (int z = 0; z < zoneCount; z++) {
+        supply[z] = idle.getIdleCount(zoneIds[z]);
+        int demand = pending.getCount(zoneIds[z]) + recentDemand[z];
+        surplus[z] = (supply[z] > demand) ? supply[z] - demand : 0;
+        deficit[z] = (demand > supply[z]) ? demand - supply[z] : 0;
+    }
+
+    int* flow = new int[zoneCount * zoneCount];
+    solveFlow(surplus, deficit, flow);
+
+    // Turn zone flows into moves: the idle drivers closest to the target hub,
+    // taken from the sending zone's idle list only
+    int moveCount = 0;
+    for (int from = 0; from < zoneCount; from++) {
+        if (surplus[from] == 0) continue;
+
+        int idleCount = 0;
+        int* candidates = new int[supply[from] > 0 ? supply[from] : 1];
+        bool* taken = new bool[supply[from] > 0 ? supply[from] : 1];
+        for (int i = idle.firstIdle(zoneIds[from]); i >= 0 && idleCount < supply[from];
+             i = idle.nextIdle(i)) {
+            candidates[idleCount] = i;
+            taken[idleCount] = false;
+            idleCount++;
+        }
+
+        for (int to = 0; to < zoneCount; to++) {
+            for (int n = flow[from * zoneCount + to]; n > 0 && moveCount < maxMoves; n--) {
+                const int* fromHub = &hubDistances[to * locationCount];
+                int best = -1;
+                for (int c = 0; c < idleCount; c++) {
+                    if (taken[c]) continue;
+                    int location = fleet.locationAt(candidates[c]);
+                    if (location < 0 || location >= locationCount || fromHub[location] < 0) continue;
+                    if (best < 0 || fromHub[location] < fromHub[fleet.locationAt(candidates[best])]) {
+                        best = c;
+                    }
+                }
+                if (best < 0) break;
+
+                taken[best] = true;
+                int slot = candidates[best];
+                moves[moveCount].driverId = fleet.at(slot)->getId();
+                moves[moveCount].fromZone = zoneIds[from];
+                moves[moveCount].toZone = zoneIds[to];
+                moves[moveCount].targetLocationId = hubLocations[to];
+                moves[moveCount].distance = fromHub[fleet.locationAt(slot)];
+                moveCount++;
+            }
+        }
+
+        delete[] candidates;
+        delete[] taken;
+    }
+
+    delete[] supply;
+    delete[] surplus;
+    delete[] deficit;
+    delete[] flow;
+    return moveCount;
+}
+
+int ZoneRebalancer::getZoneCount() {
+    refreshZones();
+    return zoneCount;
+}
+
+int ZoneRebalancer::getHubLocation(int zoneId) {
+    refreshZones();
+    int z = zoneIndex(zoneId);
+    return (z >= 0) ? hubLocations[z] : -1;
+}
@@ -0,0 +1,73 @@
+#ifndef ZONE_REBALANCER_H
+#define ZONE_REBALANCER_H
+
+#include "City.h"
+#include "DriverTable.h"
+#include "PendingTripQueue.h"
+
+// Seconds between rebalancing runs when driven by a timer (web server)
+const int REBALANCE_INTERVAL_SECONDS = 5;
+
+// Send an idle driver from one zone toward another
+struct RebalanceMove {
+    int driverId;
+    int fromZone;
+    int toZone;
+    int targetLocationId;  // Hub of the destination zone
+    int distance;
+
+    RebalanceMove();
+};
+
+// Moves idle drivers from zones with more than they need to zones with
+// waiting or recent requests. Each zone is represented by a hub (its first
+// location); zone-to-zone costs are hub-to-hub road distances, recomputed
+// only when the city graph changes. Surplus and deficit are matched with a
+// min-cost flow over the zone graph. Idle supply and the drivers to send
+// come from the fleet's per-zone idle lists, so a run never scans the
+// whole fleet: it costs the flow problem plus the sending zones' idle lists.
+class ZoneRebalancer {
+private:
+    City* city;
+    int cityVersion;
+
+    // Per zone index
+    int* zoneIds;
+    int* hubLocations;
+    int* recentDemand;  // Recent requests (halved after every applied run)
+    int zoneCount;
+    int zoneCapacity;
+
+    int* hubDistances;  // zoneCount x locationCount, from each hub
+    int locationCount;
+
+    void refreshZones();
+    int zoneIndex(int zoneId) const;
+    int addZone(int zoneId);
+    int zoneDistance(int from, int to) const;  // By zone index, -1 if unreachable
+
+    // Successive shortest paths (Bellman-Ford) from surplus to deficit zones;
+    // flow[i * zoneCount + j] = drivers to move from zone i to zone j
+    void solveFlow(const int* surplus, const int* deficit, int* flow) const;
+
+public:
+    ZoneRebalancer(City* city);
+    ~ZoneRebalancer();
+
+    ZoneRebalancer(const ZoneRebalancer&) = delete;
+    ZoneRebalancer& operator=(const ZoneRebalancer&) = delete;
+
+    // Demand signal: a trip was requested in this pickup zone
+    void recordRequest(int pickupZoneId);
+    void forgetRequest(int pickupZoneId);  // Request rolled back
+    void ageDemand();  // Older requests count half as much each run
+
+    // Plan moves for AVAILABLE drivers; returns how many were written
+    int plan(const DriverTable& fleet, const PendingTripQueue& pending,
+             RebalanceMove* moves, int maxMoves);
+
+    int getZoneCount();
+    int getHubLocation(int zoneId);
+};
+
+#endif
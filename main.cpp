@@ -2,6 +2,9 @@
 #define _HAS_STD_BYTE 0
 
 #include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
 #include "RideShareSystem.h"
 #include "WebServer.h"
 using namespace std;
@@ -22,6 +25,31 @@ bool testCancelAndReassign(RideShareSystem& system);
 bool testSingleRollback(RideShareSystem& system);
 bool testMultipleRollback(RideShareSystem& system);
 bool testAnalyticsAfterRollback(RideShareSystem& system);
+bool testRejectFallback(RideShareSystem& system);
+bool testParallelDispatch(RideShareSystem& system);
+bool testZonePairPenalty(RideShareSystem& system);
+bool testAsyncDispatch(RideShareSystem& system);
+bool testPendingRedispatch(RideShareSystem& system);
+bool testForwardDispatch(RideShareSystem& system);
+bool testPooledRide(RideShareSystem& system);
+bool testFreedDriverReassign(RideShareSystem& system);
+bool testDispatchBudget(RideShareSystem& system);
+bool testZoneRebalance(RideShareSystem& system);
+bool testCapabilityDispatch(RideShareSystem& system);
+bool testIdLookup(RideShareSystem& system);
+bool testTripArchive(RideShareSystem& system);
+bool testPackedRecords(RideShareSystem& system);
+bool testRoadSlab(RideShareSystem& system);
+bool testSecondaryIndexes(RideShareSystem& system);
+bool testAnalyticsCounters(RideShareSystem& system);
+bool testConcurrentAccess(RideShareSystem& system);
+bool testCommandLoop(RideShareSystem& system);
+bool testPublishedSnapshots(RideShareSystem& system);
+bool testPackedDriverPosition(RideShareSystem& system);
+bool testTripStateSwap(RideShareSystem& system);
+bool testRepeatedRollback(RideShareSystem& system);
+bool testArrayGrowth(RideShareSystem& system);
+bool testSystemTransitionRace(RideShareSystem& system);
 
 void displayMenu() {
     cout << "\n========================================" << endl;
@@ -39,6 +67,7 @@ void displayMenu() {
     cout << "10. View Operation History" << endl;
     cout << "11. Run All Tests" << endl;
     cout << "12. Start Web Server & GUI Dashboard" << endl;
+    cout << "13. Dispatch Waiting Trips" << endl;
     cout << "0. Exit" << endl;
     cout << "----------------------------------------" << endl;
     cout << "Enter choice: ";
@@ -308,13 +337,1260 @@ bool testAnalyticsAfterRollback(RideShareSystem& system) {
     return passed;
 }
 
+bool testRejectFallback(RideShareSystem& system) {
+    cout << "\n[TEST 11] Rejection Falls Back to Cached Candidate" << endl;
+
+    int tripId = system.requestTrip(0, 2, 3);  // C to D
+    system.assignTrip(tripId);
+
+    // Bob (D, dist 2) then Mahnoor (A, dist 3) are cached nearest-first
+    Trip* trip = system.getTrip(tripId);
+    int cached = system.getCandidateCount(tripId);
+    cout << "Cached candidates: " << cached << endl;
+
+    int remaining = system.getRemainingCandidates(tripId);
+    system.rejectTrip(tripId);
+    bool fallback = trip->getState() == TRIP_ASSIGNED && trip->getDriverId() == 0;
+    bool released = system.getDriver(1)->getStatus() == DRIVER_AVAILABLE;
+    cout << "Driver after rejection: " << trip->getDriverId() << endl;
+
+    system.rollback(1);  // Undo rejection
+    bool restored = trip->getDriverId() == 1 &&
+                    system.getDriver(1)->getStatus() == DRIVER_BUSY &&
+                    system.getDriver(0)->getStatus() == DRIVER_AVAILABLE &&
+                    system.getRemainingCandidates(tripId) == remaining;
+
+    // Use up the cache; the next rejection searches again, outside the lock
+    int rejections = 0;
+    while (system.getRemainingCandidates(tripId) > 0 && trip->getState() == TRIP_ASSIGNED) {
+        system.rejectTrip(tripId);
+        rejections++;
+    }
+    int rejecting = trip->getDriverId();
+    bool researched = trip->getState() == TRIP_ASSIGNED && system.rejectTrip(tripId) &&
+                      trip->getState() == TRIP_ASSIGNED && trip->getDriverId() != rejecting &&
+                      system.getDriver(rejecting)->getStatus() == DRIVER_AVAILABLE;
+    rejections++;
+    cout << "Driver after re-search: " << trip->getDriverId() << endl;
+    system.rollback(rejections);
+
+    bool passed = cached >= 2 && fallback && released && restored && researched &&
+                  trip->getDriverId() == 1;
+    cout << "Expected: Driver 0 after rejection, Driver 1 after rollback, a fresh driver "
+         << "once the cache is used up - " << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(2);  // Clean up assignment and creation
+
+    return passed;
+}
+
+bool testParallelDispatch(RideShareSystem& system) {
+    cout << "\n[TEST 12] Parallel Zone Dispatch" << endl;
+
+    int tripA = system.requestTrip(0, 2, 3);  // Zone 1 pickup at C
+    int tripB = system.requestTrip(1, 4, 7);  // Zone 2 pickup at E
+    int tripC = system.requestTrip(2, 1, 0);  // Zone 1 pickup at B
+
+    system.startDispatchWorkers();
+
+    // Searches read the fleet unlocked: it cannot change under the workers
+    bool frozen = system.addDriver("Late", 0, 1) == -1 &&
+                  !system.setDriverCapabilities(0, CAP_XL, DEFAULT_SEAT_COUNT) &&
+                  system.getDriver(0)->getCapabilities() == CAP_NONE;
+
+    // Three requests race for three drivers on different threads
+    bool assignedA = false, assignedB = false, assignedC = false;
+    thread first([&] { assignedA = system.dispatchTrip(tripA); });
+    thread second([&] { assignedB = system.dispatchTrip(tripB); });
+    thread third([&] { assignedC = system.dispatchTrip(tripC); });
+    first.join();
+    second.join();
+    third.join();
+
+    system.stopDispatchWorkers();
+
+    int driverA = system.getTrip(tripA)->getDriverId();
+    int driverB = system.getTrip(tripB)->getDriverId();
+    int driverC = system.getTrip(tripC)->getDriverId();
+    cout << "Drivers: " << driverA << ", " << driverB << ", " << driverC << endl;
+
+    bool distinct = driverA != driverB && driverB != driverC && driverA != driverC;
+    bool passed = assignedA && assignedB && assignedC && distinct && driverB == 2 && frozen;
+    cout << "Expected: all assigned to distinct drivers, fleet frozen while running - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(6);  // Clean up assignments and creations
+
+    return passed;
+}
+
+bool testZonePairPenalty(RideShareSystem& system) {
+    cout << "\n[TEST 13] Zone-Pair Penalty Matrix" << endl;
+
+    // Default: 50% for any cross-zone pair
+    bool defaults = system.getEffectiveDistance(10, 1, 2) == 15 &&
+                    system.getEffectiveDistance(10, 1, 1) == 10;
+
+    // Zone 1 -> 2 gets cheaper; 2 -> 1 keeps the default
+    system.setZonePenalty(1, 2, 20);
+    bool pairwise = system.getEffectiveDistance(10, 1, 2) == 12 &&
+                    system.getEffectiveDistance(10, 2, 1) == 15;
+
+    // Rush hour doubles the penalty
+    system.setHourMultiplier(8, 200);
+    system.setCurrentHour(8);
+    int rushHour = system.getEffectiveDistance(10, 1, 2);
+    cout << "Zone 1 -> 2 at 08:00 for distance 10: " << rushHour << endl;
+
+    bool passed = defaults && pairwise && rushHour == 14;
+    cout << "Expected: 15/12/14 - " << (passed ? "PASSED" : "FAILED") << endl;
+
+    // Restore defaults for later tests
+    system.setZonePenalty(1, 2, DEFAULT_CROSS_ZONE_PENALTY);
+    system.setCurrentHour(0);
+
+    return passed;
+}
+
+static void recordAsyncResult(int, bool assigned, void* context) {
+    // 1 = assigned, 2 = no driver
+    ((atomic<int>*)context)->store(assigned ? 1 : 2);
+}
+
+bool testAsyncDispatch(RideShareSystem& system) {
+    cout << "\n[TEST 14] Asynchronous Dispatch Pipeline" << endl;
+
+    system.startDispatchWorkers();
+
+    atomic<int> callbackResult(0);
+    int tripId = system.requestTripAsync(0, 2, 3, recordAsyncResult, &callbackResult);
+    cout << "requestTripAsync returned trip " << tripId << endl;
+
+    // Poll until the worker reports back (bounded wait)
+    int status = system.getDispatchStatus(tripId);
+    for (int i = 0; i < 200 && status == DISPATCH_QUEUED; i++) {
+        this_thread::sleep_for(chrono::milliseconds(5));
+        status = system.getDispatchStatus(tripId);
+    }
+    system.stopDispatchWorkers();
+
+    Trip* trip = system.getTrip(tripId);
+    cout << "Dispatch status: " << DISPATCH_STATUS_NAMES[status]
+         << ", callback: " << callbackResult.load() << endl;
+
+    bool passed = tripId >= 0 && status == DISPATCH_ASSIGNED &&
+                  callbackResult.load() == 1 && trip->getState() == TRIP_ASSIGNED;
+    cout << "Expected: Assigned via worker with callback - " << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(2);  // Clean up assignment and creation
+
+    return passed;
+}
+
+bool testPendingRedispatch(RideShareSystem& system) {
+    cout << "\n[TEST 15] Pending Trip Re-dispatch" << endl;
+
+    // Occupy all three drivers
+    int tripA = system.requestTrip(0, 2, 3);
+    int tripB = system.requestTrip(1, 4, 7);
+    int tripC = system.requestTrip(2, 1, 0);
+    system.assignTrip(tripA);
+    system.assignTrip(tripB);
+    system.assignTrip(tripC);
+
+    // Nobody left: the fourth trip waits in zone 1
+    int waiting = system.requestTrip(0, 0, 3);
+    bool queued = !system.assignTrip(waiting) && system.getPendingTripCount() == 1;
+
+    // Finishing trip A frees its driver, who takes the waiting trip
+    int freedDriver = system.getTrip(tripA)->getDriverId();
+    system.startTrip(tripA);
+    system.completeTrip(tripA);
+    Trip* trip = system.getTrip(waiting);
+    bool matched = trip->getState() == TRIP_ASSIGNED &&
+                   trip->getDriverId() == freedDriver &&
+                   system.getPendingTripCount() == 0;
+
+    // Undoing the automatic assignment puts the trip back in line
+    system.rollback(1);
+    bool requeued = trip->getState() == TRIP_REQUESTED &&
+                    system.getPendingTripCount() == 1 &&
+                    system.getDriver(freedDriver)->getStatus() == DRIVER_AVAILABLE;
+
+    bool passed = queued && matched && requeued;
+    cout << "Expected: queued, matched on completion, re-queued on rollback - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(9);  // Clean up remaining operations
+
+    return passed;
+}
+
+bool testForwardDispatch(RideShareSystem& system) {
+    cout << "\n[TEST 16] Forward Dispatch to Finishing Driver" << endl;
+
+    // Bob drives D -> C (2 left); a new pickup at C is 2 away via Bob,
+    // 3 away via Mahnoor from A
+    int current = system.requestTrip(0, 3, 2);
+    system.assignTrip(current);
+    system.startTrip(current);
+
+    int next = system.requestTrip(1, 2, 0);
+    system.assignTrip(next);
+
+    Driver* bob = system.getDriver(1);
+    bool queued = system.getTrip(next)->getDriverId() == 1 &&
+                  bob->getQueuedTripId() == next &&
+                  system.getDriver(0)->getStatus() == DRIVER_AVAILABLE;
+    bool blocked = !system.startTrip(next);  // Bob has not dropped off yet
+
+    system.completeTrip(current);
+    bool continued = bob->getStatus() == DRIVER_BUSY && bob->getActiveTripId() == next;
+    bool started = system.startTrip(next);
+
+    system.rollback(2);  // Undo start and completion
+    bool restored = bob->getActiveTripId() == current && bob->getQueuedTripId() == next;
+
+    // A search scores a driver from one read: BUSY with no route left (just
+    // claimed) is not finishing, and never adds a negative remaining distance
+    DriverTable probe;
+    int slot = probe.add(0, "Probe", 3, 1);
+    probe.at(slot)->setStatus(DRIVER_BUSY);
+    int from, zone, extra;
+    bool unrouted = !probe.startPointAt(slot, true, from, zone, extra);
+    probe.at(slot)->beginRoute(2, 1, 4);
+    bool routed = probe.startPointAt(slot, true, from, zone, extra) && from == 2 && extra == 4 &&
+                  !probe.startPointAt(slot, false, from, zone, extra);
+
+    bool passed = queued && blocked && continued && started && restored && unrouted && routed;
+    cout << "Expected: queued behind Bob, started after drop-off - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(5);  // Clean up
+
+    return passed;
+}
+
+bool testPooledRide(RideShareSystem& system) {
+    cout << "\n[TEST 17] Shared Ride Pooling" << endl;
+
+    // A -> D goes through C, so a C -> D rider joins Mahnoor for free
+    // (Bob would have to drive 2 to reach C)
+    int first = system.requestTrip(0, 0, 3);
+    system.assignPooledTrip(first);
+    int second = system.requestTrip(1, 2, 3);
+    system.assignPooledTrip(second);
+
+    Driver* mahnoor = system.getDriver(0);
+    bool shared = system.getTrip(first)->getDriverId() == 0 &&
+                  system.getTrip(second)->getDriverId() == 0 &&
+                  system.getPoolStopCount(0) == 4 &&
+                  system.getDriver(1)->getStatus() == DRIVER_AVAILABLE;
+
+    // Stops are served in route order: A pickup, C pickup, then the drop-offs at D
+    bool ordered = !system.startTrip(second);
+    ordered = system.startTrip(first) && ordered;
+    ordered = system.startTrip(second) && ordered;
+    ordered = system.completeTrip(second) && ordered;
+    bool stillBusy = mahnoor->getStatus() == DRIVER_BUSY;
+    ordered = system.completeTrip(first) && ordered;
+    bool freed = mahnoor->getStatus() == DRIVER_AVAILABLE && system.getPoolStopCount(0) == 0;
+
+    system.rollback(4);  // Back to both riders waiting for pickup
+    bool restored = system.getPoolStopCount(0) == 4 && mahnoor->getStatus() == DRIVER_BUSY &&
+                    mahnoor->getCurrentLocationId() == 0;
+
+    system.cancelTrip(second);
+    bool cancelled = system.getPoolStopCount(0) == 2;
+    system.rollback(1);
+    cancelled = cancelled && system.getPoolStopCount(0) == 4;
+
+    system.rollback(4);  // Clean up
+
+    // A shared ride with no driver waits, and is pooled (not assigned solo)
+    // when the only driver frees up
+    RideShareSystem small;
+    small.addLocation("P0", 1);
+    small.addLocation("P1", 1);
+    small.addLocation("P2", 1);
+    small.addRoad(0, 1, 1);
+    small.addRoad(1, 2, 1);
+    small.addDriver("Solo", 0, 1);
+    small.addRider("Rider");
+    int solo = small.requestTrip(0, 0, 1);
+    small.assignTrip(solo);
+    int waiting = small.requestTrip(0, 1, 2);
+    bool queued = !small.assignPooledTrip(waiting) &&
+                  small.getTrip(waiting)->getDispatchStatus() == DISPATCH_NO_DRIVER;
+    small.startTrip(solo);
+    small.completeTrip(solo);
+    bool repooled = queued && small.getTrip(waiting)->getState() == TRIP_ASSIGNED &&
+                    small.getTrip(waiting)->isPooled() && small.getPoolStopCount(0) == 2;
+
+    bool passed = shared && ordered && stillBusy && freed && restored && cancelled && repooled;
+    cout << "Expected: both riders share Mahnoor, served in stop order; a waiting "
+         << "shared ride is pooled - " << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testFreedDriverReassign(RideShareSystem& system) {
+    cout << "\n[TEST 18] Reassign to Closer Freed Driver" << endl;
+
+    // Bob drives D -> B; a pickup at B goes to Mahnoor (5 away) meanwhile
+    system.setForwardDispatch(false);
+    int totalBefore = system.getTotalTripCount();
+    int current = system.requestTrip(0, 3, 1);
+    system.assignTrip(current);
+    system.startTrip(current);
+    int waiting = system.requestTrip(1, 1, 0);
+    system.assignTrip(waiting);
+    bool firstPick = system.getTrip(waiting)->getDriverId() == 0;
+
+    // Bob frees up right at B: saving 5 beats the threshold
+    system.completeTrip(current);
+    bool moved = system.getTrip(waiting)->getDriverId() == 1 &&
+                 system.getDriver(0)->getStatus() == DRIVER_AVAILABLE &&
+                 system.getDriver(1)->getActiveTripId() == waiting;
+
+    system.rollback(1);  // Undo the swap only; it must not be redone
+    bool undone = system.getTrip(waiting)->getDriverId() == 0 &&
+                  system.getDriver(1)->getStatus() == DRIVER_AVAILABLE;
+
+    // One step at a time back to the start: undoing the completion and the
+    // assignments frees drivers again, but no swap may be recorded, or the
+    // next rollback(1) would undo that instead of older history
+    for (int i = 0; i < 6; i++) {
+        system.rollback(1);
+    }
+    bool unwound = system.getTotalTripCount() == totalBefore &&
+                   system.getDriver(0)->getStatus() == DRIVER_AVAILABLE &&
+                   system.getDriver(1)->getStatus() == DRIVER_AVAILABLE;
+    system.setForwardDispatch(true);
+
+    bool passed = firstPick && moved && undone && unwound;
+    cout << "Expected: trip moves to Bob, swap undone by repeated rollback - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testDispatchBudget(RideShareSystem& system) {
+    cout << "\n[TEST 19] Latency-Budgeted Dispatch" << endl;
+
+    // Zero budget stops after the pickup itself: Mahnoor stands at A,
+    // but nobody further out was checked, so optimality is unproven
+    bool optimal = true;
+    int atDriver = system.requestTrip(0, 0, 3);
+    bool quick = system.assignTrip(atDriver, 0, optimal) &&
+                 system.getTrip(atDriver)->getDriverId() == 0 && !optimal;
+    system.rollback(2);
+
+    // Unbounded search proves the same answer
+    int unbounded = system.requestTrip(0, 0, 3);
+    bool proven = system.assignTrip(unbounded, DISPATCH_NO_BUDGET, optimal) &&
+                  system.getTrip(unbounded)->getDriverId() == 0 && optimal;
+    system.rollback(2);
+
+    // Nobody at H: out of time with no driver, the search widens instead
+    // of leaving the trip requested with nothing to retry it
+    int remote = system.requestTrip(1, 7, 4);
+    bool deferred = system.assignTrip(remote, 0, optimal) &&
+                    system.getTrip(remote)->getState() == TRIP_ASSIGNED &&
+                    system.getPendingTripCount() == 0;
+    system.rollback(2);
+
+    // Drivers are bucketed in batches as the search runs: the only driver
+    // at the pickup is bucketed after the pickup has settled, and still wins
+    RideShareSystem large;
+    for (int i = 0; i < 10; i++) {
+        large.addLocation("L" + to_string(i), 1);
+    }
+    for (int i = 0; i + 1 < 10; i++) {
+        large.addRoad(i, i + 1, 1);
+    }
+    const int farDrivers = SEARCH_BUCKET_BATCH + 16;
+    for (int i = 0; i < farDrivers; i++) {
+        large.addDriver("Far " + to_string(i), 0, 1);
+    }
+    large.addDriver("Near", 9, 1);
+    large.addRider("Rider");
+    int lateTrip = large.requestTrip(0, 9, 5);
+    bool lateBucketed = large.assignTrip(lateTrip, DISPATCH_NO_BUDGET, optimal) &&
+                        large.getTrip(lateTrip)->getDriverId() == farDrivers && optimal;
+
+    bool passed = quick && proven && deferred && lateBucketed;
+    cout << "Expected: best-so-far within budget, optimality reported - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testZoneRebalance(RideShareSystem& system) {
+    cout << "\n[TEST 20] Idle-Driver Zone Rebalancing" << endl;
+
+    // Charlie (the only Zone 2 driver) gets busy and two more Zone 2
+    // requests come in; Mahnoor and Bob sit idle in Zone 1
+    int busy = system.requestTrip(0, 6, 7);
+    system.assignTrip(busy);
+    system.requestTrip(1, 4, 5);
+    system.requestTrip(2, 4, 6);
+
+    RebalanceMove moves[3];
+    int planned = system.planRebalance(moves, 3);
+    bool planOk = planned == 2;
+    for (int i = 0; i < planned; i++) {
+        planOk = planOk && moves[i].fromZone == 1 && moves[i].toZone == 2 &&
+                 moves[i].targetLocationId == 4;
+    }
+
+    int applied = system.rebalanceIdleDrivers();
+    bool moved = applied == 2 &&
+                 system.getDriver(0)->getZoneId() == 2 && system.getDriver(1)->getZoneId() == 2 &&
+                 system.getDriver(1)->getCurrentLocationId() == 4;
+
+    // Moves are on the undo stack: rolling them back returns both drivers
+    system.rollback(2);
+    bool undone = system.getDriver(0)->getCurrentLocationId() == 0 &&
+                  system.getDriver(0)->getZoneId() == 1 &&
+                  system.getDriver(1)->getCurrentLocationId() == 3 &&
+                  system.planRebalance(moves, 3) > 0;
+
+    bool passed = planOk && moved && undone;
+    cout << "Expected: both idle Zone 1 drivers sent to Zone 2 hub, moves undone - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(4);  // Clean up
+
+    return passed;
+}
+
+bool testCapabilityDispatch(RideShareSystem& system) {
+    cout << "\n[TEST 21] Capability-Filtered Dispatch" << endl;
+
+    // Only Charlie (Zone 2) has a ramp; a pickup at A must skip Mahnoor
+    system.setDriverCapabilities(2, CAP_ACCESSIBLE, 4);
+    bool indexed = system.getEligibleDriverCount(CAP_ACCESSIBLE) == 1 &&
+                   system.getEligibleDriverCount(CAP_NONE) == 3;
+    int ramp = system.requestTrip(0, 0, 3, CAP_ACCESSIBLE);
+    bool filtered = system.assignTrip(ramp) && system.getTrip(ramp)->getDriverId() == 2;
+
+    // No XL vehicle: the trip waits until one shows up
+    int large = system.requestTrip(1, 1, 2, CAP_XL);
+    bool waits = !system.assignTrip(large) && system.getPendingTripCount() == 1;
+    system.setDriverCapabilities(1, CAP_XL | CAP_CARGO, 6);
+    bool served = system.getTrip(large)->getDriverId() == 1 && system.getPendingTripCount() == 0;
+
+    // Bits outside the defined CAP_* flags are rejected, not silently unmatched
+    bool rejected = system.requestTrip(0, 0, 3, CAP_ALL + 1) < 0 &&
+                    system.requestTrip(0, 0, 3, -1) < 0;
+
+    bool passed = indexed && filtered && waits && served && rejected;
+    cout << "Expected: only equipped drivers are matched, unknown bits rejected - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    // Clean up
+    system.rollback(4);
+    system.setDriverCapabilities(1, CAP_NONE, DEFAULT_SEAT_COUNT);
+    system.setDriverCapabilities(2, CAP_NONE, DEFAULT_SEAT_COUNT);
+
+    return passed;
+}
+
+bool testIdLookup(RideShareSystem& system) {
+    cout << "\n[TEST 22] Indexed Trip Lookup" << endl;
+
+    // Enough trips to resize the trip array and the ID index
+    const int count = 80;
+    int ids[count];
+    for (int i = 0; i < count; i++) {
+        ids[i] = system.requestTrip(i % 3, 0, 3);
+    }
+    int first = ids[0], last = ids[count - 1];
+    bool found = system.getDispatchStatus(first) == DISPATCH_NONE &&
+                 system.getDispatchStatus(last) == DISPATCH_NONE &&
+                 system.getTrip(first)->getRiderId() == 0 &&
+                 system.getTrip(last)->getRiderId() == (count - 1) % 3;
+
+    // Rolled-back trips drop out; a new trip takes a freed slot under a
+    // new generation, and the old ID stays stale
+    int middle = ids[count / 2];
+    system.rollback(count / 2);
+    bool dropped = system.getDispatchStatus(last) == -1 &&
+                   system.getDispatchStatus(first) == DISPATCH_NONE;
+    int reused = system.requestTrip(0, 1, 2);
+    bool reindexed = handleSlot(reused) == handleSlot(middle) && reused != middle &&
+                     system.getDispatchStatus(reused) == DISPATCH_NONE &&
+                     system.getDispatchStatus(middle) == -1 && system.getTrip(middle) == nullptr;
+
+    bool passed = found && dropped && reindexed;
+    cout << "Expected: lookups follow growth and rollback, stale IDs rejected - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    system.rollback(count / 2 + 1);  // Clean up
+
+    return passed;
+}
+
+bool testTripArchive(RideShareSystem& system) {
+    cout << "\n[TEST 23] Settled Trip Archive" << endl;
+
+    // Settled trips cannot be rolled back, so this runs on its own system
+    (void)system;
+    RideShareSystem scratch;
+    setupSampleCity(scratch);
+
+    // Four operations per trip: enough to push the oldest out of the window
+    const int count = ROLLBACK_HISTORY_LIMIT / 4 + 10;
+    int first = -1;
+    for (int i = 0; i < count; i++) {
+        int tripId = (i % 2 == 0) ? scratch.requestTrip(i % 3, 0, 3) : scratch.requestTrip(i % 3, 3, 0);
+        scratch.assignTrip(tripId);
+        scratch.startTrip(tripId);
+        scratch.completeTrip(tripId);
+        if (first < 0) first = tripId;
+    }
+    scratch.requestTrip(0, 1, 2);  // Archiving happens at the next request
+
+    int archived = scratch.getArchivedTripCount();
+    bool moved = archived > 0 &&
+                 scratch.getLiveTripCount() + archived == count + 1 &&
+                 scratch.getTotalTripCount() == count + 1;
+
+    // Archived trips are still found by ID and still counted
+    // (as a copy: an archived trip has no live record to point at)
+    Trip oldest;
+    bool reachable = scratch.getTrip(first) == nullptr &&
+                     scratch.getTripSnapshot(first, oldest) &&
+                     oldest.getState() == TRIP_COMPLETED && oldest.getDriverId() >= 0 &&
+                     oldest.getDistance() == scratch.getDistance(0, 3) &&
+                     scratch.getCompletedTripCount() == count;
+
+    // Rider history runs through live trips into the archive, oldest last
+    int* history = new int[count + 1];
+    int riderTrips = scratch.getRiderTrips(0, history, count + 1);
+    bool chained = riderTrips == (count + 2) / 3 + 1 && history[riderTrips - 1] == first;
+    delete[] history;
+
+    // Rollback stops at the window; archived trips stay settled
+    scratch.rollback(2 * ROLLBACK_HISTORY_LIMIT);
+    bool settled = scratch.getArchivedTripCount() == archived &&
+                   scratch.getTripSnapshot(first, oldest) &&
+                   oldest.getState() == TRIP_COMPLETED;
+
+    bool passed = moved && reachable && chained && settled;
+    cout << "Expected: settled trips archived, still reachable by ID and history - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testPackedRecords(RideShareSystem& system) {
+    cout << "\n[TEST 24] Packed Trip and Driver Records" << endl;
+
+    int recordBytes = system.getTripRecordBytes();
+    int tripBytes = system.getBytesPerTrip();
+    int driverBytes = system.getBytesPerDriver();
+    cout << "Bytes per trip record: " << recordBytes << " (" << tripBytes
+         << " with side tables), per driver: " << driverBytes << endl;
+    bool compact = recordBytes <= 36 && driverBytes <= 72 &&
+                   tripBytes > recordBytes + CandidateCache::getBytesPerTrip();
+
+    // Names resolve through the interned table
+    bool named = system.getDriver(0)->getName() == "Mahnoor" &&
+                 system.getDriver(2)->getName() == "Charlie";
+
+    // Candidates sit beside the trip and are dropped once the rider is aboard
+    int tripId = system.requestTrip(0, 2, 3);
+    system.assignTrip(tripId);
+    int cached = system.getCandidateCount(tripId);
+    system.startTrip(tripId);
+    bool released = cached > 0 && system.getCandidateCount(tripId) == 0;
+
+    system.rollback(3);  // Undo start, assign and request
+
+    bool passed = compact && named && released;
+    cout << "Expected: small fixed records, names and candidates kept aside - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testRoadSlab(RideShareSystem& system) {
+    cout << "\n[TEST 25] Road Edge Slab" << endl;
+
+    City& city = system.getCity();
+    int roadCount = city.getRoadCount();
+    int before = system.getDistance(0, 7);
+
+    // After compaction each location's roads sit next to each other
+    city.compactRoads();
+    bool contiguous = true;
+    for (int i = 0; i < city.getLocationCount(); i++) {
+        for (Edge* edge = city.getLocation(i)->adjacencyList; edge != nullptr; edge = edge->next) {
+            if (edge->next != nullptr && edge->next != edge + 1) {
+                contiguous = false;
+            }
+        }
+    }
+    cout << "Directed edges: " << city.getRoadCount() << endl;
+
+    bool unchanged = city.getRoadCount() == roadCount && roadCount == 16 &&
+                     system.getDistance(0, 7) == before && before == 24;
+
+    bool passed = contiguous && unchanged;
+    cout << "Expected: roads packed per location, same distances - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testSecondaryIndexes(RideShareSystem& system) {
+    cout << "\n[TEST 26] Secondary Trip Indexes" << endl;
+
+    int ids[16];
+    int ongoingBefore = system.getLiveTripCountInState(TRIP_ONGOING);
+
+    int tripA = system.requestTrip(0, 2, 3);
+    int tripB = system.requestTrip(0, 1, 0);
+    system.requestTrip(1, 4, 7);
+    system.assignTrip(tripA);
+    int driverA = system.getTrip(tripA)->getDriverId();
+    system.startTrip(tripA);
+
+    // Newest first per rider; the active trip is the newest unfinished one
+    int riderTrips = system.getRiderTrips(0, ids, 16);
+    bool byRider = riderTrips >= 2 && ids[0] == tripB && ids[1] == tripA &&
+                   system.getActiveTripForRider(0) == tripB;
+
+    bool byDriver = system.getDriverTrips(driverA, ids, 16) >= 1 && ids[0] == tripA;
+
+    int ongoing = system.getTripsInState(TRIP_ONGOING, ids, 16);
+    bool byState = ongoing == ongoingBefore + 1 && ids[0] == tripA &&
+                   system.getLiveTripCountInState(TRIP_ONGOING) == ongoing;
+    cout << "Rider 0 trips: " << riderTrips << ", ongoing: " << ongoing << endl;
+
+    // Rollback moves the trip back between state lists
+    system.rollback(1);  // Undo start
+    bool restored = system.getLiveTripCountInState(TRIP_ONGOING) == ongoingBefore &&
+                    system.getTripsInState(TRIP_ASSIGNED, ids, 16) >= 1 && ids[0] == tripA;
+
+    system.rollback(4);  // Undo assignment and the three requests
+    bool removed = system.getActiveTripForRider(0) != tripB &&
+                   (system.getRiderTrips(0, ids, 16) == 0 || ids[0] != tripB);
+
+    bool passed = byRider && byDriver && byState && restored && removed;
+    cout << "Expected: rider, driver and state ranges follow changes and rollback - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testAnalyticsCounters(RideShareSystem& system) {
+    cout << "\n[TEST 27] Incremental Analytics Counters" << endl;
+
+    int completedBefore = system.getCompletedTripCount();
+    int cancelledBefore = system.getCancelledTripCount();
+    double distanceBefore = system.getAverageTripDistance() * completedBefore;
+
+    // One completed trip (A to D, distance 5) and one cancelled trip
+    int done = system.requestTrip(0, 0, 3);
+    system.assignTrip(done);
+    system.startTrip(done);
+    system.completeTrip(done);
+    int dropped = system.requestTrip(1, 4, 7);
+    system.cancelTrip(dropped);
+
+    int completed = system.getCompletedTripCount();
+    double expectedAverage = (distanceBefore + 5) / (completedBefore + 1);
+    double average = system.getAverageTripDistance();
+    bool counted = completed == completedBefore + 1 &&
+                   system.getCancelledTripCount() == cancelledBefore + 1 &&
+                   average > expectedAverage - 0.001 && average < expectedAverage + 0.001;
+    cout << "Completed: " << completed << ", average distance: " << average << endl;
+
+    // Rollback reverses every counter
+    system.rollback(6);
+    double averageAfter = system.getAverageTripDistance() * system.getCompletedTripCount();
+    bool reversed = system.getCompletedTripCount() == completedBefore &&
+                    system.getCancelledTripCount() == cancelledBefore &&
+                    averageAfter > distanceBefore - 0.001 && averageAfter < distanceBefore + 0.001;
+
+    bool passed = counted && reversed;
+    cout << "Expected: counters follow transitions and rollback - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testConcurrentAccess(RideShareSystem& system) {
+    cout << "\n[TEST 28] Concurrent Requests and Snapshot Reads" << endl;
+
+    const int WRITERS = 4;
+    const int PER_WRITER = 10;
+    int totalBefore = system.getTotalTripCount();
+    int cancelledBefore = system.getCancelledTripCount();
+
+    // Writers request trips and cancel every other one while readers copy
+    // single records and the whole live array
+    int ids[WRITERS * PER_WRITER];
+    atomic<int> mismatches(0);
+    atomic<bool> writing(true);
+    thread writers[WRITERS];
+    for (int w = 0; w < WRITERS; w++) {
+        writers[w] = thread([&, w] {
+            for (int i = 0; i < PER_WRITER; i++) {
+                int tripId = system.requestTrip(w % 2, w, w + 4);
+                ids[w * PER_WRITER + i] = tripId;
+                Trip copy;
+                if (tripId < 0 || !system.getTripSnapshot(tripId, copy) ||
+                    copy.getId() != tripId || copy.getPickupLocationId() != w) {
+                    mismatches++;
+                }
+                if (i % 2 == 1 && !system.cancelTrip(tripId)) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    thread reader([&] {
+        Trip live[64];
+        while (writing) {
+            DriverSnapshot driver;
+            if (!system.getDriverSnapshot(0, driver) || driver.id != 0) {
+                mismatches++;
+            }
+            int count = system.copyLiveTrips(live, 64);
+            for (int i = 0; i < count; i++) {
+                if (live[i].getId() < 0) mismatches++;
+            }
+            system.getCompletedTripCount();
+        }
+    });
+    for (int w = 0; w < WRITERS; w++) {
+        writers[w].join();
+    }
+    writing = false;
+    reader.join();
+
+    // Every request got its own ID and every change was counted once
+    bool distinct = true;
+    for (int i = 0; i < WRITERS * PER_WRITER; i++) {
+        for (int j = i + 1; j < WRITERS * PER_WRITER; j++) {
+            if (ids[i] == ids[j]) distinct = false;
+        }
+    }
+    int created = WRITERS * PER_WRITER;
+    int cancelled = WRITERS * (PER_WRITER / 2);
+    bool counted = system.getTotalTripCount() == totalBefore + created &&
+                   system.getCancelledTripCount() == cancelledBefore + cancelled;
+    cout << "Trips: " << created << ", cancelled: " << cancelled
+         << ", mismatches: " << mismatches << endl;
+
+    // The history holds one record per change, so rollback undoes them all
+    system.rollback(created + cancelled);
+    bool restored = system.getTotalTripCount() == totalBefore &&
+                    system.getCancelledTripCount() == cancelledBefore;
+
+    bool passed = mismatches == 0 && distinct && counted && restored;
+    cout << "Expected: unique IDs, consistent snapshots, full rollback - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testCommandLoop(RideShareSystem& system) {
+    cout << "\n[TEST 29] Single-Writer Command Loop" << endl;
+
+    const int PRODUCERS = 4;
+    const int PER_PRODUCER = 8;
+    int totalBefore = system.getTotalTripCount();
+    int cancelledBefore = system.getCancelledTripCount();
+
+    // Producers submit requests and cancels; one writer applies them all
+    system.startCommandLoop();
+    int ids[PRODUCERS * PER_PRODUCER];
+    atomic<int> failures(0);
+    thread producers[PRODUCERS];
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers[p] = thread([&, p] {
+            for (int i = 0; i < PER_PRODUCER; i++) {
+                int tripId = system.execute(CMD_REQUEST_TRIP, p % 2, p, p + 4, CAP_NONE);
+                ids[p * PER_PRODUCER + i] = tripId;
+                // Applied before execute returned, so the trip is visible now
+                Trip copy;
+                if (tripId < 0 || !system.getTripSnapshot(tripId, copy)) {
+                    failures++;
+                }
+                if (i % 2 == 0 && system.execute(CMD_CANCEL_TRIP, tripId) != 1) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers[p].join();
+    }
+
+    // A dispatch worker hands its claim to the writer rather than committing
+    system.startDispatchWorkers();
+    int appliedBefore = system.getAppliedCommandCount();
+    int asyncTrip = system.execute(CMD_REQUEST_TRIP_ASYNC, 0, 2, 3, CAP_NONE);
+    int status = system.getDispatchStatus(asyncTrip);
+    for (int i = 0; i < 200 && status == DISPATCH_QUEUED; i++) {
+        this_thread::sleep_for(chrono::milliseconds(5));
+        status = system.getDispatchStatus(asyncTrip);
+    }
+    system.stopDispatchWorkers();
+    bool viaWriter = status != DISPATCH_QUEUED &&
+                     system.getAppliedCommandCount() == appliedBefore + 2;
+    int asyncOps = status == DISPATCH_ASSIGNED ? 2 : 1;
+    cout << "Async dispatch committed by the writer: " << (viaWriter ? "yes" : "no") << endl;
+
+    // An assign command searches on the caller; only its commit reaches the writer
+    int directTrip = system.execute(CMD_REQUEST_TRIP, 1, 4, 7, CAP_NONE);
+    int appliedBeforeAssign = system.getAppliedCommandCount();
+    bool directAssigned = system.execute(CMD_ASSIGN_TRIP, directTrip) == 1;
+    bool searchedOffWriter = system.getAppliedCommandCount() == appliedBeforeAssign + 1;
+    asyncOps += directAssigned ? 2 : 1;
+
+    bool wasRunning = system.isCommandLoopRunning();
+    system.stopCommandLoop();
+
+    bool distinct = true;
+    for (int i = 0; i < PRODUCERS * PER_PRODUCER; i++) {
+        for (int j = i + 1; j < PRODUCERS * PER_PRODUCER; j++) {
+            if (ids[i] == ids[j]) distinct = false;
+        }
+    }
+    int created = PRODUCERS * PER_PRODUCER;
+    int cancelled = PRODUCERS * (PER_PRODUCER / 2);
+    bool applied = system.getTotalTripCount() == totalBefore + created + 2 &&
+                   system.getCancelledTripCount() == cancelledBefore + cancelled;
+    cout << "Commands applied: " << created + cancelled << ", failures: " << failures << endl;
+
+    // Stopped: commands run inline on the caller
+    bool inlineRollback = system.execute(CMD_ROLLBACK, created + cancelled + asyncOps) == 1;
+    bool restored = system.getTotalTripCount() == totalBefore &&
+                    system.getCancelledTripCount() == cancelledBefore;
+
+    bool passed = wasRunning && failures == 0 && distinct && applied && viaWriter &&
+                  searchedOffWriter && inlineRollback && restored;
+    cout << "Expected: every command applied once by the writer, inline after stop - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testPublishedSnapshots(RideShareSystem& system) {
+    cout << "\n[TEST 30] Published State Snapshots" << endl;
+
+    int tripsBefore = system.getLiveTripCount();
+    system.publishSnapshot();
+    shared_ptr<const StateSnapshot> first = system.getStateSnapshot();
+    bool matches = first && first->driverCount == system.getDriverCount() &&
+                   first->tripCount == tripsBefore &&
+                   first->analytics.totalTrips == system.getTotalTripCount() &&
+                   first->analytics.completedTrips == system.getCompletedTripCount();
+
+    // Nothing changed, or only read (a rebalance plan and a status check):
+    // the same snapshot stays published
+    RebalanceMove moves[4];
+    system.planRebalance(moves, 4);
+    system.assignTrip(-1);
+    system.publishSnapshot();
+    bool reused = system.getStateSnapshot() == first;
+
+    // Readers spin on the published state while the writer changes and republishes
+    atomic<bool> publishing(true);
+    atomic<int> torn(0);
+    thread reader([&] {
+        while (publishing) {
+            shared_ptr<const StateSnapshot> state = system.getStateSnapshot();
+            if (state->tripCount + state->analytics.archivedTrips != state->analytics.totalTrips) {
+                torn++;
+            }
+        }
+    });
+    const int REQUESTS = 5;
+    for (int i = 0; i < REQUESTS; i++) {
+        system.requestTrip(0, 0, 3);
+        system.publishSnapshot();
+    }
+    publishing = false;
+    reader.join();
+
+    // New version with the new trips; the road map is shared; the old copy is untouched
+    shared_ptr<const StateSnapshot> latest = system.getStateSnapshot();
+    bool advanced = latest->version > first->version &&
+                    latest->tripCount == tripsBefore + REQUESTS &&
+                    latest->getTrip(latest->tripCount - 1).getPickupLocationId() == 0 &&
+                    latest->city == first->city &&
+                    first->tripCount == tripsBefore;
+    // Requests touch no driver: the driver chunks are shared, not copied
+    bool shared = latest->driverChunkCount == first->driverChunkCount;
+    for (int c = 0; c < latest->driverChunkCount; c++) {
+        if (latest->driverChunks[c] != first->driverChunks[c]) shared = false;
+    }
+    cout << "Versions: " << first->version << " -> " << latest->version
+         << ", torn reads: " << torn << endl;
+
+    system.rollback(REQUESTS);
+
+    bool passed = matches && reused && torn == 0 && advanced && shared;
+    cout << "Expected: consistent immutable versions, unchanged state and chunks reused - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testPackedDriverPosition(RideShareSystem& system) {
+    cout << "\n[TEST 31] Packed Driver Position" << endl;
+
+    // Fields round-trip, including a negative zone
+    DriverPosition packed = packPosition(1234, -5, DRIVER_OFFLINE);
+    bool roundTrip = positionLocation(packed) == 1234 && positionZone(packed) == -5 &&
+                     positionStatus(packed) == DRIVER_OFFLINE;
+
+    Driver* driver = system.getDriver(0);
+    DriverPosition original = driver->getPosition();
+    int homeLocation = positionLocation(original);
+    int homeZone = positionZone(original);
+    int awayLocation = homeLocation == 0 ? 7 : 0;
+    int awayZone = system.getCity().getLocationZone(awayLocation);
+
+    // A writer flips the driver between two places; a reader must never see
+    // one place's location with the other's zone
+    atomic<bool> moving(true);
+    atomic<int> mixed(0);
+    thread reader([&] {
+        while (moving) {
+            DriverPosition position = driver->getPosition();
+            int location = positionLocation(position);
+            int zone = positionZone(position);
+            if ((location == homeLocation && zone != homeZone) ||
+                (location == awayLocation && zone != awayZone)) {
+                mixed++;
+            }
+        }
+    });
+    for (int i = 0; i < 20000; i++) {
+        if (i % 2 == 0) {
+            driver->moveTo(awayLocation, awayZone);
+        } else {
+            driver->moveTo(homeLocation, homeZone);
+        }
+    }
+    moving = false;
+    reader.join();
+
+    // A claim changes only the status
+    driver->setStatus(DRIVER_AVAILABLE);
+    bool claimed = driver->tryClaim() && !driver->tryClaim() &&
+                   driver->getStatus() == DRIVER_BUSY &&
+                   driver->getCurrentLocationId() == homeLocation &&
+                   driver->getZoneId() == homeZone;
+
+    // Rollback restores all three fields in one store
+    driver->setPosition(awayLocation, awayZone, DRIVER_OFFLINE);
+    bool restoredTogether = driver->getPosition() ==
+                            packPosition(awayLocation, awayZone, DRIVER_OFFLINE);
+    driver->setPosition(homeLocation, homeZone, positionStatus(original));
+    cout << "Mixed reads: " << mixed << endl;
+
+    bool passed = roundTrip && mixed == 0 && claimed && restoredTogether &&
+                  driver->getPosition() == original;
+    cout << "Expected: location, zone and status always read together - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testTripStateSwap(RideShareSystem& system) {
+    cout << "\n[TEST 32] Trip State Compare-and-Swap" << endl;
+
+    // Starters race cancellers on an assigned trip: exactly one call wins,
+    // and every loser is told the state the winner left
+    const int ROUNDS = 200;
+    const int RACERS = 4;
+    int badRounds = 0;
+    int startsWon = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        Trip trip(round, 0, 0, 3);
+        trip.setState(TRIP_ASSIGNED);
+
+        atomic<int> wins(0);
+        atomic<int> wrongState(0);
+        thread racers[RACERS * 2];
+        for (int i = 0; i < RACERS * 2; i++) {
+            int target = (i + round) % 2 == 0 ? TRIP_ONGOING : TRIP_CANCELLED;
+            racers[i] = thread([&trip, &wins, &wrongState, target] {
+                int actualState;
+                if (trip.transitionTo(target, actualState)) {
+                    wins++;
+                } else if (actualState != TRIP_ONGOING && actualState != TRIP_CANCELLED) {
+                    wrongState++;
+                }
+            });
+        }
+        for (int i = 0; i < RACERS * 2; i++) {
+            racers[i].join();
+        }
+        if (wins != 1 || wrongState > 0) {
+            badRounds++;
+        }
+        if (trip.getState() == TRIP_ONGOING) {
+            startsWon++;
+        }
+    }
+    cout << "Rounds with more or fewer than one winner: " << badRounds
+         << " (starts won " << startsWon << "/" << ROUNDS << ")" << endl;
+
+    // A caller that validated against a stale state gets the current one back
+    Trip stale(0, 0, 0, 3);
+    int actualState = -1;
+    bool staleRejected = stale.transitionTo(TRIP_CANCELLED, actualState) &&
+                         !stale.transitionFrom(TRIP_REQUESTED, TRIP_ASSIGNED, actualState) &&
+                         actualState == TRIP_CANCELLED &&
+                         !stale.assignDriver(5, actualState) && stale.getDriverId() == -1;
+
+    // Losing the trip swap hands the driver claim back
+    Driver* driver = system.getDriver(0);
+    DriverPosition original = driver->getPosition();
+    driver->setStatus(DRIVER_AVAILABLE);
+    bool released = driver->tryClaim() && !stale.assignDriver(driver->getId(), actualState) &&
+                    driver->releaseClaim() && driver->getStatus() == DRIVER_AVAILABLE &&
+                    !driver->releaseClaim();
+    driver->setStatus(positionStatus(original));
+
+    // Through the system: a cancelled trip refuses to complete and the
+    // driver it freed is not touched again
+    int cancelledBefore = system.getCancelledTripCount();
+    int completedBefore = system.getCompletedTripCount();
+    int tripId = system.requestTrip(0, 0, 3);
+    int ops = 1;
+    if (system.assignTrip(tripId)) {
+        ops++;
+    }
+    bool cancelled = system.cancelTrip(tripId);
+    if (cancelled) {
+        ops++;
+    }
+    bool refused = !system.completeTrip(tripId) &&
+                   system.getTrip(tripId)->getState() == TRIP_CANCELLED &&
+                   system.getCompletedTripCount() == completedBefore;
+    system.rollback(ops);
+    bool restored = system.getCancelledTripCount() == cancelledBefore;
+
+    bool passed = badRounds == 0 && staleRejected && released && cancelled && refused && restored;
+    cout << "Expected: one winner per race, losers see the actual state - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testRepeatedRollback(RideShareSystem& system) {
+    cout << "\n[TEST 33] Repeated Rollback Past a Waiting Trip" << endl;
+
+    int totalBefore = system.getTotalTripCount();
+
+    // Every driver busy, and a fourth trip waiting for one
+    int tripA = system.requestTrip(0, 2, 3);
+    int tripB = system.requestTrip(1, 4, 7);
+    int tripC = system.requestTrip(2, 1, 0);
+    int waiting = system.requestTrip(0, 0, 3);
+    system.assignTrip(tripA);
+    system.assignTrip(tripB);
+    system.assignTrip(tripC);
+    bool queued = !system.assignTrip(waiting) && system.getPendingTripCount() == 1;
+    int freedDriver = system.getTrip(tripC)->getDriverId();
+
+    // Undoing an assignment leaves its driver idle; nothing new is recorded
+    system.rollback(1);
+    bool idle = system.getDriver(freedDriver)->getStatus() == DRIVER_AVAILABLE &&
+                system.getTrip(tripC)->getState() == TRIP_REQUESTED &&
+                system.getTrip(waiting)->getState() == TRIP_REQUESTED &&
+                system.getPendingTripCount() == 1;
+
+    // The explicit dispatch step matches them, as an operation of its own
+    bool dispatched = system.dispatchWaitingTrips() == 1 &&
+                      system.getTrip(waiting)->getDriverId() == freedDriver &&
+                      system.getPendingTripCount() == 0;
+    system.rollback(1);
+    bool undone = system.getTrip(waiting)->getState() == TRIP_REQUESTED &&
+                  system.getPendingTripCount() == 1 &&
+                  system.getDriver(freedDriver)->getStatus() == DRIVER_AVAILABLE;
+
+    // One operation per rollback all the way back: two assignments and four requests
+    int steps = 0;
+    while (system.getTotalTripCount() > totalBefore && steps < 20) {
+        system.rollback(1);
+        steps++;
+    }
+    bool reached = steps == 6 && system.getPendingTripCount() == 0;
+    for (int i = 0; i < system.getDriverCount(); i++) {
+        reached = reached && system.getDriver(i)->getStatus() == DRIVER_AVAILABLE;
+    }
+    cout << "Rollbacks back to the start: " << steps << endl;
+
+    bool passed = queued && idle && dispatched && undone && reached;
+    cout << "Expected: each rollback undoes one operation, drivers stay idle - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+bool testArrayGrowth(RideShareSystem& system) {
+    cout << "\n[TEST 34] Entity Array Growth" << endl;
+
+    // Growth moves every record, so this runs on its own system with
+    // default capacities and no reservations
+    (void)system;
+    RideShareSystem scratch;
+
+    // A chain of locations, each road i <-> i+1 with distance i+1
+    const int locationCount = 40;
+    for (int i = 0; i < locationCount; i++) {
+        scratch.addLocation("L" + to_string(i), 1 + i % 3);
+    }
+    for (int i = 0; i + 1 < locationCount; i++) {
+        scratch.addRoad(i, i + 1, i + 1);
+    }
+
+    const int driverCount = 25;
+    for (int i = 0; i < driverCount; i++) {
+        scratch.addDriver("Driver " + to_string(i), i, 1 + i % 3);
+    }
+    for (int i = 0; i < 15; i++) {
+        scratch.addRider("Rider " + to_string(i));
+    }
+    const int tripCount = 50;
+    int first = -1, last = -1;
+    for (int i = 0; i < tripCount; i++) {
+        last = scratch.requestTrip(i % 15, i % locationCount, (i + 1) % locationCount);
+        if (first < 0) first = last;
+    }
+
+    // Names and road lists moved with their records
+    City& city = scratch.getCity();
+    bool locations = city.getLocationName(0) == "L0" &&
+                     city.getLocationName(locationCount - 1) == "L" + to_string(locationCount - 1);
+    int roadsAtFive = 0;
+    for (Edge* edge = city.getLocation(5)->adjacencyList; edge; edge = edge->next) {
+        if ((edge->destination == 4 && edge->weight == 5) ||
+            (edge->destination == 6 && edge->weight == 6)) {
+            roadsAtFive++;
+        }
+    }
+    bool roads = roadsAtFive == 2 && scratch.getDistance(0, locationCount - 1) == 780;
+
+    bool drivers = scratch.getDriverCount() == driverCount &&
+                   scratch.getDriver(0)->getName() == "Driver 0" &&
+                   scratch.getDriver(driverCount - 1)->getName() == "Driver 24" &&
+                   scratch.getDriver(driverCount - 1)->getCurrentLocationId() == 24;
+
+    bool trips = scratch.getLiveTripCount() == tripCount &&
+                 scratch.getTrip(first)->getPickupLocationId() == 0 &&
+                 scratch.getTrip(last)->getRiderId() == (tripCount - 1) % 15 &&
+                 scratch.getTrip(last)->getDropoffLocationId() == tripCount % locationCount;
+
+    bool passed = locations && roads && drivers && trips;
+    cout << "Expected: names, road lists and trips survive every resize - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
+// Runs two system calls on one trip at the same moment; returns how many succeeded
+static int raceTransitions(RideShareSystem& system, int tripId, bool first(RideShareSystem&, int),
+                           bool second(RideShareSystem&, int)) {
+    atomic<bool> go(false);
+    atomic<int> wins(0);
+    thread a([&] {
+        while (!go) this_thread::yield();
+        if (first(system, tripId)) wins++;
+    });
+    thread b([&] {
+        while (!go) this_thread::yield();
+        if (second(system, tripId)) wins++;
+    });
+    go = true;
+    a.join();
+    b.join();
+    return wins;
+}
+
+static bool startCall(RideShareSystem& system, int tripId) { return system.startTrip(tripId); }
+static bool completeCall(RideShareSystem& system, int tripId) { return system.completeTrip(tripId); }
+static bool cancelCall(RideShareSystem& system, int tripId) { return system.cancelTrip(tripId); }
+
+bool testSystemTransitionRace(RideShareSystem& system) {
+    cout << "\n[TEST 35] Racing Transitions Through the System" << endl;
+
+    int totalBefore = system.getTotalTripCount();
+    int completedBefore = system.getCompletedTripCount();
+    int cancelledBefore = system.getCancelledTripCount();
+
+    // Start races cancel on an assigned trip; then complete races cancel on
+    // whatever started. Exactly one call wins each race.
+    const int ROUNDS = 20;
+    int badRounds = 0;
+    int startsWon = 0;
+    int ops = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        int tripId = system.requestTrip(round % 3, 0, 3);
+        ops++;
+        if (!system.assignTrip(tripId)) {
+            badRounds++;
+            continue;
+        }
+        ops++;
+
+        bool startFirst = round % 2 == 0;
+        int wins = raceTransitions(system, tripId, startFirst ? startCall : cancelCall,
+                                   startFirst ? cancelCall : startCall);
+        ops += wins;
+        int state = system.getTrip(tripId)->getState();
+        if (wins != 1 || (state != TRIP_ONGOING && state != TRIP_CANCELLED)) {
+            badRounds++;
+        }
+        if (state != TRIP_ONGOING) continue;
+        startsWon++;
+
+        wins = raceTransitions(system, tripId, completeCall, cancelCall);
+        ops += wins;
+        if (wins != 1 || system.getTrip(tripId)->getState() != TRIP_COMPLETED) {
+            badRounds++;
+        }
+    }
+    bool counted = system.getCompletedTripCount() == completedBefore + startsWon &&
+                   system.getCancelledTripCount() == cancelledBefore + ROUNDS - startsWon;
+    cout << "Rounds with more or fewer than one winner: " << badRounds
+         << " (starts won " << startsWon << "/" << ROUNDS << ")" << endl;
+
+    // Every winner was recorded once: undoing them restores the start
+    system.rollback(ops);
+    bool restored = system.getTotalTripCount() == totalBefore &&
+                    system.getCompletedTripCount() == completedBefore &&
+                    system.getCancelledTripCount() == cancelledBefore;
+    for (int i = 0; i < system.getDriverCount(); i++) {
+        restored = restored && system.getDriver(i)->getStatus() == DRIVER_AVAILABLE;
+    }
+
+    bool passed = badRounds == 0 && counted && restored;
+    cout << "Expected: one winner per race through the commit path, all undone - "
+         << (passed ? "PASSED" : "FAILED") << endl;
+
+    return passed;
+}
+
 void runAllTests(RideShareSystem& system) {
     cout << "\n========================================" << endl;
     cout << "        RUNNING ALL TEST CASES" << endl;
     cout << "========================================" << endl;
 
     int passed = 0;
-    int total = 10;
+    int total = 35;
 
     if (testShortestPathBasic(system)) passed++;
     if (testShortestPathComplex(system)) passed++;
@@ -326,6 +1602,31 @@ void runAllTests(RideShareSystem& system) {
     if (testSingleRollback(system)) passed++;
     if (testMultipleRollback(system)) passed++;
     if (testAnalyticsAfterRollback(system)) passed++;
+    if (testRejectFallback(system)) passed++;
+    if (testParallelDispatch(system)) passed++;
+    if (testZonePairPenalty(system)) passed++;
+    if (testAsyncDispatch(system)) passed++;
+    if (testPendingRedispatch(system)) passed++;
+    if (testForwardDispatch(system)) passed++;
+    if (testPooledRide(system)) passed++;
+    if (testFreedDriverReassign(system)) passed++;
+    if (testDispatchBudget(system)) passed++;
+    if (testZoneRebalance(system)) passed++;
+    if (testCapabilityDispatch(system)) passed++;
+    if (testIdLookup(system)) passed++;
+    if (testTripArchive(system)) passed++;
+    if (testPackedRecords(system)) passed++;
+    if (testRoadSlab(system)) passed++;
+    if (testSecondaryIndexes(system)) passed++;
+    if (testAnalyticsCounters(system)) passed++;
+    if (testConcurrentAccess(system)) passed++;
+    if (testCommandLoop(system)) passed++;
+    if (testPublishedSnapshots(system)) passed++;
+    if (testPackedDriverPosition(system)) passed++;
+    if (testTripStateSwap(system)) passed++;
+    if (testRepeatedRollback(system)) passed++;
+    if (testArrayGrowth(system)) passed++;
+    if (testSystemTransitionRace(system)) passed++;
 
     cout << "\n========================================" << endl;
     cout << "TEST RESULTS: " << passed << "/" << total << " PASSED" << endl;
@@ -333,8 +1634,9 @@ void runAllTests(RideShareSystem& system) {
 }
 
 int main() {
-    RideShareSystem system;
-    setupSampleCity(system);
+    // Heap-allocated so the menu can reset it (the system is not copyable)
+    RideShareSystem* system = new RideShareSystem();
+    setupSampleCity(*system);
 
     int choice;
     int tripId, riderId, pickupId, dropoffId, k;
@@ -347,71 +1649,72 @@ int main() {
             case 1: // Request Trip
                 cout << "Enter Rider ID: ";
                 cin >> riderId;
-                system.displayCity();
+                system->displayCity();
                 cout << "Enter Pickup Location ID: ";
                 cin >> pickupId;
                 cout << "Enter Dropoff Location ID: ";
                 cin >> dropoffId;
-                tripId = system.requestTrip(riderId, pickupId, dropoffId);
+                tripId = system->requestTrip(riderId, pickupId, dropoffId);
                 if (tripId >= 0) {
                     cout << "Auto-assigning driver..." << endl;
-                    system.assignTrip(tripId);
+                    system->assignTrip(tripId);
                 }
                 break;
 
             case 2: // Start Trip
-                system.displayTrips();
+                system->displayTrips();
                 cout << "Enter Trip ID to start: ";
                 cin >> tripId;
-                system.startTrip(tripId);
+                system->startTrip(tripId);
                 break;
 
             case 3: // Complete Trip
-                system.displayTrips();
+                system->displayTrips();
                 cout << "Enter Trip ID to complete: ";
                 cin >> tripId;
-                system.completeTrip(tripId);
+                system->completeTrip(tripId);
                 break;
 
             case 4: // Cancel Trip
-                system.displayTrips();
+                system->displayTrips();
                 cout << "Enter Trip ID to cancel: ";
                 cin >> tripId;
-                system.cancelTrip(tripId);
+                system->cancelTrip(tripId);
                 break;
 
             case 5: // Rollback
-                system.displayOperationHistory();
+                system->displayOperationHistory();
                 cout << "Enter number of operations to rollback: ";
                 cin >> k;
-                system.rollback(k);
+                system->rollback(k);
                 break;
 
             case 6: // View Trips
-                system.displayTrips();
+                system->displayTrips();
                 break;
 
             case 7: // View Drivers
-                system.displayDrivers();
+                system->displayDrivers();
                 break;
 
             case 8: // View City
-                system.displayCity();
+                system->displayCity();
                 break;
 
             case 9: // View Analytics
-                system.displayAnalytics();
+                system->displayAnalytics();
                 break;
 
             case 10: // View History
-                system.displayOperationHistory();
+                system->displayOperationHistory();
                 break;
 
             case 11: // Run Tests
-                runAllTests(system);
+                runAllTests(*system);
                 // Reset system after tests
-                system = RideShareSystem();
-                setupSampleCity(system);
+                delete system;
+                system = new RideShareSystem();
+                setupSampleCity(*system);
                 break;
 
             case 12: // Start Web Server
@@ -425,11 +1728,15 @@ int main() {
                     cout << "\nPress Ctrl+C to stop the server and return to menu." << endl;
                     cout << "========================================\n" << endl;
 
-                    WebServer webServer(&system, 8080);
+                    WebServer webServer(system, 8080);
                     webServer.start();
                 }
                 break;
 
+            case 13: // Dispatch Waiting Trips
+                system->dispatchWaitingTrips();
+                break;
+
             case 0:
                 cout << "Exiting system. Goodbye!" << endl;
                 break;
@@ -440,5 +1747,6 @@ int main() {
 
     } while (choice != 0);
 
+    delete system;
     return 0;
 }